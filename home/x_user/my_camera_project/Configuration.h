@@ -6,6 +6,7 @@
 #include <sstream>
 #include <string>
 #include <map>
+#include <vector>
 #include "/usr/include/jsoncpp/json/json.h"
 #include <stdexcept>
 #include <algorithm>
@@ -24,6 +25,26 @@ struct IMUConfig {
     int OUT_X_L, OUT_X_H, OUT_Y_L, OUT_Y_H, OUT_Z_L, OUT_Z_H;
 };
 
+// Camera mode for one UI mode (call, standby preview, standalone PiP, QR scan)
+struct CaptureProfile {
+    int width;
+    int height;
+    int fps;
+    std::string format;
+    // Mode the camera itself runs in, the delivered mode is scaled and thinned from it
+    int sensor_width;
+    int sensor_height;
+    int sensor_fps;
+};
+
+// One step of the adaptive stream's resolution/fps ladder
+struct StreamRung {
+    int width;
+    int height;
+    int fps;
+    int min_bitrate;
+};
+
 class Configuration {
 
     public:
@@ -91,6 +112,42 @@ class Configuration {
         int height;
         int swidth;
         int sheight;
+        int frame_pool_size;
+        int capture_backend;
+        int stream_backend;
+        int stream_drop_policy;
+        int stream_duplicate_policy;
+        int adaptive_streaming;
+        int stream_min_bitrate;
+        std::vector<StreamRung> stream_ladder;
+        int stream_record;
+        std::string stream_record_dir;
+        int stream_segment_seconds;
+        int stream_record_max_mb;
+        std::vector<std::string> stream_destinations;
+        int stream_nack;
+        int stream_fec_percentage;
+        int remote_nack;
+        int remote_fec;
+        int keyframe_interval_ms;
+        int audio_fec_percentage;
+        int pip_layout;
+        int pip_inset_percent;
+        int pip_corner;
+        int scene_detection;
+        double scene_threshold;
+        int scene_hold_ms;
+        int scene_static_fps;
+        int scene_static_bitrate_percent;
+        double qr_scan_fps;
+        int qr_roi_percent;
+        std::string keyframe_cache_dir;
+        double seek_decode_ahead_ms;
+        int video_queue_mb;
+        int video_surface;
+        int frame_trace;
+        int frame_trace_period;
+        std::string frame_trace_file;
         std::string _vl_loopback;
         std::string _vl_loopback_small;
         std::string snapshot_pipeline;
@@ -122,6 +179,8 @@ class Configuration {
         int battery_i2c_address;
         std::string ssl_cert_path;
         std::map<std::string, int> number_mappings;
+        std::map<std::string, CaptureProfile> capture_profiles;
+        std::string _vl_loopback_template;
         IMUConfig imu; 
 
         Configuration(const std::string &path) : config_path(path) {
@@ -214,6 +273,52 @@ class Configuration {
                 height = config["height"].asInt();
                 swidth = config["swidth"].asInt();
                 sheight = config["sheight"].asInt();
+                frame_pool_size = config.isMember("frame_pool_size") ? config["frame_pool_size"].asInt() : 8;
+                capture_backend = config.isMember("capture_backend") ? config["capture_backend"].asInt() : 1;
+                stream_backend = config.isMember("stream_backend") ? config["stream_backend"].asInt() : 1;
+                stream_drop_policy = config.isMember("stream_drop_policy") ? config["stream_drop_policy"].asInt() : 1;
+                stream_duplicate_policy = config.isMember("stream_duplicate_policy") ? config["stream_duplicate_policy"].asInt() : 0;
+                adaptive_streaming = config.isMember("adaptive_streaming") ? config["adaptive_streaming"].asInt() : 1;
+                stream_min_bitrate = config.isMember("stream_min_bitrate") ? config["stream_min_bitrate"].asInt() : 300;
+                stream_ladder.clear();
+                if (config.isMember("stream_ladder")) {
+                    for (const auto& rung_j : config["stream_ladder"]) {
+                        stream_ladder.push_back(StreamRung{rung_j.get("width", 0).asInt(), rung_j.get("height", 0).asInt(),
+                                                           rung_j.get("fps", 25).asInt(), rung_j.get("min_bitrate", 0).asInt()});
+                    }
+                } else {
+                    stream_ladder = {{1024, 768, 25, 1500}, {800, 600, 25, 900}, {640, 480, 20, 500}, {320, 240, 15, 0}};
+                }
+                stream_record = config.isMember("stream_record") ? config["stream_record"].asInt() : 0;
+                stream_record_dir = config.isMember("stream_record_dir") ? config["stream_record_dir"].asString() : "/home/x_user/my_camera_project/recordings";
+                stream_segment_seconds = config.isMember("stream_segment_seconds") ? config["stream_segment_seconds"].asInt() : 60;
+                stream_record_max_mb = config.isMember("stream_record_max_mb") ? config["stream_record_max_mb"].asInt() : 2048;
+                stream_destinations.clear();
+                for (const auto& destination : config["stream_destinations"])
+                    stream_destinations.push_back(destination.asString());
+                stream_nack = config.isMember("stream_nack") ? config["stream_nack"].asInt() : 1;
+                stream_fec_percentage = config.isMember("stream_fec_percentage") ? config["stream_fec_percentage"].asInt() : 0;
+                remote_nack = config.isMember("remote_nack") ? config["remote_nack"].asInt() : 0;
+                remote_fec = config.isMember("remote_fec") ? config["remote_fec"].asInt() : 0;
+                keyframe_interval_ms = config.isMember("keyframe_interval_ms") ? config["keyframe_interval_ms"].asInt() : 1000;
+                audio_fec_percentage = config.isMember("audio_fec_percentage") ? config["audio_fec_percentage"].asInt() : 0;
+                pip_layout = config.isMember("pip_layout") ? config["pip_layout"].asInt() : 1;
+                pip_inset_percent = config.isMember("pip_inset_percent") ? config["pip_inset_percent"].asInt() : 30;
+                pip_corner = config.isMember("pip_corner") ? config["pip_corner"].asInt() : 3;
+                scene_detection = config.isMember("scene_detection") ? config["scene_detection"].asInt() : 1;
+                scene_threshold = config.isMember("scene_threshold") ? config["scene_threshold"].asDouble() : 3.0;
+                scene_hold_ms = config.isMember("scene_hold_ms") ? config["scene_hold_ms"].asInt() : 2000;
+                scene_static_fps = config.isMember("scene_static_fps") ? config["scene_static_fps"].asInt() : 5;
+                scene_static_bitrate_percent = config.isMember("scene_static_bitrate_percent") ? config["scene_static_bitrate_percent"].asInt() : 30;
+                qr_scan_fps = config.isMember("qr_scan_fps") ? config["qr_scan_fps"].asDouble() : 4.0;
+                qr_roi_percent = config.isMember("qr_roi_percent") ? config["qr_roi_percent"].asInt() : 50;
+                keyframe_cache_dir = config.isMember("keyframe_cache_dir") ? config["keyframe_cache_dir"].asString() : "/home/x_user/.cache/keyframes";
+                seek_decode_ahead_ms = config.isMember("seek_decode_ahead_ms") ? config["seek_decode_ahead_ms"].asDouble() : 1000.0;
+                video_queue_mb = config.isMember("video_queue_mb") ? config["video_queue_mb"].asInt() : 48;
+                video_surface = config.isMember("video_surface") ? config["video_surface"].asInt() : 1;
+                frame_trace = config.isMember("frame_trace") ? config["frame_trace"].asInt() : 0;
+                frame_trace_period = config.isMember("frame_trace_period") ? config["frame_trace_period"].asInt() : 60;
+                frame_trace_file = config.isMember("frame_trace_file") ? config["frame_trace_file"].asString() : "/home/x_user/my_camera_project/frame_trace.json";
 
                 // sets loopback pipeline 
                 int fps = 15;
@@ -223,14 +328,40 @@ class Configuration {
                     fps = 15;
                 period = fps;
                 // std::cout << "period : " << period  << std::endl;
-                _vl_loopback = config["pipelines"]["_vl_loopback"].asString();
-                _vl_loopback = replacePlaceholder(_vl_loopback, "$video", camera_device);
-                _vl_loopback = replacePlaceholder(_vl_loopback, "$Width", std::to_string(width));
-                _vl_loopback = replacePlaceholder(_vl_loopback, "$Height", std::to_string(height));
+                _vl_loopback_template = config["pipelines"]["_vl_loopback"].asString();
+                _vl_loopback_template = replacePlaceholder(_vl_loopback_template, "$video", camera_device);
+                _vl_loopback_template = replacePlaceholder(_vl_loopback_template, "$Width", std::to_string(width));
+                _vl_loopback_template = replacePlaceholder(_vl_loopback_template, "$Height", std::to_string(height));
+                // Full size loopback, $FPS is filled in by the caller
+                _vl_loopback = replacePlaceholder(_vl_loopback_template, "$SensorWidth", std::to_string(width));
+                _vl_loopback = replacePlaceholder(_vl_loopback, "$SensorHeight", std::to_string(height));
+                _vl_loopback = replacePlaceholder(_vl_loopback, "$SensorFPS", "30");
+                _vl_loopback = replacePlaceholder(_vl_loopback, "$OutWidth", std::to_string(width));
+                _vl_loopback = replacePlaceholder(_vl_loopback, "$OutHeight", std::to_string(height));
+                _vl_loopback = replacePlaceholder(_vl_loopback, "$Format", "YUY2");
                 // std::cout << "_vl_loopback : " << _vl_loopback  << std::endl;
+
+                // sets capture profiles, the defaults are the modes the UI always used
+                capture_profiles["call"] = CaptureProfile{width, height, 30, "YUY2", width, height, 30};
+                capture_profiles["standby"] = CaptureProfile{width, height, 15, "YUY2", width, height, 15};
+                capture_profiles["standalone"] = CaptureProfile{320, 240, 15, "YUY2", 320, 240, 15};
+                capture_profiles["qrcode"] = CaptureProfile{width, height, 15, "YUY2", width, height, 15};
+                const Json::Value& profiles = config["capture_profiles"];
+                for (const auto& name : profiles.getMemberNames()) {
+                    const Json::Value& profile_j = profiles[name];
+                    CaptureProfile profile = capture_profiles.count(name) ? capture_profiles[name] : capture_profiles["standby"];
+                    profile.width = profile_j.get("width", profile.width).asInt();
+                    profile.height = profile_j.get("height", profile.height).asInt();
+                    profile.fps = profile_j.get("fps", profile.fps).asInt();
+                    profile.format = profile_j.get("format", profile.format).asString();
+                    // The sensor runs in the delivered mode unless the profile names another one
+                    profile.sensor_width = profile_j.get("sensor_width", profile_j.isMember("width") ? profile.width : profile.sensor_width).asInt();
+                    profile.sensor_height = profile_j.get("sensor_height", profile_j.isMember("height") ? profile.height : profile.sensor_height).asInt();
+                    profile.sensor_fps = profile_j.get("sensor_fps", profile_j.isMember("fps") ? profile.fps : profile.sensor_fps).asInt();
+                    capture_profiles[name] = profile;
+                }
                 // sets small loopback pipeline
-                _vl_loopback_small = config["pipelines"]["_vl_loopback_small"].asString();
-                _vl_loopback_small = replacePlaceholder(_vl_loopback_small, "$video", camera_device);
+                _vl_loopback_small = capture_pipeline("standalone");
 
                 // sets snapshot pipeline
                 snapshot_pipeline = config["pipelines"]["snapshot_pipeline"].asString();
@@ -248,10 +379,12 @@ class Configuration {
                     fps = 15;
                 speriod = fps;
                 // std::cout << "speriod : " << speriod  << std::endl;
-                if (streaming_codex == 0)
-                    _vs_streaming_original = config["pipelines"]["_vs_streaming"].asString();
-                else if (streaming_codex == 1)
-                    _vs_streaming_original = config["pipelines"]["_vs_streaming_265"].asString();
+                // the adaptive and protected variants send through an rtpbin so the receiver's RTCP reports and NACKs come back
+                std::string streaming_key = streaming_codex == 1 ? "_vs_streaming_265" : "_vs_streaming";
+                bool rtcp = adaptive_streaming == 1 || stream_nack == 1 || stream_fec_percentage > 0;
+                if (rtcp && config["pipelines"].isMember(streaming_key + "_rtcp"))
+                    streaming_key += "_rtcp";
+                _vs_streaming_original = config["pipelines"][streaming_key].asString();
                 _vs_streaming = replacePlaceholder(_vs_streaming_original, "$Width", std::to_string(swidth));
                 _vs_streaming = replacePlaceholder(_vs_streaming, "$Height", std::to_string(sheight));
                 _vs_streaming = replacePlaceholder(_vs_streaming, "$FPS", std::to_string(fps));
@@ -259,7 +392,9 @@ class Configuration {
                 // std::cout << "_vs_streaming : " << _vs_streaming  << std::endl;
 
                 // sets remote pipeline
-                _vp_remote = config["pipelines"]["_vp_remote"].asString();
+                std::string remote_key = (remote_nack == 1 || remote_fec == 1) && config["pipelines"].isMember("_vp_remote_rtcp")
+                                         ? "_vp_remote_rtcp" : "_vp_remote";
+                _vp_remote = config["pipelines"][remote_key].asString();
                 _vp_remote = replacePlaceholder(_vp_remote, "$REMOTE_PORT", std::to_string(server_port));
 
                 // sets incoming audio pipeline
@@ -270,6 +405,8 @@ class Configuration {
                 microphoneVolume = 2.0;
                 audio_outcoming_pipeline = config["pipelines"]["audio_outcoming"].asString();
                 audio_outcoming_pipeline = replacePlaceholder(audio_outcoming_pipeline, "$AUDIO_PORT_SERVER", std::to_string(audio_streaming_port_server));
+                audio_outcoming_pipeline = replacePlaceholder(audio_outcoming_pipeline, "$audio_inband_fec", audio_fec_percentage > 0 ? "true" : "false");
+                audio_outcoming_pipeline = replacePlaceholder(audio_outcoming_pipeline, "$audio_fec_percentage", std::to_string(audio_fec_percentage));
 
                 microphone_pipeline_str = config["pipelines"]["microphone_pipeline"].asString();
                 phone_pipeline_str = config["pipelines"]["headphones_pipeline"].asString();
@@ -349,6 +486,23 @@ class Configuration {
             }
         };
         
+        // Loopback pipeline delivering the named capture profile
+        std::string capture_pipeline(const std::string &_profile) {
+            auto it = capture_profiles.find(_profile);
+            if (it == capture_profiles.end()) {
+                LOG_ERROR("Unknown capture profile " + _profile);
+                it = capture_profiles.find("standby");
+            }
+            std::string pipeline = replacePlaceholder(_vl_loopback_template, "$SensorWidth", std::to_string(it->second.sensor_width));
+            pipeline = replacePlaceholder(pipeline, "$SensorHeight", std::to_string(it->second.sensor_height));
+            pipeline = replacePlaceholder(pipeline, "$SensorFPS", std::to_string(it->second.sensor_fps));
+            pipeline = replacePlaceholder(pipeline, "$OutWidth", std::to_string(it->second.width));
+            pipeline = replacePlaceholder(pipeline, "$OutHeight", std::to_string(it->second.height));
+            pipeline = replacePlaceholder(pipeline, "$FPS", std::to_string(it->second.fps));
+            pipeline = replacePlaceholder(pipeline, "$Format", it->second.format);
+            return pipeline;
+        };
+
         void updateAudioOutcoming(const std::string &addr) {
             audio_outcoming_pipeline = replacePlaceholder(audio_outcoming_pipeline, "$SERVER_ADDRESS", addr);
             LOG_INFO("updateAudioOutcoming " + audio_outcoming_pipeline);
@@ -370,9 +524,10 @@ class Configuration {
 
         void updatestreaming(int _bitrate, int _fps, int _width, int _height) {
             try {
+                bitrate = _bitrate;
                 swidth = _width;
                 sheight = _height;
-                speriod = (int) (1000 / _fps);
+                speriod = _fps;
                 _vs_streaming = replacePlaceholder(_vs_streaming_original, "$Width", std::to_string(_width));
                 _vs_streaming = replacePlaceholder(_vs_streaming, "$Height", std::to_string(_height));
                 _vs_streaming = replacePlaceholder(_vs_streaming, "$FPS", std::to_string(_fps));
@@ -17,6 +17,7 @@
 #include "Timer.h"
 #include <functional>
 #include "Configuration.h"
+#include "keyframeindex.h"
 #include <atomic>
 #include <filesystem>
 #include <zip.h>
@@ -415,6 +416,11 @@ public:
                 }
                 extract_zip(temp_zip, config.todo);
                 LOG_INFO("[HTTP] File downloaded and extracted successfully");
+                // Index the videos now, so their first seek is already instant
+                for (const auto& entry : fs::directory_iterator(config.todo)) {
+                    if (entry.is_regular_file() && entry.path().extension() == ".mp4")
+                        KeyframeIndex::prepare(entry.path().string(), config.keyframe_cache_dir);
+                }
 
                 // Clean up temporary zip
                 if (fs::exists(temp_zip)) {
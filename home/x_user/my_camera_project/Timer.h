@@ -17,6 +17,9 @@ public:
             running = true;
 
             timer_thread = std::thread([=]() {
+                // Type 1 keeps a fixed rate: each tick is due one interval after the previous one,
+                // however long the callback took
+                auto next = std::chrono::steady_clock::now();
                 while (running) {
                     if (_type == 0) {
                         std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
@@ -25,7 +28,8 @@ public:
                         std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
                     }
                     else if (_type == 1){
-                        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms/4));
+                        next += std::chrono::milliseconds(interval_ms);
+                        std::this_thread::sleep_until(next);
                     }
                     if (running) {
                         callback();
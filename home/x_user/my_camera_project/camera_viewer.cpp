@@ -81,7 +81,7 @@ CameraViewer::CameraViewer(QWidget *parent)
     network(config.wireless_interface, config, session),
     pm(config),
     voiceThread(std::make_unique<speechThread>(lang.getVosk(), lang.getGrammar(), config.pipeline_description, 10)),
-    cameraThread(std::make_unique<Camerareader>( config._vl_loopback, config.debug)),
+    cameraThread(std::make_unique<Camerareader>( config.capture_pipeline("standby"), config.debug, config.frame_pool_size, config.capture_backend, config.stream_backend)),
     videoThread(std::make_unique<Videocontroller>("")),
     imuThread(std::make_unique<IMUClassifierThread>(config.imu)),
     A_player(config.audio_incoming_pipeline),
@@ -92,6 +92,7 @@ CameraViewer::CameraViewer(QWidget *parent)
     standbytimer(new QTimer(this)),
     clicktimer(new QTimer(this)),
     helptimer(new QTimer(this)),
+    tracetimer(new QTimer(this)),
     top_left(337, 57), 
     bottom_right(942, 662) {    
     try {
@@ -146,6 +147,20 @@ CameraViewer::CameraViewer(QWidget *parent)
         videoView2->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
         videoView2->setFixedSize(320, 240);
         // videoView2->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);     
+        // OpenGL surfaces take the place of the three views when available
+        use_gl_surface = config.video_surface == 1 && VideoSurface::isSupported();
+        if (use_gl_surface) {
+            videoSurface = new VideoSurface(VideoSurface::ScaleMode::Fill, this);
+            videoSurface1 = new VideoSurface(VideoSurface::ScaleMode::Stretch, this);
+            videoSurface2 = new VideoSurface(VideoSurface::ScaleMode::Fill, this);
+            videoSurface->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+            videoSurface1->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+            videoSurface2->setFixedSize(320, 240);
+            videoView->hide();
+            videoView1->hide();
+            videoView2->hide();
+        }
+        LOG_INFO(std::string("Video display: ") + (use_gl_surface ? "OpenGL surfaces" : "QGraphicsView pixmaps"));
 
         stackedWidget->addWidget(createFirstTab());
         stackedWidget->addWidget(createNavigationWidget());
@@ -181,6 +196,12 @@ CameraViewer::CameraViewer(QWidget *parent)
         connect(timer, &QTimer::timeout, this, &CameraViewer::checkwifi);
         connect(clicktimer, &QTimer::timeout, this, &CameraViewer::report_and_reset_clicks);
         connect(helptimer, &QTimer::timeout, this, &CameraViewer::finish_helping);
+        // Frame latency trace, reported every frame_trace_period seconds and exported on SIGUSR1
+        if (config.frame_trace == 1) {
+            FrameTrace::enable(true);
+            connect(tracetimer, &QTimer::timeout, this, &CameraViewer::report_frame_trace);
+            tracetimer->start(1000);
+        }
         // connect(standbytimer, &QTimer::timeout, this, &CameraViewer::Enter_Low_Power_Mode);
         timer->setInterval(600000);
         clicktimer->setInterval(2000);      
@@ -200,16 +221,72 @@ CameraViewer::CameraViewer(QWidget *parent)
             });
         });
 
+        // Frames go through latest-value mailboxes, a stalled GUI thread only ever has
+        // one pending frame per source instead of a growing queue of them
+        cameraThread->setStreamPacing(config.stream_drop_policy, config.stream_duplicate_policy);
+        std::vector<StreamController::Rung> ladder;
+        for (const StreamRung& rung : config.stream_ladder)
+            ladder.push_back(StreamController::Rung{rung.width, rung.height, rung.fps, rung.min_bitrate});
+        cameraThread->setAdaptiveStreaming(config.adaptive_streaming == 1, config.stream_min_bitrate, ladder);
+        GstStreamer::Outputs outputs;
+        outputs.destinations = config.stream_destinations;
+        if (config.stream_record == 1) {
+            outputs.record_dir = config.stream_record_dir;
+            outputs.segment_seconds = config.stream_segment_seconds;
+            outputs.record_max_bytes = static_cast<uint64_t>(config.stream_record_max_mb) * 1024 * 1024;
+        }
+        cameraThread->setStreamOutputs(outputs);
+        RtpProtection::Settings protection;
+        protection.nack = config.stream_nack == 1;
+        protection.fec_percentage = config.stream_fec_percentage;
+        protection.keyframe_interval_ms = config.keyframe_interval_ms;
+        cameraThread->setStreamProtection(protection);
+        protection.nack = config.remote_nack == 1;
+        protection.fec_percentage = config.remote_fec == 1 ? 1 : 0;
+        cameraThread->setRemoteProtection(protection);
+        FrameCompositor::Settings pip;
+        pip.layout = config.pip_layout == 2 ? FrameCompositor::Layout::LocalMain
+                   : config.pip_layout == 1 ? FrameCompositor::Layout::RemoteMain : FrameCompositor::Layout::Off;
+        pip.inset_percent = config.pip_inset_percent;
+        pip.corner = static_cast<FrameCompositor::Corner>(std::clamp(config.pip_corner, 0, 3));
+        pip.counter = config.debug == 1;
+        cameraThread->setPictureInPicture(pip);
+        SceneMonitor::Settings scene;
+        scene.enabled = config.scene_detection == 1;
+        scene.threshold = config.scene_threshold;
+        scene.hold_ms = config.scene_hold_ms;
+        scene.static_fps = config.scene_static_fps;
+        scene.static_bitrate_percent = config.scene_static_bitrate_percent;
+        cameraThread->setSceneDetection(scene);
+        QrScanner::Settings qr;
+        qr.fps = config.qr_scan_fps;
+        qr.roi_percent = config.qr_roi_percent;
+        qrScanner.configure(qr);
+        KeyframeIndex::Settings keyframes;
+        keyframes.cache_dir = config.keyframe_cache_dir;
+        keyframes.max_decode_ahead_ms = config.seek_decode_ahead_ms;
+        videoThread->setSeekSettings(keyframes);
+        videoThread->setQueueBudget(static_cast<size_t>(config.video_queue_mb) * 1024 * 1024);
         cameraThread->setFrameCallback([this](const cv::Mat& _frame) {
-            QMetaObject::invokeMethod(this, [this, _frame]() {
-                handle_update_frame(_frame);
-            });
+            if (cameraMailbox.post(_frame)) {
+                QMetaObject::invokeMethod(this, [this]() {
+                    cv::Mat frame;
+                    if (cameraMailbox.take(frame))
+                        handle_update_frame(frame);
+                }, Qt::QueuedConnection);
+            }
         });    
+        // The GL surfaces convert YUY2 in their shader, so the camera frames reach them unconverted
+        cameraThread->setRawDisplay(use_gl_surface);
         
         videoThread->setFrameCallback([this](const cv::Mat& _frame) {
-            QMetaObject::invokeMethod(this, [this, _frame]() {
-                handle_update_video(_frame);
-            });
+            if (videoMailbox.post(_frame)) {
+                QMetaObject::invokeMethod(this, [this]() {
+                    cv::Mat frame;
+                    if (videoMailbox.take(frame))
+                        handle_update_video(frame);
+                }, Qt::QueuedConnection);
+            }
         });  
         if (config.testbench == 0) {
             if (imuThread->init() == 0) {
@@ -240,7 +317,28 @@ CameraViewer::CameraViewer(QWidget *parent)
     }
 }
 
-CameraViewer::~CameraViewer() {       
+CameraViewer::~CameraViewer() {
+    // qrScanner is destroyed before cameraThread, its frame bus worker must be gone first
+    if (qrcodeSub != 0 && cameraThread) {
+        cameraThread->unsubscribe(qrcodeSub);
+        qrcodeSub = 0;
+        qrScanner.stop();
+    }
+    // Stop the threads that post frames, then drop the frames still held by the mailboxes
+    // and surfaces: those are destroyed after the threads (the surfaces with the child widgets)
+    if (videoThread)
+        videoThread->close();
+    if (cameraThread) {
+        cameraThread->stopCapturing();
+        cameraThread->stopremote();
+    }
+    cameraMailbox.clear();
+    videoMailbox.clear();
+    if (use_gl_surface) {
+        videoSurface->clear();
+        videoSurface1->clear();
+        videoSurface2->clear();
+    }
     if (videoPixmapItem) {
         delete videoPixmapItem;
         videoPixmapItem = nullptr;
@@ -258,6 +356,13 @@ CameraViewer::~CameraViewer() {
     if (imuThread && config.testbench == 0) {
         imuThread->stop();
     }
+    cameraMailbox.logStats();
+    videoMailbox.logStats();
+    if (use_gl_surface) {
+        videoSurface->logStats("camera");
+        videoSurface1->logStats("video");
+        videoSurface2->logStats("standalone");
+    }
     delete videoView;
     delete videoScene;
     delete videoView1;
@@ -285,6 +390,9 @@ QWidget* CameraViewer::createFirstTab() {
             Qt::KeepAspectRatio,
             Qt::FastTransformation
         );
+        QImage battery_image = scaledPixmapBattery.toImage().convertToFormat(QImage::Format_ARGB32);
+        battery_icon = cv::Mat(battery_image.height(), battery_image.width(), CV_8UC4,
+                               const_cast<uchar*>(battery_image.constBits()), battery_image.bytesPerLine()).clone();
 
         QPixmap pixmap_wifi(QString::fromStdString(config.wifi_icon_nowifi));
         QPixmap scaledPixmapWifi = pixmap_wifi.scaled(
@@ -325,7 +433,7 @@ QWidget* CameraViewer::createFirstTab() {
         videoView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
         videoView->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
         videoView->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-        gridLayout->addWidget(videoView, 0, 0, 11, 7);  // Add videoView to layout
+        gridLayout->addWidget(video_widget(0), 0, 0, 11, 7);  // Add videoView to layout
         // Set stretch factors
         for (int i = 0; i < 11; ++i) {
             gridLayout->setRowStretch(i, 1);
@@ -488,7 +596,7 @@ QWidget* CameraViewer::createContentWidget() {
         // videoView2->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);            
         videoView2->setFixedSize(320, 240);
         Task_videoLayout->addWidget(taskListWidget);
-        Task_videoLayout->addWidget(videoView2);
+        Task_videoLayout->addWidget(video_widget(2));
         view->setMaximumHeight(Sheight*0.75);
         layout->addLayout(Task_videoLayout);        
         layout->addWidget(view);        
@@ -524,7 +632,8 @@ QWidget* CameraViewer::createVideoTab() {
         videoView1->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);        
         videoView1->setMaximumHeight(0.95*Sheight);
         videoView1->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-        layout->addWidget(videoView1);
+        video_widget(1)->setMaximumHeight(0.95*Sheight);
+        layout->addWidget(video_widget(1));
         QHBoxLayout *bottomLeftLayout = new QHBoxLayout();
         
         listvideos->setMaximumWidth(Swidth*0.95);
@@ -785,9 +894,7 @@ void CameraViewer::working_mode() {
 
             if (current_mode.find("offline") == std::string::npos || _status == 0) {
                 // Open the video stream using OpenCV and GStreamer
-                std::string _loopback = config._vl_loopback;
-                _loopback = config.replacePlaceholder(_loopback, "$FPS", "15");
-                cameraThread->update_camera_pipeline(_loopback);                            
+                cameraThread->update_camera_pipeline(config.capture_pipeline("standby"));
                 int _cap = cameraThread->init();
                 if (_cap == -1) { 
                     image = QImage(Swidth, Sheight, QImage::Format_RGB888);
@@ -799,12 +906,7 @@ void CameraViewer::working_mode() {
                     painter.setFont(font);
                     painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOCAMERA")));
                     painter.end();
-                    pixmap = QPixmap::fromImage(image);
-                    videoPixmapItem->setPixmap(pixmap);
-                    videoScene->setSceneRect(videoPixmapItem->boundingRect());
-                    videoView->fitInView(videoScene->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-                    videoView->centerOn(videoPixmapItem);
-                    videoView->viewport()->update();  
+                    present_image(0, image);
                     legend_label3->setText(QString::fromStdString(lang.getText("defaulttab","camera")));
                     status_label->setVisible(false);           
                     session.stop_notify();  
@@ -940,6 +1042,7 @@ void CameraViewer::FSM(nlohmann::json _data, std::string _event) {
                 }
                 else {       
                     task_name->clear();
+                    sync_call_overlays();
                     task_name->setVisible(false);
                     task_list->clear();
                     task_list->setVisible(false);
@@ -985,6 +1088,7 @@ void CameraViewer::FSM(nlohmann::json _data, std::string _event) {
                 status_label->setVisible(true);
                 task_name->setVisible(false);
                 task_name->clear();
+                sync_call_overlays();
                 task_list->setVisible(false);
                 task_list->clear();
                 message->setVisible(false);
@@ -1058,14 +1162,10 @@ void CameraViewer::handle_update_frame(cv::Mat _frame) {
             }
             camera_rotate = true;
         }
+        int view = current_mode.find("Standalone") == std::string::npos ? 0 : 2;
         if (!_frame.empty()) {
-            if (current_mode.find("qrcode") != std::string::npos) {  
-                if (qrcode_counter %50 == 0) {
-                    processQRCode(_frame.clone());      
-                }                         
-                qrcode_counter += 1;
-            }
-            image = QImage(_frame.data, _frame.cols, _frame.rows, _frame.step, QImage::Format_BGR888);
+            FrameTrace::mark(_frame, FrameTrace::Dispatched);
+            present_frame(view, _frame);
         } else {
             image = QImage(Swidth, Sheight, QImage::Format_RGB888);
             image.fill(Qt::black);  // Fill the image with black
@@ -1076,26 +1176,7 @@ void CameraViewer::handle_update_frame(cv::Mat _frame) {
             painter.setFont(font);
             painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOFRAME")));
             painter.end();
-        }
-        auto frame_start = std::chrono::high_resolution_clock::now();
-        pixmap = QPixmap::fromImage(image);//.scaled(videoLabel->size(), Qt::KeepAspectRatio,Qt::FastTransformation);
-        if (current_mode.find("Standalone") == std::string::npos) {
-            videoPixmapItem->setPixmap(pixmap);
-            videoScene->setSceneRect(videoPixmapItem->boundingRect());
-            videoView->fitInView(videoScene->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-            videoView->centerOn(videoPixmapItem);
-            videoView->viewport()->update(); // Trigger redraw
-            auto capture_end = std::chrono::high_resolution_clock::now();
-            // Timing calculations
-            double capture_time = std::chrono::duration<double, std::milli>(
-                capture_end - frame_start).count();
-        }
-        else {
-            videoPixmapItem2->setPixmap(pixmap);
-            videoScene2->setSceneRect(videoPixmapItem2->boundingRect());
-            videoView2->fitInView(videoScene2->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-            videoView2->centerOn(videoPixmapItem2);
-            videoView2->viewport()->update(); // Trigger redraw
+            present_image(view, image);
         }
 
         // std::cout << "capture time: " << capture_time << std::endl;
@@ -1121,12 +1202,8 @@ void CameraViewer::handle_update_frame(cv::Mat _frame) {
 
 void CameraViewer::handle_update_video(cv::Mat _frame) {
     try {
-        if (!videoPixmapItem1) {
-            LOG_ERROR("videoPixmapItem1 is null, skipping update");
-            return; // Exit if the pixmap item isn’t initialized
-        }
         if (!_frame.empty()) {
-            image = QImage(_frame.data, _frame.cols, _frame.rows, _frame.step, QImage::Format_BGR888);
+            present_frame(1, _frame);
         } else {
             image = QImage(Swidth, Sheight, QImage::Format_RGB888);
             image.fill(Qt::black);  // Fill the image with black
@@ -1137,20 +1214,15 @@ void CameraViewer::handle_update_video(cv::Mat _frame) {
             painter.setFont(font);
             painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOFRAME")));
             painter.end();
+            present_image(1, image);
         }
-        pixmap1 = QPixmap::fromImage(image);
-        videoPixmapItem1->setPixmap(pixmap1);
-        videoScene1->setSceneRect(videoPixmapItem1->boundingRect());
-        videoView1->fitInView(videoScene1->sceneRect(), Qt::IgnoreAspectRatio); 
-        videoView1->centerOn(videoPixmapItem1);
-        videoView1->viewport()->update(); // Trigger redraw    
         if (!screenshot) {
             screenshot = true;
             QPixmap pixmap2 = this->grab();
             // Option 2: Capture entire CameraViewer (uncomment to use)
             // QPixmap pixmap = this->grab();
             pixmap2.save("/home/x_user/my_camera_project/screenshot11.png", "PNG");            
-            LOG_INFO("videoView1 size: " + std::to_string(videoView1->size().width()) + "x" + std::to_string(videoView1->size().height()));
+            LOG_INFO("videoView1 size: " + std::to_string(video_widget(1)->size().width()) + "x" + std::to_string(video_widget(1)->size().height()));
             QRectF rect = videoScene1->sceneRect();
             LOG_INFO("videoScene1 rect: (" + std::to_string(rect.x()) + ", " + std::to_string(rect.y()) + ", " +
                     std::to_string(rect.width()) + ", " + std::to_string(rect.height()) + ")");
@@ -1290,6 +1362,7 @@ void CameraViewer::report_and_reset_clicks() {
                     status_label->setVisible(true);
                     task_name->setVisible(false);
                     task_name->clear();
+                    sync_call_overlays();
                     task_list->setVisible(false);
                     task_list->clear();
                     message->setVisible(false);
@@ -1342,6 +1415,7 @@ void CameraViewer::report_and_reset_clicks() {
                     status_label->setVisible(true);
                     task_name->setVisible(false);
                     task_name->clear();
+                    sync_call_overlays();
                     task_list->setVisible(false);
                     task_list->clear();
                     message->setVisible(false);
@@ -1419,9 +1493,7 @@ void CameraViewer::report_and_reset_clicks() {
                     }
                     else {
                         //Qrcode 
-                        std::string _loopback = config._vl_loopback;
-                        _loopback = config.replacePlaceholder(_loopback, "$FPS", "15");
-                        cameraThread->update_camera_pipeline(_loopback);
+                        cameraThread->update_camera_pipeline(config.capture_pipeline("standby"));
                         int _cap = cameraThread->init();
                         if (_cap == -1) { 
                             image = QImage(Swidth, Sheight, QImage::Format_RGB888);
@@ -1433,12 +1505,7 @@ void CameraViewer::report_and_reset_clicks() {
                             painter.setFont(font);
                             painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOCAMERA")));
                             painter.end();
-                            pixmap = QPixmap::fromImage(image);
-                            videoPixmapItem->setPixmap(pixmap);
-                            videoScene->setSceneRect(videoPixmapItem->boundingRect());
-                            videoView->fitInView(videoScene->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-                            videoView->centerOn(videoPixmapItem);
-                            videoView->viewport()->update();                
+                            present_image(0, image);
                             return;
                         }    
                         camera_rotate = false;
@@ -1486,10 +1553,10 @@ void CameraViewer::report_and_reset_clicks() {
                         scenaraio = 5;
                     }
                     else if (clicks == 6) {
-                        cameraThread->releasecamera();    
                         if (pdf.getPageCount() > 2)
                             pdf.saveToFile(lang.getText("pdf_message","name")+getCurrentDateTime()+".pdf");
                         if (config.debug == 0) {
+                            cameraThread->releasecamera();    
                             network.enable_wifi();
                             int Wconnected = 2;
                             while(Wconnected != 0){
@@ -1501,10 +1568,8 @@ void CameraViewer::report_and_reset_clicks() {
                             working_mode();
                         }
                         else {                           
-                            std::string _loopback = config._vl_loopback;
-                            _loopback = config.replacePlaceholder(_loopback, "$FPS", "15");
-                            cameraThread->update_camera_pipeline(_loopback);
-                            int _cap = cameraThread->init();
+                            // Back to the standby preview on the still open camera
+                            int _cap = apply_capture_profile("standby");
                             if (_cap == -1) { 
                                 image = QImage(Swidth, Sheight, QImage::Format_RGB888);
                                 image.fill(Qt::black);  // Fill the image with black
@@ -1515,12 +1580,7 @@ void CameraViewer::report_and_reset_clicks() {
                                 painter.setFont(font);
                                 painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOCAMERA")));
                                 painter.end();
-                                pixmap = QPixmap::fromImage(image);
-                                videoPixmapItem->setPixmap(pixmap);
-                                videoScene->setSceneRect(videoPixmapItem->boundingRect());
-                                videoView->fitInView(videoScene->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-                                videoView->centerOn(videoPixmapItem);
-                                videoView->viewport()->update();  
+                                present_image(0, image);
                                 legend_label3->setText(QString::fromStdString(lang.getText("defaulttab","camera")));
                                 status_label->setVisible(false);           
                                 session.stop_notify();  
@@ -1756,6 +1816,8 @@ void CameraViewer::report_and_reset_clicks() {
                         }
                         videoScene1->clear();
                         videoPixmapItem1 = nullptr;
+                        if (videoSurface1)
+                            videoSurface1->clear();
                         scenaraio = 3;
                         videoScene1->clear();
                         mp4Files.clear();
@@ -1794,9 +1856,7 @@ void CameraViewer::report_and_reset_clicks() {
                     }
                 }
                 else if (clicks == 3) {
-                    std::string _loopback = config._vl_loopback;
-                    _loopback = config.replacePlaceholder(_loopback, "$FPS", "15");
-                    cameraThread->update_camera_pipeline(_loopback);
+                    cameraThread->update_camera_pipeline(config.capture_pipeline("standby"));
                     int _cap = cameraThread->init();
                     if (_cap == -1) { 
                         image = QImage(Swidth, Sheight, QImage::Format_RGB888);
@@ -1808,12 +1868,7 @@ void CameraViewer::report_and_reset_clicks() {
                         painter.setFont(font);
                         painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOCAMERA")));
                         painter.end();
-                        pixmap = QPixmap::fromImage(image);
-                        videoPixmapItem->setPixmap(pixmap);
-                        videoScene->setSceneRect(videoPixmapItem->boundingRect());
-                        videoView->fitInView(videoScene->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-                        videoView->centerOn(videoPixmapItem);
-                        videoView->viewport()->update();  
+                        present_image(0, image);
                         legend_label3->setText(QString::fromStdString(lang.getText("defaulttab","camera")));
                         status_label->setVisible(false);           
                         session.stop_notify();  
@@ -1845,9 +1900,7 @@ void CameraViewer::report_and_reset_clicks() {
                     working_mode();
                 }
                 else {
-                    std::string _loopback = config._vl_loopback;
-                    _loopback = config.replacePlaceholder(_loopback, "$FPS", "15");
-                    cameraThread->update_camera_pipeline(_loopback);
+                    cameraThread->update_camera_pipeline(config.capture_pipeline("standby"));
                     int _cap = cameraThread->init();
                     if (_cap == -1) { 
                         image = QImage(Swidth, Sheight, QImage::Format_RGB888);
@@ -1859,12 +1912,7 @@ void CameraViewer::report_and_reset_clicks() {
                         painter.setFont(font);
                         painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOCAMERA")));
                         painter.end();
-                        pixmap = QPixmap::fromImage(image);
-                        videoPixmapItem->setPixmap(pixmap);
-                        videoScene->setSceneRect(videoPixmapItem->boundingRect());
-                        videoView->fitInView(videoScene->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-                        videoView->centerOn(videoPixmapItem);
-                        videoView->viewport()->update();  
+                        present_image(0, image);
                         legend_label3->setText(QString::fromStdString(lang.getText("defaulttab","camera")));
                         status_label->setVisible(false);           
                         session.stop_notify();  
@@ -1937,7 +1985,6 @@ void CameraViewer::complete_standalone_transition(bool _NOWIFI) {
         A_control.setDigitalCaptureVolume(0);
         cameraThread->stopCapturing();
         stackedWidget->setCurrentIndex(1);
-        cameraThread->releasecamera();       
         pdf.reset(); 
         standalone_language_transition = true;
         showdefaultstandalone();
@@ -1956,8 +2003,8 @@ void CameraViewer::complete_standalone_transition(bool _NOWIFI) {
                         A_control.setDigitalCaptureVolume(115);
                         standalone_language_transition = false;
                         LOG_INFO("current mode " + current_mode);
-                        cameraThread->update_camera_pipeline(config._vl_loopback_small);
-                        int _cap = cameraThread->init();
+                        // Drops the open camera to the small preview mode instead of reopening it
+                        int _cap = apply_capture_profile("standalone");
                         if (_cap == -1) { 
                             image = QImage(320, 240, QImage::Format_RGB888);
                             image.fill(Qt::black);  // Fill the image with black
@@ -1968,12 +2015,7 @@ void CameraViewer::complete_standalone_transition(bool _NOWIFI) {
                             painter.setFont(font);
                             painter.drawText(5, 80, QString::fromStdString(lang.getText("error_message", "NOCAMERA")));
                             painter.end();
-                            pixmap = QPixmap::fromImage(image);
-                            videoPixmapItem2->setPixmap(pixmap);
-                            videoScene2->setSceneRect(videoPixmapItem2->boundingRect());
-                            videoView2->fitInView(videoScene2->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-                            videoView2->centerOn(videoPixmapItem2);
-                            videoView2->viewport()->update();  
+                            present_image(2, image);
                             return;
                         }  
                         camera_rotate = false;
@@ -1981,6 +2023,7 @@ void CameraViewer::complete_standalone_transition(bool _NOWIFI) {
                 });
             }
             else {
+                cameraThread->releasecamera();
                 floatingMessage->showMessage(QString::fromStdString(lang.getText("error_message","NOFILES")), 2);
                 A_control.setCaptureInputType("ADC");
                 A_control.setCaptureInputVolume(30);
@@ -1994,6 +2037,7 @@ void CameraViewer::complete_standalone_transition(bool _NOWIFI) {
                 network.disable_wifi();            
         }
         else{
+            cameraThread->releasecamera();
             current_mode = "Standalone";
             session.update_helmet_status("Standalone");
         }
@@ -2088,10 +2132,10 @@ void CameraViewer::handle_command_recognize(std::string _command) {
                         scenaraio = 5;
                     }
                     else if (_command == lang.getText("standalonetab","close")) {       
-                        cameraThread->releasecamera();         
                         if (pdf.getPageCount() > 2)
                             pdf.saveToFile(lang.getText("pdf_message","name")+getCurrentDateTime()+".pdf");
                         if (config.debug == 0) {
+                            cameraThread->releasecamera();
                             network.enable_wifi();
                             int Wconnected = 2;
                             while(Wconnected != 0){
@@ -2103,10 +2147,8 @@ void CameraViewer::handle_command_recognize(std::string _command) {
                             working_mode();
                         }                               
                         else {
-                            std::string _loopback = config._vl_loopback;
-                            _loopback = config.replacePlaceholder(_loopback, "$FPS", "15");
-                            cameraThread->update_camera_pipeline(_loopback);
-                            int _cap = cameraThread->init();
+                            // Back to the standby preview on the still open camera
+                            int _cap = apply_capture_profile("standby");
                             if (_cap == -1) { 
                                 image = QImage(Swidth, Sheight, QImage::Format_RGB888);
                                 image.fill(Qt::black);  // Fill the image with black
@@ -2117,12 +2159,7 @@ void CameraViewer::handle_command_recognize(std::string _command) {
                                 painter.setFont(font);
                                 painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOCAMERA")));
                                 painter.end();
-                                pixmap = QPixmap::fromImage(image);
-                                videoPixmapItem->setPixmap(pixmap);
-                                videoScene->setSceneRect(videoPixmapItem->boundingRect());
-                                videoView->fitInView(videoScene->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-                                videoView->centerOn(videoPixmapItem);
-                                videoView->viewport()->update();  
+                                present_image(0, image);
                                 legend_label3->setText(QString::fromStdString(lang.getText("defaulttab","camera")));
                                 status_label->setVisible(false);           
                                 session.stop_notify();  
@@ -2470,6 +2507,8 @@ void CameraViewer::handle_command_recognize(std::string _command) {
                         }
                         videoScene1->clear();
                         videoPixmapItem1 = nullptr;
+                        if (videoSurface1)
+                            videoSurface1->clear();
                         scenaraio = 3;
                         videoScene1->clear();
                         mp4Files.clear();
@@ -2491,9 +2530,7 @@ void CameraViewer::handle_command_recognize(std::string _command) {
                         working_mode();
                     }
                     else {
-                        std::string _loopback = config._vl_loopback;
-                        _loopback = config.replacePlaceholder(_loopback, "$FPS", "15");
-                        cameraThread->update_camera_pipeline(_loopback);
+                        cameraThread->update_camera_pipeline(config.capture_pipeline("standby"));
                         int _cap = cameraThread->init();
                         if (_cap == -1) { 
                             image = QImage(Swidth, Sheight, QImage::Format_RGB888);
@@ -2505,12 +2542,7 @@ void CameraViewer::handle_command_recognize(std::string _command) {
                             painter.setFont(font);
                             painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOCAMERA")));
                             painter.end();
-                            pixmap = QPixmap::fromImage(image);
-                            videoPixmapItem->setPixmap(pixmap);
-                            videoScene->setSceneRect(videoPixmapItem->boundingRect());
-                            videoView->fitInView(videoScene->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-                            videoView->centerOn(videoPixmapItem);
-                            videoView->viewport()->update();  
+                            present_image(0, image);
                             legend_label3->setText(QString::fromStdString(lang.getText("defaulttab","camera")));
                             status_label->setVisible(false);           
                             session.stop_notify();  
@@ -2607,9 +2639,7 @@ void CameraViewer::handle_command_recognize(std::string _command) {
                         current_mode = "qrcode";                    
                     }
                     else if (current_mode.find("offline") != std::string::npos) {
-                        std::string _loopback = config._vl_loopback;
-                        _loopback = config.replacePlaceholder(_loopback, "$FPS", "15");
-                        cameraThread->update_camera_pipeline(_loopback);
+                        cameraThread->update_camera_pipeline(config.capture_pipeline("standby"));
                         int _cap = cameraThread->init();
                         if (_cap == -1) { 
                             image = QImage(Swidth, Sheight, QImage::Format_RGB888);
@@ -2621,12 +2651,7 @@ void CameraViewer::handle_command_recognize(std::string _command) {
                             painter.setFont(font);
                             painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOCAMERA")));
                             painter.end();
-                            pixmap = QPixmap::fromImage(image);
-                            videoPixmapItem->setPixmap(pixmap);
-                            videoScene->setSceneRect(videoPixmapItem->boundingRect());
-                            videoView->fitInView(videoScene->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-                            videoView->centerOn(videoPixmapItem);
-                            videoView->viewport()->update();                
+                            present_image(0, image);
                             return;
                         }    
                         camera_rotate = false;
@@ -2649,6 +2674,7 @@ void CameraViewer::handle_command_recognize(std::string _command) {
                         status_label->setVisible(true);
                         task_name->setVisible(false);
                         task_name->clear();
+                        sync_call_overlays();
                         task_list->setVisible(false);
                         task_list->clear();
                         message->setVisible(false);
@@ -2705,9 +2731,7 @@ void CameraViewer::handle_command_recognize(std::string _command) {
                 }
                 else if (_command == lang.getText("defaulttab","camera_command")) {
                     if (current_mode.find("nocamera") != std::string::npos) {
-                        std::string _loopback = config._vl_loopback;
-                        _loopback = config.replacePlaceholder(_loopback, "$FPS", "15");
-                        cameraThread->update_camera_pipeline(_loopback);
+                        cameraThread->update_camera_pipeline(config.capture_pipeline("standby"));
                         int _cap = cameraThread->init();
                         if (_cap == -1) { 
                             image = QImage(Swidth, Sheight, QImage::Format_RGB888);
@@ -2719,12 +2743,7 @@ void CameraViewer::handle_command_recognize(std::string _command) {
                             painter.setFont(font);
                             painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOCAMERA")));
                             painter.end();
-                            pixmap = QPixmap::fromImage(image);
-                            videoPixmapItem->setPixmap(pixmap);
-                            videoScene->setSceneRect(videoPixmapItem->boundingRect());
-                            videoView->fitInView(videoScene->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-                            videoView->centerOn(videoPixmapItem);
-                            videoView->viewport()->update();  
+                            present_image(0, image);
                             legend_label3->setText(QString::fromStdString(lang.getText("defaulttab","camera")));
                             status_label->setVisible(false);           
                             session.stop_notify();  
@@ -3151,11 +3170,15 @@ void CameraViewer::process_event(nlohmann::json _data) {
 void CameraViewer::remotestart() {
     try {
         LOG_INFO("[GST] START REMOTING START");
-        int b_remote = cameraThread->startremote(config._vp_remote);
+        // The protected remote pipeline sends its RTCP (NACK, PLI) back to the call server
+        std::string _remote = config.replacePlaceholder(config._vp_remote, "$VPN_ADDR", _ipstream);
+        _remote = config.replacePlaceholder(_remote, "$remote_rtcp_port", std::to_string(config.server_port + 3));
+        int b_remote = cameraThread->startremote(_remote);
         if (b_remote == -1) {
             LOG_ERROR("Error: Could not open the remote pipline.");
             return;
         }                
+        QMetaObject::invokeMethod(this, [this]() { sync_call_overlays(); });
         session.update_event(last_processed_event, "progress", "completed");
         LOG_INFO("[GST] START REMOTING END");
     } catch (const std::exception& e) {
@@ -3167,6 +3190,7 @@ void CameraViewer::remoteend() {
     try {
         LOG_INFO("[GST] STOP REMOTING START");
         cameraThread->stopremote();    
+        QMetaObject::invokeMethod(this, [this]() { sync_call_overlays(); });
         LOG_INFO("[GST] STOP REMOTING END");
     } catch (const std::exception& e) {
         LOG_ERROR("An error occurred in CameraViewer remoteend: " + std::string(e.what()));
@@ -3176,14 +3200,8 @@ void CameraViewer::remoteend() {
 void CameraViewer::streamstart(std::string _data) { 
     try {   
         LOG_INFO("[GST] START STREAMING START");  
-        cameraThread->stopCapturing();
-        cameraThread->releasecamera();    
-        std::string _loopback = config._vl_loopback;
-        _loopback = config.replacePlaceholder(_loopback, "$FPS", "30");
-        cameraThread->update_camera_pipeline(_loopback);  
-        cameraThread->stopCapturing();
-        cameraThread->releasecamera();  
-        int _cap = cameraThread->init();
+        // Renegotiates the running capture to the call profile, the camera is only reopened when that fails
+        int _cap = apply_capture_profile("call");
         if (_cap == -1) { 
             image = QImage(Swidth, Sheight, QImage::Format_RGB888);
             image.fill(Qt::black);  // Fill the image with black
@@ -3194,12 +3212,7 @@ void CameraViewer::streamstart(std::string _data) {
             painter.setFont(font);
             painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOCAMERA")));
             painter.end();
-            pixmap = QPixmap::fromImage(image);
-            videoPixmapItem->setPixmap(pixmap);
-            videoScene->setSceneRect(videoPixmapItem->boundingRect());
-            videoView->fitInView(videoScene->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-            videoView->centerOn(videoPixmapItem);
-            videoView->viewport()->update();  
+            present_image(0, image);
             legend_label3->setText(QString::fromStdString(lang.getText("defaulttab","camera")));
             status_label->setVisible(false);           
             session.stop_notify();  
@@ -3208,13 +3221,14 @@ void CameraViewer::streamstart(std::string _data) {
             return;
         }          
         camera_rotate = false;
-        cameraThread->startCapturing(33);
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (!cameraThread->isCapturing())
+            cameraThread->startCapturing(33);
         std::string _stream = config._vs_streaming;          
         _stream = config.replacePlaceholder(_stream, "$VPN_ADDR", _data);
         _stream = config.replacePlaceholder(_stream, "$server_port", std::to_string(config.server_port));
+        _stream = config.replacePlaceholder(_stream, "$rtcp_port", std::to_string(config.server_port + 1));
         // std::cout << "_stream : " << _stream  << std::endl;
-        int b_stream = cameraThread->startstream(_stream, config.speriod, config.swidth, config.sheight);
+        int b_stream = cameraThread->startstream(_stream, config.speriod, config.swidth, config.sheight, config.bitrate);
         if (b_stream == -1) {
             LOG_ERROR("Error: Could not open the streaming pipline.");
             return;
@@ -3228,14 +3242,7 @@ void CameraViewer::streamstart(std::string _data) {
 void CameraViewer::streamend() {
     try {
         LOG_INFO("[GST] STOP STREAMING START");
-        cameraThread->stopCapturing();
-        cameraThread->releasecamera();    
-        std::string _loopback = config._vl_loopback;
-        _loopback = config.replacePlaceholder(_loopback, "$FPS", "15");
-        cameraThread->update_camera_pipeline(_loopback);  
-        cameraThread->stopCapturing();
-        cameraThread->releasecamera();  
-        int _cap = cameraThread->init();
+        int _cap = apply_capture_profile("standby");
         if (_cap == -1) { 
             image = QImage(Swidth, Sheight, QImage::Format_RGB888);
             image.fill(Qt::black);  // Fill the image with black
@@ -3246,12 +3253,7 @@ void CameraViewer::streamend() {
             painter.setFont(font);
             painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOCAMERA")));
             painter.end();
-            pixmap = QPixmap::fromImage(image);
-            videoPixmapItem->setPixmap(pixmap);
-            videoScene->setSceneRect(videoPixmapItem->boundingRect());
-            videoView->fitInView(videoScene->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-            videoView->centerOn(videoPixmapItem);
-            videoView->viewport()->update();  
+            present_image(0, image);
             legend_label3->setText(QString::fromStdString(lang.getText("defaulttab","camera")));
             status_label->setVisible(false);           
             session.stop_notify();  
@@ -3260,8 +3262,8 @@ void CameraViewer::streamend() {
             return;
         }  
         camera_rotate = false;
-        cameraThread->startCapturing(config.period);
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (!cameraThread->isCapturing())
+            cameraThread->startCapturing(config.period);
         cameraThread->stopstream();   
         LOG_INFO("[GST] STOP STREAMING END");
     } catch (const std::exception& e) {
@@ -3459,6 +3461,8 @@ void CameraViewer::LoadMP4(const std::string &full_path) {
         videoScene1->clear();
         // Ensure videoPixmapItem1 is null since the scene was cleared
         videoPixmapItem1 = nullptr;
+        if (videoSurface1)
+            videoSurface1->clear();
 
         // Create a new videoPixmapItem1 and add to scene
         videoPixmapItem1 = new QGraphicsPixmapItem();
@@ -3515,12 +3519,7 @@ void CameraViewer::LoadMP4(const std::string &full_path) {
             painter.setFont(font);
             painter.drawText(Swidth/2 -100, Sheight/2, QString::fromStdString(lang.getText("error_message", "NOVIDEO")));
             painter.end();
-            pixmap = QPixmap::fromImage(image);
-            videoPixmapItem1->setPixmap(pixmap);
-            videoScene1->setSceneRect(videoPixmapItem1->boundingRect());
-            videoView1->fitInView(videoScene1->sceneRect(), Qt::KeepAspectRatioByExpanding); 
-            videoView1->centerOn(videoPixmapItem1);
-            videoView1->viewport()->update();      
+            present_image(1, image);
                        
         }
     } catch (const std::exception& e) {
@@ -3848,6 +3847,7 @@ void CameraViewer::drawTaskList() {
                 task_name->setVisible(true);
                 task_list->setVisible(true); 
                 task_name->setText(QString::fromStdString(procedure.at("name")[0].at("name")));
+                sync_call_overlays();
                 // Check if we need to append "Exit" as the last task
                 bool exitExists = std::any_of(tasklist.begin(), tasklist.end(), [](const std::map<std::string, std::string> &task) {
                     return task.at("text") == "Exit";
@@ -3890,6 +3890,131 @@ void CameraViewer::drawTaskList() {
     }
 }
 
+int CameraViewer::apply_capture_profile(const std::string& _profile) {
+    try {
+        auto it = config.capture_profiles.find(_profile);
+        if (it == config.capture_profiles.end()) {
+            LOG_ERROR("Unknown capture profile " + _profile);
+            return -1;
+        }
+        const CaptureProfile& profile = it->second;
+        LOG_INFO("Capture profile " + _profile + " " + std::to_string(profile.width) + "x" + std::to_string(profile.height) +
+                 " @ " + std::to_string(profile.fps) + " " + profile.format + ", sensor " + std::to_string(profile.sensor_width) + "x" +
+                 std::to_string(profile.sensor_height) + " @ " + std::to_string(profile.sensor_fps));
+        int _cap = cameraThread->reconfigure(profile.width, profile.height, profile.fps, config.capture_pipeline(_profile), profile.format,
+                                             profile.sensor_width, profile.sensor_height, profile.sensor_fps);
+        if (_cap == 0)
+            capture_profile = _profile;
+        return _cap;
+    } catch (const std::exception& e) {
+        LOG_ERROR("An error occurred in CameraViewer apply_capture_profile: " + std::string(e.what()));
+        return -1;
+    }
+}
+
+// With picture-in-picture the task name and battery icon are drawn into the composed call frame,
+// in the same pass as the inset, and their labels are hidden while the remote video is shown
+void CameraViewer::sync_call_overlays() {
+    try {
+        bool composed = config.pip_layout > 0 && cameraThread->isRemoteActive();
+        std::string task = task_name->text().toStdString();
+        cameraThread->setOverlayText("task", composed ? task : "", FrameCompositor::Corner::TopLeft, 1.5);
+        cameraThread->setOverlayIcon("battery", composed ? battery_icon : cv::Mat(), FrameCompositor::Corner::BottomLeft);
+        task_name->setVisible(!composed && !task.empty());
+        batteryLabel->setVisible(!composed);
+    } catch (const std::exception& e) {
+        LOG_ERROR("An error occurred in CameraViewer sync_call_overlays: " + std::string(e.what()));
+    }
+}
+
+void CameraViewer::report_frame_trace() {
+    try {
+        trace_seconds++;
+        bool requested = FrameTrace::takeExportRequest();
+        if (!requested && trace_seconds < config.frame_trace_period)
+            return;
+        trace_seconds = 0;
+        LOG_INFO("FrameTrace " + FrameTrace::report());
+        FrameTrace::exportTo(config.frame_trace_file);
+    } catch (const std::exception& e) {
+        LOG_ERROR("An error occurred in CameraViewer report_frame_trace: " + std::string(e.what()));
+    }
+}
+
+QWidget* CameraViewer::video_widget(int _view) {
+    if (VideoSurface* surface = video_surface(_view))
+        return surface;
+    return _view == 1 ? videoView1 : _view == 2 ? videoView2 : videoView;
+}
+
+VideoSurface* CameraViewer::video_surface(int _view) {
+    if (!use_gl_surface)
+        return nullptr;
+    return _view == 1 ? videoSurface1 : _view == 2 ? videoSurface2 : videoSurface;
+}
+
+// Camera/video frames (BGR) go to the GL surface as they are, the legacy path wraps them in a QImage
+void CameraViewer::present_frame(int _view, const cv::Mat& _frame) {
+    try {
+        if (VideoSurface* surface = video_surface(_view)) {
+            auto start = std::chrono::steady_clock::now();
+            surface->setFrame(_frame);
+            record_present(_view, start);
+            return;
+        }
+        present_image(_view, QImage(_frame.data, _frame.cols, _frame.rows, _frame.step, QImage::Format_BGR888));
+        if (_view != 1)
+            FrameTrace::mark(_frame, FrameTrace::Painted);
+    } catch (const std::exception& e) {
+        LOG_ERROR("An error occurred in CameraViewer present_frame: " + std::string(e.what()));
+    }
+}
+
+void CameraViewer::present_image(int _view, const QImage& _image) {
+    try {
+        auto start = std::chrono::steady_clock::now();
+        if (VideoSurface* surface = video_surface(_view)) {
+            surface->setImage(_image);
+            record_present(_view, start);
+            return;
+        }
+        QGraphicsPixmapItem* item = _view == 1 ? videoPixmapItem1 : _view == 2 ? videoPixmapItem2 : videoPixmapItem;
+        QGraphicsScene* scene = _view == 1 ? videoScene1 : _view == 2 ? videoScene2 : videoScene;
+        QGraphicsView* view = _view == 1 ? videoView1 : _view == 2 ? videoView2 : videoView;
+        if (!item) {
+            LOG_ERROR("videoPixmapItem" + std::to_string(_view) + " is null, skipping update");
+            return; // Exit if the pixmap item isn’t initialized
+        }
+        QPixmap& target = _view == 1 ? pixmap1 : pixmap;
+        target = QPixmap::fromImage(_image);
+        item->setPixmap(target);
+        scene->setSceneRect(item->boundingRect());
+        view->fitInView(scene->sceneRect(), _view == 1 ? Qt::IgnoreAspectRatio : Qt::KeepAspectRatioByExpanding);
+        view->centerOn(item);
+        view->viewport()->update(); // Trigger redraw
+        record_present(_view, start);
+    } catch (const std::exception& e) {
+        LOG_ERROR("An error occurred in CameraViewer present_image: " + std::string(e.what()));
+    }
+}
+
+// Logs the mean/max UI-thread cost of presenting frames every 300 frames per view
+void CameraViewer::record_present(int _view, std::chrono::steady_clock::time_point _start) {
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+    PresentStats& stats = present_stats[_view];
+    stats.frames++;
+    stats.total_ms += ms;
+    stats.max_ms = std::max(stats.max_ms, ms);
+    if (stats.frames % 300 != 0)
+        return;
+    LOG_INFO("Present view " + std::to_string(_view) + (use_gl_surface ? " (gl)" : " (pixmap)") +
+             " frames " + std::to_string(stats.frames) + ", mean " + std::to_string(stats.total_ms / stats.frames) +
+             " ms, max " + std::to_string(stats.max_ms) + " ms");
+    if (VideoSurface* surface = video_surface(_view))
+        surface->logStats(std::to_string(_view));
+    stats = PresentStats();
+}
+
 void CameraViewer::start_qrcode() {
     try {
         LOG_INFO("start_qrcode");
@@ -3899,6 +4024,20 @@ void CameraViewer::start_qrcode() {
         status_label->setVisible(false);
         qrcode_label->setVisible(true);
         qrcode_label->setText(QString::fromStdString(lang.getText("defaulttab","qrcode")));
+        if (cameraThread->isOpened())
+            apply_capture_profile("qrcode");
+        if (qrcodeSub == 0) {
+            // Luma frames are scanned on the subscriber thread, only decoded payloads reach the GUI thread
+            qrScanner.start([this](const std::string& _payload) {
+                QMetaObject::invokeMethod(this, [this, _payload]() {
+                    if (current_mode.find("qrcode") != std::string::npos)
+                        processQRCode(_payload);
+                });
+            });
+            qrcodeSub = cameraThread->subscribe(qrScanner.busOptions(), [this](cv::Mat _frame) {
+                qrScanner.process(_frame);
+            });
+        }
     } catch (const std::exception& e) {
         LOG_ERROR("An error occurred in CameraViewer start_qrcode: " + std::string(e.what()));
     }
@@ -3916,7 +4055,13 @@ void CameraViewer::stop_qrcode() {
         status_label->setVisible(true);
         qrcode_label->setVisible(false);
         qrcode_label->clear();
-        qrcode_counter = 0;
+        if (qrcodeSub != 0) {
+            cameraThread->unsubscribe(qrcodeSub);
+            qrcodeSub = 0;
+            qrScanner.stop();
+            if (cameraThread->isOpened())
+                apply_capture_profile("standby");
+        }
     } catch (const std::exception& e) {
         LOG_ERROR("An error occurred in CameraViewer stop_qrcode: " + std::string(e.what()));
     }
@@ -3997,75 +4142,53 @@ std::string CameraViewer::removePadding(const std::string &input, const std::str
     return (end == std::string::npos) ? "" : input.substr(0, end + 1);
 }
 
-// QR Code Processing
-void CameraViewer::processQRCode(cv::Mat _frame){
+// QR Code Processing, payloads decoded by qrScanner
+void CameraViewer::processQRCode(const std::string& _payload){
     try {
         LOG_INFO("processQRCode");
-        cv::Point top_left1(337, 57);
-        cv::Point bottom_right1(942, 662);
-        cv::resize(_frame, resized_image, cv::Size(490, 490), 0, 0, cv::INTER_LINEAR);
-        // Crop the image
-        // cropped_image = resized_image(cv::Rect(top_left1.x, top_left1.y, bottom_right1.x - top_left1.x, bottom_right1.y - top_left1.y));
-
-        // // Resize cropped image to 490x490
-        // cv::resize(cropped_image, cropped_image_scaled, cv::Size(490, 490));
-        // Convert to grayscale
-        cv::cvtColor(resized_image, gray_img, cv::COLOR_BGR2GRAY);
-
-        // Decode the QR code using zbar
-        scanner.set_config(zbar::ZBAR_NONE, zbar::ZBAR_CFG_ENABLE, 1);
-        zbar::Image zbarImage(gray_img.cols, gray_img.rows, "Y800", gray_img.data, gray_img.cols * gray_img.rows);
         nlohmann::json emptyData;
-
-        if (scanner.scan(zbarImage)) {
-            for (auto symbol = zbarImage.symbol_begin(); symbol != zbarImage.symbol_end(); ++symbol) {
-                try {
-                    // Decode the payload
-                    std::string payload = symbol->get_data();
-
-                    // Base64 decode
-                    std::string encrypted_msg = base64_decode_openssl(payload);
-
-                    // AES decrypt
-                    std::string decrypted_msg = aes_decrypt_ecb(encrypted_msg, QR_CODE_KEY);
-
-                    // Remove padding
-                    std::string cleaned_str = removePadding(decrypted_msg, QR_CODE_PADDING);
-                    LOG_INFO(cleaned_str);
-                    QString title_message = QString::fromStdString(lang.getText("standalonetab","Wifititle") + cleaned_str);
-                    floatingMessage->showMessage(title_message, 2);
-                    // Parse JSON
-                    Json::Value root;
-                    Json::Reader reader;
-                    if (reader.parse(cleaned_str, root)) {
-                        if (root.isMember("s") && root.isMember("p") && root.isMember("i")) {
-                            Json::Value wifiArray;
-                            Json::Value wifiEntry;
-                            wifiEntry["ssid"] = root["s"];
-                            wifiEntry["password"] = root["p"];
-                            wifiEntry["uri"] = root["i"];
-                            wifiArray.append(wifiEntry);
-                            Json::StreamWriterBuilder writer;
-                            std::string _wifi = Json::writeString(writer, wifiArray);
-                            // Emit signal (if applicable)
-                            // LOG_INFO(_wifi);
-                            
-                            // Save to WiFi file
-                            std::ofstream file(config.wifi_file);
-                            if (file.is_open()) {
-                                file << _wifi;
-                                file.close();
-                            } else {
-                                LOG_ERROR("Failed to write to WiFi file");
-                            }
-                            FSM(emptyData, "stop_scan_positive");
-                        }
+        try {
+            // Base64 decode
+            std::string encrypted_msg = base64_decode_openssl(_payload);
+
+            // AES decrypt
+            std::string decrypted_msg = aes_decrypt_ecb(encrypted_msg, QR_CODE_KEY);
+
+            // Remove padding
+            std::string cleaned_str = removePadding(decrypted_msg, QR_CODE_PADDING);
+            LOG_INFO(cleaned_str);
+            QString title_message = QString::fromStdString(lang.getText("standalonetab","Wifititle") + cleaned_str);
+            floatingMessage->showMessage(title_message, 2);
+            // Parse JSON
+            Json::Value root;
+            Json::Reader reader;
+            if (reader.parse(cleaned_str, root)) {
+                if (root.isMember("s") && root.isMember("p") && root.isMember("i")) {
+                    Json::Value wifiArray;
+                    Json::Value wifiEntry;
+                    wifiEntry["ssid"] = root["s"];
+                    wifiEntry["password"] = root["p"];
+                    wifiEntry["uri"] = root["i"];
+                    wifiArray.append(wifiEntry);
+                    Json::StreamWriterBuilder writer;
+                    std::string _wifi = Json::writeString(writer, wifiArray);
+                    // Emit signal (if applicable)
+                    // LOG_INFO(_wifi);
+                    
+                    // Save to WiFi file
+                    std::ofstream file(config.wifi_file);
+                    if (file.is_open()) {
+                        file << _wifi;
+                        file.close();
+                    } else {
+                        LOG_ERROR("Failed to write to WiFi file");
                     }
-                } catch (const std::exception &e) {
-                    LOG_ERROR("Error processing QR code: " + std::string(e.what()));
-                    FSM(emptyData, "stop_scan_negative");
+                    FSM(emptyData, "stop_scan_positive");
                 }
             }
+        } catch (const std::exception &e) {
+            LOG_ERROR("Error processing QR code: " + std::string(e.what()));
+            FSM(emptyData, "stop_scan_negative");
         }
     } catch (const std::exception& e) {
         LOG_ERROR("An error occurred in CameraViewer processQRCode: " + std::string(e.what()));
@@ -4142,6 +4265,9 @@ void CameraViewer::batteryiconchange(PowerManagement::BatteryStatus status) {
                     batteryLabel->setPixmap(scaledPixmapBattery);
                     batteryLabel_audio->setPixmap(scaledPixmapBattery);
                 }
+                QImage icon = scaledPixmapBattery.toImage().convertToFormat(QImage::Format_ARGB32);
+                battery_icon = cv::Mat(icon.height(), icon.width(), CV_8UC4, const_cast<uchar*>(icon.constBits()), icon.bytesPerLine()).clone();
+                sync_call_overlays();
             });
         }
     } catch (const std::exception& e) {
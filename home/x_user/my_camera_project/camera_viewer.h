@@ -40,7 +40,6 @@
 #include <iostream>
 #include <string>
 #include <chrono>
-#include <zbar.h> // For QR code decoding
 #include <iomanip>
 #include <sstream>
 #include <openssl/aes.h>
@@ -57,6 +56,10 @@
 #include "WiFiManager.h"
 #include "Logger.h"
 #include "camerareader.h"
+#include "qrscanner.h"
+#include "framemailbox.h"
+#include "videosurface.h"
+#include "frametrace.h"
 #include "speechThread.h"
 #include "power_management.h"
 #include "PDFCreator.h"
@@ -129,12 +132,16 @@ public:
     QString splitTextIntoLines(const QString& text, int maxWidth, const QFont& font);
     void setTextWithWrapping(const QString& text);
     void drawTaskList();
+    void sync_call_overlays();
     void start_qrcode();
     void stop_qrcode();
+    int apply_capture_profile(const std::string& _profile);
+    void present_frame(int _view, const cv::Mat& _frame);
+    void present_image(int _view, const QImage& _image);
     std::string base64_decode_openssl(const std::string &encoded);
     std::string aes_decrypt_ecb(const std::string &cipherText, const std::string &key);
     std::string removePadding(const std::string &input, const std::string &padding);    
-    void processQRCode(cv::Mat _frame);
+    void processQRCode(const std::string& _payload);
     void batteryiconchange(PowerManagement::BatteryStatus _status);
     void complete_standalone_transition(bool _NOWIFI);
     QHBoxLayout* createSliderControl(const QString &name, int min, int max, int value, QSlider*& slider);
@@ -149,11 +156,24 @@ private slots:
     void finish_helping();
     void checkwifi();
     void handleIMUClassification(const QString& label);
+    void report_frame_trace();
 
 private:
     QGraphicsScene *videoScene, *videoScene1, *videoScene2;
     QGraphicsPixmapItem *videoPixmapItem, *videoPixmapItem1, *videoPixmapItem2;
     QGraphicsView *videoView, *videoView1, *videoView2;
+    // OpenGL surfaces used instead of the views above when video_surface is 1 and GL is available
+    VideoSurface *videoSurface = nullptr, *videoSurface1 = nullptr, *videoSurface2 = nullptr;
+    bool use_gl_surface = false;
+    // UI-thread cost of presenting a frame, per view (0 camera, 1 video, 2 standalone camera)
+    struct PresentStats {
+        uint64_t frames = 0;
+        double total_ms = 0;
+        double max_ms = 0;
+    } present_stats[3];
+    QWidget* video_widget(int _view);
+    VideoSurface* video_surface(int _view);
+    void record_present(int _view, std::chrono::steady_clock::time_point _start);
     QLabel *avatarLabel;
     QLabel *wifiLabel;
     QLabel *batteryLabel;
@@ -182,6 +202,10 @@ private:
     WiFiManager network;
     PowerManagement pm;
     std::unique_ptr<speechThread> voiceThread;
+    // Latest camera / video frame waiting for the GUI thread. The threads posting into them
+    // are stopped and the mailboxes drained in ~CameraViewer, before the threads are destroyed
+    FrameMailbox cameraMailbox{"camera"};
+    FrameMailbox videoMailbox{"video"};
     std::unique_ptr<Camerareader> cameraThread;
     std::unique_ptr<Videocontroller> videoThread;
     std::unique_ptr<IMUClassifierThread> imuThread;
@@ -195,11 +219,10 @@ private:
     QTimer *standbytimer;
     QTimer *clicktimer;
     QTimer *helptimer;
-    cv::Mat resized_image;
-    cv::Mat cropped_image;
-    cv::Mat cropped_image_scaled;
-    cv::Mat gray_img;
-    zbar::ImageScanner scanner;
+    QTimer *tracetimer;
+    int trace_seconds = 0;
+    // Scans the qrcode frame bus subscription on its thread, payloads come back to processQRCode()
+    QrScanner qrScanner;
     QPixmap pixmap, pixmap1;
     QImage image;
     PDFCreator pdf;
@@ -214,6 +237,8 @@ private:
     cv::Point bottom_right;
     int Swidth, Sheight;
     std::mutex battery_mutex;
+    // Battery icon drawn into the composed call frame, BGRA
+    cv::Mat battery_icon;
     int old_values[4] = {5000,25,1024,768};
     QSlider *headphoneSlider;
     QSlider *captureSlider;
@@ -243,7 +268,8 @@ private:
     pid_t gstreamer_pid = -1;
     bool entering_standalone = false;
     std::string _ipstream = "";
-    int qrcode_counter = 0;
+    int qrcodeSub = 0;
+    std::string capture_profile = "standby";
 
 };
 
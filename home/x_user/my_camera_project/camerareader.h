@@ -6,32 +6,82 @@
 #include <string>
 #include <fstream>
 #include <queue>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <atomic>
+#include <cmath>
 #include "Logger.h"
-#include "Timer.h"
 #include <functional>
 #include <sstream>
-#include <boost/lockfree/queue.hpp>
 #include <QTime>
 #include <QElapsedTimer>
 #include <chrono>
+#include <ctime>
 // Undefine the Status macro before including OpenCV to prevent conflict with X11
 #undef Status
 #include <opencv2/opencv.hpp>
+#include "framepool.h"
+#include "framebus.h"
+#include "imagekernels.h"
+#include "gstcapture.h"
+#include "gststreamer.h"
+#include "streampacer.h"
+#include "streamcontroller.h"
+#include "frametrace.h"
+#include "compositor.h"
+#include "scenemonitor.h"
 
 class Camerareader {
 public:
-    Camerareader(const std::string& _camera_pipeline, int _debug=1) :  camera_pipeline(_camera_pipeline) , frameCount(0), debugg(_debug), 
-    lastResetTime(QTime::currentTime()), period(33) {
+    // Capture cadence statistics, measured on the sensor timestamps when the pipeline provides them
+    struct CaptureStats {
+        uint64_t frames = 0;          // frames read since startCapturing
+        uint64_t dropped = 0;         // sensor frames missed, derived from timestamp gaps
+        double nominal_fps = 0;       // framerate negotiated by the pipeline
+        double fps = 0;               // delivered framerate over the last window
+        double mean_interval_ms = 0;  // mean inter-frame interval over the last window
+        double jitter_ms = 0;         // standard deviation of the inter-frame interval over the last window
+        bool sensor_clock = false;    // true when intervals come from buffer timestamps
+        double cpu_percent = 0;       // process CPU time over the last window, all threads, in percent of one core
+    };
+
+    // Capture mode switches made by reconfigure()
+    struct SwitchStats {
+        uint64_t in_place = 0;        // renegotiated without releasing the camera
+        uint64_t reopened = 0;        // fell back to release and reopen
+        uint64_t failed = 0;
+        double last_ms = 0;           // request to first frame in the new mode
+        double max_ms = 0;
+    };
+
+    // Remote video receive statistics, measured on the remote thread
+    struct RemoteStats {
+        uint64_t frames = 0;          // frames decoded since startremote
+        uint64_t stalls = 0;          // times no frame arrived for remote_stall_ms
+        double fps = 0;               // decoded framerate over the last window
+        double mean_interval_ms = 0;  // mean inter-frame interval over the last window
+        double max_interval_ms = 0;   // longest gap between two frames since startremote
+        double read_ms = 0;           // mean time in read() per frame (wait and decode) over the last window
+        bool stalled = false;
+    };
+
+    // _backend 1 reads the appsink natively (zero-copy), 0 goes through cv::VideoCapture
+    // _stream_backend 1 pushes stream frames into appsrc without copying, 0 uses cv::VideoWriter
+    Camerareader(const std::string& _camera_pipeline, int _debug=1, int _pool_size=8, int _backend=1, int _stream_backend=1) :  camera_pipeline(_camera_pipeline) , backend(_backend), stream_backend(_stream_backend), frameCount(0), debugg(_debug), 
+    lastResetTime(QTime::currentTime()), period(33), framePool("capture", _pool_size), rawPool("raw", _pool_size), compositePool("composite", 3) {
         LOG_INFO("Camerareader Constructor");
     }
 
     ~Camerareader() {
-        stopStreamingThread();
-        timer.stop();
-        cap.release();
+        stopCapturing();
+        stopremote();
+        bus.clear();
+        gstream.close();
+        scap.release();
+        releasecamera();
+        framePool.logStats();
     }
     // Deleted copy operations for thread safety
     Camerareader(const Camerareader&) = delete;
@@ -44,15 +94,33 @@ public:
     
     int init() {
         try{
-            cap.open(camera_pipeline, cv::CAP_GSTREAMER);
-            if (!cap.isOpened()) {
-                LOG_ERROR("Error: Could not open the camera.");
-                return -1;
+            double width, height, fps;
+            native = backend == 1 && gcap.open(camera_pipeline) == 0;
+            if (native) {
+                width = gcap.getWidth();
+                height = gcap.getHeight();
+                fps = gcap.getFps();
+            } else {
+                if (backend == 1)
+                    LOG_WARN("Native capture unavailable, falling back to cv::VideoCapture");
+                cap.open(camera_pipeline, cv::CAP_GSTREAMER);
+                if (!cap.isOpened()) {
+                    LOG_ERROR("Error: Could not open the camera.");
+                    return -1;
+                }
+                width = cap.get(cv::CAP_PROP_FRAME_WIDTH);
+                height = cap.get(cv::CAP_PROP_FRAME_HEIGHT);
+                fps = cap.get(cv::CAP_PROP_FPS);
             }
-            double width = cap.get(cv::CAP_PROP_FRAME_WIDTH);
-            double height = cap.get(cv::CAP_PROP_FRAME_HEIGHT);
-            double fps = cap.get(cv::CAP_PROP_FPS);
             std::cout << "width " << width << ",height " << height << ", FPS " << fps << std::endl;
+            {
+                std::lock_guard<std::mutex> lock(stats_mutex);
+                captureStats.nominal_fps = fps;
+            }
+            capture_size = cv::Size(static_cast<int>(width), static_cast<int>(height));
+            framePool.reserve(capture_size, CV_8UC3);
+            if (!native)
+                rawPool.reserve(capture_size, CV_8UC2);
             return 0;
         } catch (const std::exception& e) {
             LOG_ERROR("An error occurred in Camerareader init: " + std::string(e.what()));
@@ -60,30 +128,159 @@ public:
         }
     }
 
+    // _period is kept for compatibility only, the capture thread blocks on the
+    // appsink and wakes when the camera delivers a frame
     void startCapturing(int _period) {
+        stopCapturing();
         period =_period;
-        timer.start(period, 0, [this]() { CaptureFrame(); });
+        resetCaptureStats();
+        capturing = true;
+        captureThread = std::thread([this]() {
+            while (capturing) {
+                if (!cameraOpened()) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    continue;
+                }
+                CaptureFrame();
+            }
+        });
     }
 
     void stopCapturing() {
-        timer.stop();
+        capturing = false;
+        if (captureThread.joinable()) {
+            captureThread.join();
+            logCaptureStats();
+            framePool.logStats();
+        }
+    }
+
+    bool isCapturing() const {
+        return capturing;
+    }
+
+    bool isOpened() const {
+        return cameraOpened();
+    }
+
+    // Switches the running capture to _width x _height at _fps. The native backend renegotiates
+    // the pipeline's capsfilter in place and waits for the first frame in the new mode; otherwise
+    // the camera is released and reopened with _fallback_pipeline, as the callers used to do.
+    // _format is the GStreamer pixel format (YUY2, GRAY8), empty keeps the current one.
+    // _sensor_width/_height/_fps is the mode the camera itself runs in (0 keeps it), applied in
+    // place when the pipeline has a "sensorcaps" capsfilter.
+    int reconfigure(int _width, int _height, int _fps, const std::string& _fallback_pipeline, const std::string& _format = "",
+                    int _sensor_width = 0, int _sensor_height = 0, int _sensor_fps = 0) {
+        try {
+            auto start = std::chrono::steady_clock::now();
+            camera_pipeline = _fallback_pipeline;
+            if (native && gcap.isOpened() && gcap.reconfigure(_width, _height, _fps, _format, _sensor_width, _sensor_height, _sensor_fps) == 0) {
+                // Without a running capture thread the switch completes on the next read
+                if (!capturing || gcap.waitReconfigured(switch_timeout_ms)) {
+                    {
+                        std::lock_guard<std::mutex> lock(stats_mutex);
+                        captureStats.nominal_fps = _fps;
+                    }
+                    recordSwitch(start, true);
+                    return 0;
+                }
+                LOG_WARN("In-place capture switch timed out, reopening the camera");
+            }
+            bool was_capturing = capturing;
+            stopCapturing();
+            releasecamera();
+            if (init() == -1) {
+                std::lock_guard<std::mutex> lock(stats_mutex);
+                switchStats.failed++;
+                return -1;
+            }
+            if (was_capturing)
+                startCapturing(period);
+            recordSwitch(start, false);
+            return 0;
+        } catch (const std::exception& e) {
+            LOG_ERROR("An error occurred in Camerareader reconfigure: " + std::string(e.what()));
+            return -1;
+        }
+    }
+
+    SwitchStats getSwitchStats() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        return switchStats;
+    }
+
+    CaptureStats getCaptureStats() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        return captureStats;
     }
 
     void releasecamera() {
+        gcap.close();
         cap.release();
+        native = false;
     }
 
-    int startstream(std::string _stream_pipeline, int _fps, int _width, int _height) {
+    // _bitrate is the negotiated encoder bitrate in kbit/s and the ceiling of the adaptive
+    // controller, 0 reads it from the encoder
+    int startstream(std::string _stream_pipeline, int _fps, int _width, int _height, int _bitrate = 0) {
         try{
-            scap.open(_stream_pipeline, 0, _fps, cv::Size(_width, _height), true);
-            if (!scap.isOpened()) {
-                LOG_ERROR("Error: Could not open the streaming pipline.");
-                return -1;
+            native_stream = stream_backend == 1 && gstream.open(_stream_pipeline, _width, _height, _fps, stream_queue_limit) == 0;
+            if (!native_stream) {
+                if (stream_backend == 1)
+                    LOG_WARN("Native streaming unavailable, falling back to cv::VideoWriter");
+                scap.open(_stream_pipeline, 0, _fps, cv::Size(_width, _height), true);
+                if (!scap.isOpened()) {
+                    LOG_ERROR("Error: Could not open the streaming pipline.");
+                    return -1;
+                }
             }
             swidth = _width;
             sheight = _height;
             stream = true;
-            startStreamingThread();
+            // The stream subscriber scales on its own thread. The pacer admits frames on the
+            // capture clock at _fps before they are scaled, and may repeat the previous frame.
+            // Frames pushed natively stay referenced inside the encoder, so its pool covers them too,
+            // plus the previous frame kept for repeats.
+            pacer.reset(_fps);
+            scene.reset();
+            scene_idle = false;
+            adapting = false;
+            if (adaptive_stream && native_stream) {
+                int start_kbps = _bitrate > 0 ? _bitrate : gstream.getBitrate();
+                if (start_kbps > 0) {
+                    controller.configure(StreamController::buildLadder(_width, _height, _fps, stream_ladder), start_kbps,
+                                         stream_min_kbps, start_kbps);
+                    last_adapt = std::chrono::steady_clock::now();
+                    last_pushed = 0;
+                    last_dropped = 0;
+                    adapting = true;
+                } else {
+                    LOG_WARN("Adaptive streaming disabled, the encoder bitrate is unknown");
+                }
+            }
+            FrameBus::Options options;
+            options.name = "stream";
+            // A static scene thins the stream further, see analyzeScene()
+            options.admit = [this](double _timestamp_ms) { return pacer.admit(_timestamp_ms) && scene.admit(_timestamp_ms); };
+            options.size = cv::Size(swidth, sheight);
+            options.policy = FrameBus::Policy::LatestOnly;
+            options.pool_size = options.depth + 3 + (native_stream ? stream_queue_limit : 0);
+            streamSub = bus.subscribeTimed(options, [this](cv::Mat _frame, double _timestamp_ms) {
+                if (_frame.empty())
+                    return;
+                applySceneState();
+                if (adapting && adaptStream())
+                    return; // scaled for the previous rung
+                FrameTrace::mark(_frame, FrameTrace::Encoding);
+                int repeats = last_stream_frame.empty() ? 0 : pacer.repeatsBefore(_timestamp_ms);
+                double interval_ms = pacer.getInterval();
+                for (int i = repeats; i > 0; --i)
+                    writeStreamFrame(last_stream_frame, _timestamp_ms - i * interval_ms);
+                if (writeStreamFrame(_frame, _timestamp_ms))
+                    FrameTrace::mark(_frame, FrameTrace::Sent);
+                pacer.recordSent(repeats);
+                last_stream_frame = _frame;
+            });
             return 0;
         } catch (const std::exception& e) {
             LOG_ERROR("An error occurred in Camerareader startstream: " + std::string(e.what()));
@@ -94,26 +291,84 @@ public:
     void stopstream() {
         if (stream) {            
             stream = false;
-            stopStreamingThread();
-            // cv::Mat* frame;
-            // while (streamQueue.pop(frame)) {
-            //     if (frame && !frame->empty() && scap.isOpened()) {
-            //         scap.write(*frame);
-            //     }
-            //     delete frame; // Clean up each frame
-            // }
+            bus.unsubscribe(streamSub);
+            streamSub = 0;
+            if (scene_idle)
+                endStaticPeriod();
+            gstream.close();
+            native_stream = false;
             scap.release();
+            last_stream_frame.release();
+            pacer.logStats("stream");
+            if (scene.isEnabled())
+                scene.logStats("stream");
+            if (adapting)
+                controller.logStats("stream");
+            adapting = false;
         }
     }
 
+    // Recording and extra RTP destinations of the native stream, used by the next startstream()
+    void setStreamOutputs(const GstStreamer::Outputs& _outputs) {
+        gstream.setOutputs(_outputs);
+    }
+
+    bool isRecording() const {
+        return gstream.isRecording();
+    }
+
+    // _enabled turns the bitrate/resolution controller on for the next startstream(), _min_kbps
+    // is its lowest bitrate and _ladder the resolution/fps steps below the negotiated stream
+    void setAdaptiveStreaming(bool _enabled, int _min_kbps, const std::vector<StreamController::Rung>& _ladder) {
+        adaptive_stream = _enabled;
+        stream_min_kbps = _min_kbps;
+        stream_ladder = _ladder;
+    }
+
+    // _drop 1 sends at most one frame per stream slot, 0 sends every frame
+    // _duplicate 1 repeats the previous frame into empty slots, 0 leaves them empty
+    void setStreamPacing(int _drop, int _duplicate) {
+        pacer.setPolicies(_drop == 1 ? StreamPacer::DropPolicy::Cadence : StreamPacer::DropPolicy::None,
+                          _duplicate == 1 ? StreamPacer::DuplicatePolicy::Repeat : StreamPacer::DuplicatePolicy::None);
+    }
+
+    // Static-scene thinning of the outgoing stream, see scenemonitor.md
+    void setSceneDetection(const SceneMonitor::Settings& _settings) {
+        scene.configure(_settings);
+    }
+
+    SceneMonitor::Stats getSceneStats() {
+        return scene.getStats();
+    }
+
+    // Retransmission, FEC and keyframe request settings of the outgoing stream, used by the next startstream()
+    void setStreamProtection(const RtpProtection::Settings& _settings) {
+        gstream.setProtection(_settings);
+    }
+
+    // The same for the remote video, used by the next startremote() with an rtpbin pipeline
+    void setRemoteProtection(const RtpProtection::Settings& _settings) {
+        rgcap.setProtection(_settings);
+    }
+
+    // Every remote pipeline is read natively, so reads time out and an rtpbin session can be protected.
+    // The remote video is received on its own thread, at its own rate, independent of the camera.
     int startremote(std::string _remote_pipeline) {
         try{
-            rcap.open(_remote_pipeline, cv::CAP_GSTREAMER);
-            if (!rcap.isOpened()) {
+            stopremote();
+            // The expert may not be sending yet, the first frame is not waited for
+            if (rgcap.open(_remote_pipeline, false) != 0) {
                 LOG_ERROR("Error: Could not open the remote pipline.");
                 return -1;
             }
+            resetRemoteStats();
             remote = true;
+            applyDisplayFormat();
+            remoteThread = std::thread([this]() {
+                while (remote) {
+                    ReceiveRemoteFrame();
+                }
+            });
             return 0;
         } catch (const std::exception& e) {
             LOG_ERROR("An error occurred in Camerareader startremote: " + std::string(e.what()));
@@ -121,15 +376,142 @@ public:
         }
     }
 
+    // Remote reads time out after remote_read_timeout_ms, so the join returns within one read
     void stopremote() {
-        if (remote){
-            remote = false;
-            rcap.release();
-        }        
+        remote = false;
+        applyDisplayFormat();
+        if (remoteThread.joinable()) {
+            remoteThread.join();
+            logRemoteStats();
+            if (compositor.isEnabled())
+                compositor.logStats();
+        }
+        rgcap.close();
+        std::lock_guard<std::mutex> lock(remote_mutex);
+        remote_frame.release();
+        local_frame.release();
+    }
+
+    // Layout of the call display while remote video is active, Layout::Off shows the remote video alone
+    void setPictureInPicture(const FrameCompositor::Settings& _settings) {
+        compositor.configure(_settings);
+    }
+
+    // Overlays rendered into the composed frame, an empty text or icon removes them
+    void setOverlayText(const std::string& _id, const std::string& _text, FrameCompositor::Corner _corner, double _scale = 1.0) {
+        compositor.setText(_id, _text, _corner, _scale);
+    }
+
+    void setOverlayIcon(const std::string& _id, const cv::Mat& _icon, FrameCompositor::Corner _corner) {
+        compositor.setIcon(_id, _icon, _corner);
+    }
+
+    FrameCompositor::Stats getCompositeStats() {
+        return compositor.getStats();
+    }
+
+    bool isRemoteActive() const {
+        return remote;
+    }
+
+    // Latest decoded remote frame, false when none arrived yet or the remote video is stalled
+    bool getRemoteFrame(cv::Mat& _frame, double& _timestamp_ms) {
+        std::lock_guard<std::mutex> lock(remote_mutex);
+        if (remote_frame.empty() || remoteStats.stalled)
+            return false;
+        _frame = remote_frame;
+        _timestamp_ms = remote_timestamp_ms;
+        return true;
+    }
+
+    RemoteStats getRemoteStats() {
+        std::lock_guard<std::mutex> lock(remote_mutex);
+        return remoteStats;
     }
 
+    // The UI display is one subscriber of the frame bus, remote frames bypass it
     void setFrameCallback(std::function<void(cv::Mat)> callback) {
         Frame_callback = callback;
+        if (displaySub == 0) {
+            FrameBus::Options options;
+            options.name = "display";
+            options.policy = FrameBus::Policy::LatestOnly;
+            options.format = displayFormat();
+            displaySub = bus.subscribe(options, [this](cv::Mat _frame) {
+                if (!Frame_callback)
+                    return;
+                if (!remote) {
+                    Frame_callback(_frame);
+                    return;
+                }
+                // With remote video the local frame only feeds the compositor, which needs BGR;
+                // a raw frame taken just before the switch to BGR is skipped
+                if (!compositor.isEnabled() || _frame.type() != CV_8UC3)
+                    return;
+                cv::Mat inset;
+                {
+                    std::lock_guard<std::mutex> lock(remote_mutex);
+                    local_frame = _frame;
+                    if (!remoteStats.stalled)
+                        inset = remote_frame;
+                }
+                if (compositor.getSettings().layout == FrameCompositor::Layout::LocalMain)
+                    presentComposite(_frame, inset);
+            });
+        }
+    }
+
+    // Additional consumers (QR decoder, snapshot/report writer, analytics) subscribe here
+    // With _raw the display receives the camera's YUY2 (or GRAY8) frames as they are, for a
+    // surface that converts them itself (VideoSurface); BGR while composing remote video
+    void setRawDisplay(bool _raw) {
+        raw_display = _raw;
+        applyDisplayFormat();
+    }
+
+    int subscribe(const FrameBus::Options& _options, std::function<void(cv::Mat)> callback) {
+        return bus.subscribe(_options, callback);
+    }
+
+    void unsubscribe(int _id) {
+        bus.unsubscribe(_id);
+    }
+
+    std::vector<FrameBus::Stats> getBusStats() {
+        return bus.getStats();
+    }
+
+    FramePool::Stats getFramePoolStats() {
+        return framePool.getStats();
+    }
+
+    // Encoder queue depth and push latency of the native stream
+    GstStreamer::Stats getStreamStats() {
+        return gstream.getStats();
+    }
+
+    // Segments written and evicted by the call recorder
+    SegmentStore::Stats getRecordStats() {
+        return gstream.getRecordStats();
+    }
+
+    // Retransmissions, FEC and keyframe requests of the outgoing stream and of the remote video
+    RtpProtection::Stats getStreamProtectionStats() {
+        return gstream.getProtectionStats();
+    }
+
+    RtpProtection::Stats getRemoteProtectionStats() {
+        return rgcap.getProtectionStats();
+    }
+
+    // Bitrate, ladder rung and the loss/RTT the adaptive controller last saw
+    StreamController::Stats getAdaptiveStats() {
+        return controller.getStats();
+    }
+
+    // Frames sent, duplicated and skipped by the stream pacer
+    StreamPacer::Stats getPacingStats() {
+        return pacer.getStats();
     }
 
     bool takeSnapshotGst(const std::string& pipeline_desc) {
@@ -187,15 +569,20 @@ public:
     bool takeSnapshot(const std::string& filename) {
         try{
             cv::Mat snapshot;
-            if (frame.channels() == 2) {
-                cvtColor(frame, snapshot, cv::COLOR_YUV2BGR_YUY2);
-                cv::resize(snapshot, snapshot, cv::Size(640,480), 0, 0, cv::INTER_NEAREST);
-                cv::imwrite(filename, snapshot);
-            }            
-            else {
-                cv::resize(frame, snapshot, cv::Size(640,480), 0, 0, cv::INTER_NEAREST);
-                cv::imwrite(filename, snapshot);
+            // Latest published frame, taken under the bus lock instead of racing the capture thread.
+            // While only raw frames are published, the capture thread converts one on request.
+            cv::Mat frame = bus.latest();
+            for (int i = 0; frame.empty() && capturing && i < 50; ++i) {
+                snapshot_requested = true;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                frame = bus.latest();
             }
+            if (frame.empty()) {
+                LOG_WARN("No frame available for snapshot");
+                return false;
+            }
+            cv::resize(frame, snapshot, cv::Size(640,480), 0, 0, cv::INTER_NEAREST);
+            cv::imwrite(filename, snapshot);
             return true;
         } catch (const std::exception& e) {
             LOG_ERROR("An error occurred in Camerareader startremote: " + std::string(e.what()));
@@ -205,30 +592,261 @@ public:
 
 private:
     std::string camera_pipeline;
-    Timer timer;
+    std::thread captureThread;
+    std::atomic<bool> capturing{false};
     cv::VideoCapture cap;
+    // Native appsink reader, frames are headers on the mapped GstBuffer
+    GstCapture gcap;
+    int backend;
+    std::atomic<bool> native{false};
     cv::VideoWriter scap;
-    cv::VideoCapture rcap;
-    cv::Mat frame;
-    cv::Mat rframe;
+    // Native appsrc writer, frames are pushed as references to the stream pool
+    GstStreamer gstream;
+    int stream_backend;
+    std::atomic<bool> native_stream{false};
+    // Capture-clock pacing of the stream, and the last frame sent for repeats
+    StreamPacer pacer;
+    cv::Mat last_stream_frame;
+    // Congestion control of the native stream, run from the stream subscriber thread
+    StreamController controller;
+    std::atomic<bool> adaptive_stream{false};
+    std::atomic<bool> adapting{false};
+    int stream_min_kbps = 300;
+    std::vector<StreamController::Rung> stream_ladder;
+    std::chrono::steady_clock::time_point last_adapt;
+    uint64_t last_pushed = 0;
+    uint64_t last_dropped = 0;
+    // Static-scene detection on the capture thread; the stream subscriber lowers the bitrate
+    // while the scene is static and measures what that saved
+    SceneMonitor scene;
+    cv::Mat scene_thumb;
+    cv::Mat scene_gray;
+    bool scene_idle = false;
+    int scene_kbps = 0;
+    std::chrono::steady_clock::time_point scene_start;
+    uint64_t scene_bytes = 0;
+    uint64_t scene_held = 0;
+    // Native reader of the remote video. Its frames are mapped
+    // samples passed on through Frame_callback; they may outlive rgcap and this reader, since
+    // GstSampleAllocator is a process-wide instance.
+    GstCapture rgcap;
+    // Remote receive thread and its latest-frame slot, next to the latest local frame for the compositor
+    std::thread remoteThread;
+    std::mutex remote_mutex;
+    cv::Mat remote_frame;
+    cv::Mat local_frame;
+    double remote_timestamp_ms = -1;
+    RemoteStats remoteStats;
+    std::chrono::steady_clock::time_point remote_last;
+    std::chrono::steady_clock::time_point remote_window_start;
+    uint64_t remote_window_count = 0;
+    double remote_window_read = 0;
+    cv::Size capture_size;
     std::function<void(cv::Mat)> Frame_callback;
     int frameCount;
     int debugg;
     QTime lastResetTime;    
     int swidth, sheight;
     int period;
-    bool stream = false;
-    bool remote = false;
-    // Streaming thread support
-    boost::lockfree::queue<cv::Mat*, boost::lockfree::capacity<20>> streamQueue;
-    std::thread streamThread;
-    bool streamRunning = false;
+    std::atomic<bool> stream{false};
+    std::atomic<bool> remote{false};
+    // Preallocated buffers for converted frames and for the YUY2 frames they came from
+    FramePool framePool;
+    FramePool rawPool;
+    // Picture-in-picture output frames, composed on whichever thread delivers the main frame
+    FrameCompositor compositor;
+    FramePool compositePool;
+    // Distributes converted frames to display, stream and any other subscriber
+    FrameBus bus;
+    int displaySub = 0;
+    std::atomic<bool> raw_display{false};
+    std::atomic<bool> snapshot_requested{false};
+    int streamSub = 0;
+    // Capture cadence measurement
+    CaptureStats captureStats;
+    std::mutex stats_mutex;
+    double last_timestamp_ms = -1;
+    std::chrono::steady_clock::time_point capture_start;
+    std::chrono::steady_clock::time_point window_start;
+    std::clock_t window_cpu_start = 0;
+    uint64_t window_count = 0;
+    double window_sum = 0;
+    double window_sumsq = 0;
+    static constexpr int stats_window_ms = 10000;
+    SwitchStats switchStats;
+    static constexpr int switch_timeout_ms = 1000;
+
+    // Raw frames held by subscribers pin appsink buffers, which come from the
+    // camera's small buffer pool; beyond this many the raw frame is not published
+    static constexpr int max_raw_held = 2;
+    // Stream frames allowed inside the encoder pipeline before new ones are dropped
+    static constexpr int stream_queue_limit = 4;
+    static constexpr int adapt_period_ms = 1000;
+    // Remote reads wait at most this long, so the thread can be stopped
+    static constexpr int remote_read_timeout_ms = 100;
+    // Without a remote frame for this long the display shows the waiting screen
+    static constexpr int remote_stall_ms = 1000;
+
+    // Feeds the receiver report and the encoder queue drops to the controller once per period and
+    // applies its decision. Returns true when the stream changed size, the current frame is then stale.
+    bool adaptStream() {
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_adapt < std::chrono::milliseconds(adapt_period_ms))
+            return false;
+        last_adapt = now;
+        GstStreamer::Report report = gstream.getReceiverReport();
+        GstStreamer::Stats stream_stats = gstream.getStats();
+        StreamController::Feedback feedback;
+        feedback.report = report.fresh;
+        feedback.loss = report.fraction_lost;
+        feedback.rtt_ms = report.rtt_ms;
+        uint64_t pushed = stream_stats.pushed - last_pushed;
+        uint64_t dropped = stream_stats.dropped - last_dropped;
+        feedback.queue_drop = pushed + dropped > 0 ? static_cast<double>(dropped) / (pushed + dropped) : 0;
+        last_pushed = stream_stats.pushed;
+        last_dropped = stream_stats.dropped;
+        StreamController::Decision decision = controller.update(feedback);
+        if (decision.bitrate_changed) {
+            // While static the controller's bitrate is only noted, and scaled down like the current one
+            if (scene_idle) {
+                scene_kbps = decision.kbps;
+                gstream.setBitrate(staticBitrate(decision.kbps));
+            } else {
+                gstream.setBitrate(decision.kbps);
+            }
+            if (debugg == 1)
+                LOG_INFO("Stream bitrate " + std::to_string(decision.kbps) + " kbps, loss " + std::to_string(report.fraction_lost) +
+                         ", rtt " + std::to_string(report.rtt_ms) + " ms");
+        }
+        if (!decision.rung_changed)
+            return false;
+        StreamController::Rung rung = controller.getRung(decision.rung);
+        LOG_INFO("Stream rung " + std::to_string(decision.rung) + ": " + std::to_string(rung.width) + "x" + std::to_string(rung.height) +
+                 " @ " + std::to_string(rung.fps) + " at " + std::to_string(decision.kbps) + " kbps");
+        bus.resize(streamSub, cv::Size(rung.width, rung.height));
+        gstream.setFormat(rung.width, rung.height, rung.fps);
+        pacer.reset(rung.fps);
+        last_stream_frame.release();
+        return true;
+    }
+
+    // Luma thumbnail of the captured frame for the scene monitor, taken from the YUY2 or GRAY8
+    // source when there is one, so only the thumbnail pixels are read
+    void analyzeScene(const cv::Mat& _raw, const cv::Mat& _bgr, double _timestamp_ms) {
+        cv::Size size(SceneMonitor::thumb_width, SceneMonitor::thumb_height);
+        if (_raw.channels() == 2) {
+            ImageKernels::yuy2ToGray(_raw, scene_thumb, size);
+        } else if (_raw.channels() == 1) {
+            cv::resize(_raw, scene_thumb, size, 0, 0, cv::INTER_NEAREST);
+        } else {
+            cv::resize(_bgr, scene_gray, size, 0, 0, cv::INTER_NEAREST);
+            cv::cvtColor(scene_gray, scene_thumb, cv::COLOR_BGR2GRAY);
+        }
+        if (scene.update(scene_thumb.data, static_cast<int>(scene_thumb.step), _timestamp_ms) && debugg == 1)
+            LOG_INFO(std::string("Stream scene ") + (scene.isStatic() ? "static" : "moving") + ", change " +
+                     std::to_string(scene.getStats().last_change));
+    }
+
+    int staticBitrate(int _kbps) {
+        return std::max(1, _kbps * scene.getSettings().static_bitrate_percent / 100);
+    }
+
+    // Follows the scene monitor from the stream subscriber thread: entering a static period lowers
+    // the native encoder bitrate, the first moving frame restores it before it is encoded
+    void applySceneState() {
+        bool idle = scene.isStatic();
+        if (idle == scene_idle)
+            return;
+        if (idle) {
+            scene_idle = true;
+            scene_kbps = native_stream ? gstream.getBitrate() : 0;
+            scene_start = std::chrono::steady_clock::now();
+            scene_bytes = gstream.getStats().encoded_bytes;
+            scene_held = scene.getStats().frames_held;
+            if (scene_kbps > 0)
+                gstream.setBitrate(staticBitrate(scene_kbps));
+            if (debugg == 1)
+                LOG_INFO("Stream scene static, " + std::to_string(scene_kbps > 0 ? staticBitrate(scene_kbps) : 0) + " kbps");
+        } else {
+            endStaticPeriod();
+        }
+    }
+
+    // Restores the bitrate and credits the period's savings: bytes against the normal bitrate for
+    // the same time, encoder time as held frames at the mean encode time
+    void endStaticPeriod() {
+        scene_idle = false;
+        GstStreamer::Stats stream_stats = gstream.getStats();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - scene_start).count();
+        double bytes = 0;
+        if (scene_kbps > 0) {
+            gstream.setBitrate(scene_kbps);
+            bytes = scene_kbps * 125.0 * seconds - static_cast<double>(stream_stats.encoded_bytes - scene_bytes);
+        }
+        uint64_t held = scene.getStats().frames_held - scene_held;
+        scene.addSavings(bytes, held * stream_stats.mean_encode_ms);
+        if (debugg == 1)
+            LOG_INFO("Stream scene moving after " + std::to_string(seconds) + " s, " + std::to_string(held) + " frames held");
+    }
+
+    bool writeStreamFrame(const cv::Mat& _frame, double _timestamp_ms) {
+        if (native_stream)
+            return gstream.push(_frame, _timestamp_ms);
+        if (scap.isOpened()) {
+            scap.write(_frame);
+            return true;
+        }
+        return false;
+    }
+
+    bool cameraOpened() const {
+        return native ? gcap.isOpened() : cap.isOpened();
+    }
+
+    // Blocks until the appsink holds a new buffer. The native backend hands out the
+    // mapped buffer itself, cv::VideoCapture copies into a pooled YUY2 buffer.
+    bool readFrame(cv::Mat& _raw, double& _timestamp_ms) {
+        if (native)
+            return gcap.read(_raw, _timestamp_ms) && !_raw.empty();
+        _raw = rawPool.acquire(capture_size, CV_8UC2);
+        if (!cap.read(_raw) || _raw.empty())
+            return false;
+        _timestamp_ms = cap.get(cv::CAP_PROP_POS_MSEC);
+        return true;
+    }
 
     void CaptureFrame() {
-        if (cap.isOpened()) {          
-            cap.read(frame);
-            if (frame.channels() == 2) {
-                cvtColor(frame, frame, cv::COLOR_YUV2BGR_YUY2);
+        if (cameraOpened()) {          
+            cv::Mat raw;
+            double timestamp_ms = -1;
+            if (!readFrame(raw, timestamp_ms)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                return;
+            }
+            updateCaptureStats(timestamp_ms);
+            bool yuy2 = raw.channels() == 2;
+            // Subscribers get the YUY2 (or GRAY8) source for fused scaling/grayscale, unless the debug overlay must be kept
+            bool share_raw = (yuy2 || raw.channels() == 1) && debugg != 1 && (!native || gcap.getOutstanding() <= max_raw_held);
+            // While every subscriber takes the raw source (the display on the GL surface, QR luma)
+            // nothing is converted here; a snapshot asks for one converted frame
+            if (share_raw && !stream && !bus.needsBgr() && !snapshot_requested.exchange(false)) {
+                if (FrameTrace::enabled())
+                    FrameTrace::begin(raw, native ? gcap.lastFrameAge() : -1);
+                bus.publish(cv::Mat(), raw, timestamp_ms);
+                return;
+            }
+            // Convert straight into a pooled buffer instead of allocating a new frame
+            cv::Mat pooled = framePool.acquire(raw.size(), CV_8UC3);
+            if (pooled.empty())
+                return; // Every buffer is still held by a consumer, drop this frame
+            if (FrameTrace::enabled())
+                FrameTrace::begin(pooled, native ? gcap.lastFrameAge() : -1);
+            if (yuy2) {
+                ImageKernels::yuy2ToBgr(raw, pooled);
+            } else if (raw.channels() == 1) {
+                cv::cvtColor(raw, pooled, cv::COLOR_GRAY2BGR);
+            } else {
+                raw.copyTo(pooled);
             }
             
             if (debugg == 1) {
@@ -242,81 +860,208 @@ private:
                 int lineType = cv::LINE_AA; // For anti-aliased lines
 
                 // 3. Put Text on the Image
-                cv::putText(frame, text, org, fontFace, fontScale, color, thickness, lineType);
-            }
-            
-            if (!frame.empty()) {
-                cv::Mat* framePtr = new cv::Mat(frame); // Clone and store as raw pointer
-                if (Frame_callback) {
-                    if (remote) {
-                        CaptureRemoteFrame();
-                    } else {
-                        Frame_callback(*framePtr);
-                    }                  
-                }
-                if (stream) {
-                    cv::Mat* resizedFramePtr = new cv::Mat();
-                    cv::Size target_size(swidth, sheight);
-                    if (framePtr->size() != target_size) {
-                        cv::resize(*framePtr, *resizedFramePtr, target_size, 0, 0, cv::INTER_NEAREST);
-                    } else {
-                        *resizedFramePtr = *framePtr; // Shallow copy or assignment
-                    }
-                    if (!streamQueue.push(resizedFramePtr)) {
-                        delete resizedFramePtr; // Clean up if push fails
-                        LOG_WARN("Stream queue full, dropping frame");
-                    }
-                    delete framePtr; // Delete the original cloned frame
-                } else {
-                    delete framePtr; // Clean up if not streaming
-                }
+                cv::putText(pooled, text, org, fontFace, fontScale, color, thickness, lineType);
             }
+            FrameTrace::mark(pooled, FrameTrace::Converted);
+            if (stream && scene.isEnabled())
+                analyzeScene(raw, pooled, timestamp_ms);
+            bus.publish(pooled, share_raw ? raw : cv::Mat(), timestamp_ms);
             // LOG_INFO("Read time: ");
         }
     }
 
-    void startStreamingThread() {
-        streamRunning = true;
-        streamThread = std::thread([this]() {
-            const int target_fps = 25;
-            const auto frame_period = std::chrono::milliseconds(1000 / target_fps);
-            auto next_frame_time = std::chrono::steady_clock::now();
+    FrameBus::Format displayFormat() const {
+        return raw_display && !remote ? FrameBus::Format::RAW : FrameBus::Format::BGR;
+    }
+
+    void applyDisplayFormat() {
+        if (displaySub != 0)
+            bus.setFormat(displaySub, displayFormat());
+    }
+
+    void recordSwitch(std::chrono::steady_clock::time_point _start, bool _in_place) {
+        double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            if (_in_place)
+                switchStats.in_place++;
+            else
+                switchStats.reopened++;
+            switchStats.last_ms = latency;
+            switchStats.max_ms = std::max(switchStats.max_ms, latency);
+        }
+        LOG_INFO("Capture switch " + std::string(_in_place ? "in place" : "by reopen") + " took " + std::to_string(latency) + " ms");
+    }
 
-            while (streamRunning) {
-                cv::Mat* frameToStream = nullptr;
-                cv::Mat* lastFrame = nullptr;
+    void resetCaptureStats() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        double nominal = captureStats.nominal_fps;
+        captureStats = CaptureStats();
+        captureStats.nominal_fps = nominal;
+        last_timestamp_ms = -1;
+        capture_start = std::chrono::steady_clock::now();
+        window_start = capture_start;
+        window_cpu_start = std::clock();
+        window_count = 0;
+        window_sum = 0;
+        window_sumsq = 0;
+    }
 
-                // Always get the latest frame available
-                while (streamQueue.pop(frameToStream)) {
-                    if (lastFrame) delete lastFrame; // Drop previously stored frame
-                    lastFrame = frameToStream;       // Keep newest frame
+    // _timestamp_ms is the buffer timestamp reported by the pipeline, <= 0 when unavailable
+    void updateCaptureStats(double _timestamp_ms) {
+        auto now = std::chrono::steady_clock::now();
+        bool report = false;
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            bool sensor = _timestamp_ms > 0;
+            double t = sensor ? _timestamp_ms : std::chrono::duration<double, std::milli>(now - capture_start).count();
+            if (last_timestamp_ms >= 0 && t > last_timestamp_ms) {
+                double interval = t - last_timestamp_ms;
+                window_count++;
+                window_sum += interval;
+                window_sumsq += interval * interval;
+                if (captureStats.nominal_fps > 0) {
+                    double nominal_interval = 1000.0 / captureStats.nominal_fps;
+                    if (interval > 1.5 * nominal_interval)
+                        captureStats.dropped += static_cast<uint64_t>(std::lround(interval / nominal_interval)) - 1;
                 }
-                if (lastFrame && !lastFrame->empty() && scap.isOpened()) {
-                    scap.write(*lastFrame);
-                    delete lastFrame;
+            }
+            last_timestamp_ms = t;
+            captureStats.sensor_clock = sensor;
+            captureStats.frames++;
+            if (std::chrono::duration_cast<std::chrono::milliseconds>(now - window_start).count() >= stats_window_ms) {
+                if (window_count > 0 && window_sum > 0) {
+                    double mean = window_sum / window_count;
+                    captureStats.mean_interval_ms = mean;
+                    captureStats.fps = 1000.0 / mean;
+                    captureStats.jitter_ms = std::sqrt(std::max(0.0, window_sumsq / window_count - mean * mean));
                 }
-                // Sleep until next 40ms interval
-                next_frame_time += frame_period;
-                std::this_thread::sleep_until(next_frame_time);
+                // Sensor mode and conversion cost of the current capture profile
+                std::clock_t cpu_now = std::clock();
+                double window_ms = std::chrono::duration<double, std::milli>(now - window_start).count();
+                if (window_ms > 0)
+                    captureStats.cpu_percent = 100.0 * (1000.0 * (cpu_now - window_cpu_start) / CLOCKS_PER_SEC) / window_ms;
+                window_cpu_start = cpu_now;
+                window_start = now;
+                window_count = 0;
+                window_sum = 0;
+                window_sumsq = 0;
+                report = true;
             }
-        });
+        }
+        if (report)
+            logCaptureStats();
     }
 
-    void CaptureRemoteFrame() {
-        if (rcap.isOpened()) {
-            rcap.read(rframe);
-            if (!rframe.empty()) {
-                Frame_callback(rframe);
-            } else {
-                Frame_callback(cv::Mat());
-            }
-        }
+    void logCaptureStats() {
+        CaptureStats _stats = getCaptureStats();
+        LOG_INFO("Capture frames " + std::to_string(_stats.frames) +
+                 ", fps " + std::to_string(_stats.fps) + " (nominal " + std::to_string(_stats.nominal_fps) + ")" +
+                 ", interval " + std::to_string(_stats.mean_interval_ms) + " ms" +
+                 ", jitter " + std::to_string(_stats.jitter_ms) + " ms" +
+                 ", dropped " + std::to_string(_stats.dropped) +
+                 ", cpu " + std::to_string(_stats.cpu_percent) + "%" +
+                 (_stats.sensor_clock ? ", sensor clock" : ", arrival clock"));
     }
-    
-    void stopStreamingThread() {
-        streamRunning = false;
-        if (streamThread.joinable()) {
-            streamThread.join();
+
+    void resetRemoteStats() {
+        compositor.resetStats();
+        std::lock_guard<std::mutex> lock(remote_mutex);
+        remoteStats = RemoteStats();
+        remote_frame.release();
+        remote_timestamp_ms = -1;
+        remote_last = std::chrono::steady_clock::now();
+        remote_window_start = remote_last;
+        remote_window_count = 0;
+        remote_window_read = 0;
+    }
+
+    // Composes _main with _inset into a pooled frame and hands it to the display
+    void presentComposite(const cv::Mat& _main, const cv::Mat& _inset) {
+        cv::Mat out = compositePool.acquire(_main.size(), CV_8UC3);
+        if (out.empty())
+            return;
+        if (compositor.compose(_main, _inset, out))
+            Frame_callback(out);
+    }
+
+    void logRemoteStats() {
+        RemoteStats _stats = getRemoteStats();
+        LOG_INFO("Remote frames " + std::to_string(_stats.frames) +
+                 ", fps " + std::to_string(_stats.fps) +
+                 ", interval " + std::to_string(_stats.mean_interval_ms) + " ms (max " + std::to_string(_stats.max_interval_ms) + " ms)" +
+                 ", read " + std::to_string(_stats.read_ms) + " ms" +
+                 ", stalls " + std::to_string(_stats.stalls));
+    }
+
+    // One read on the remote thread: a new frame goes to the slot and to the display,
+    // a stall is reported once with an empty frame so the display shows the waiting screen
+    void ReceiveRemoteFrame() {
+        try {
+            cv::Mat frame;
+            double timestamp_ms = -1;
+            auto start = std::chrono::steady_clock::now();
+            bool received = false;
+            if (rgcap.isOpened())
+                received = rgcap.read(frame, timestamp_ms, remote_read_timeout_ms);
+            auto now = std::chrono::steady_clock::now();
+            bool stalled_now = false;
+            bool recovered = false;
+            bool report = false;
+            {
+                std::lock_guard<std::mutex> lock(remote_mutex);
+                double gap = std::chrono::duration<double, std::milli>(now - remote_last).count();
+                if (received) {
+                    remote_frame = frame;
+                    remote_timestamp_ms = timestamp_ms;
+                    remoteStats.frames++;
+                    remoteStats.max_interval_ms = remoteStats.frames > 1 ? std::max(remoteStats.max_interval_ms, gap) : 0;
+                    recovered = remoteStats.stalled;
+                    remoteStats.stalled = false;
+                    remote_last = now;
+                    remote_window_count++;
+                    remote_window_read += std::chrono::duration<double, std::milli>(now - start).count();
+                    double window = std::chrono::duration<double, std::milli>(now - remote_window_start).count();
+                    if (window >= stats_window_ms) {
+                        remoteStats.fps = remote_window_count * 1000.0 / window;
+                        remoteStats.mean_interval_ms = window / remote_window_count;
+                        remoteStats.read_ms = remote_window_read / remote_window_count;
+                        remote_window_start = now;
+                        remote_window_count = 0;
+                        remote_window_read = 0;
+                        report = true;
+                    }
+                } else if (!remoteStats.stalled && gap >= remote_stall_ms) {
+                    remoteStats.stalled = true;
+                    remoteStats.stalls++;
+                    stalled_now = true;
+                }
+            }
+            if (stalled_now)
+                LOG_WARN("Remote video stalled, no frame for " + std::to_string(remote_stall_ms) + " ms");
+            if (recovered)
+                LOG_INFO("Remote video resumed");
+            if (report)
+                logRemoteStats();
+            if (Frame_callback && (received || stalled_now)) {
+                FrameCompositor::Layout layout = compositor.getSettings().layout;
+                if (received && layout == FrameCompositor::Layout::RemoteMain) {
+                    cv::Mat inset;
+                    {
+                        std::lock_guard<std::mutex> lock(remote_mutex);
+                        inset = local_frame;
+                    }
+                    presentComposite(frame, inset);
+                } else if (layout != FrameCompositor::Layout::LocalMain) {
+                    // Local-main layouts keep showing the camera, without the inset, while the remote video stalls
+                    Frame_callback(received ? frame : cv::Mat());
+                }
+            }
+            // A read after end of stream returns at once
+            if (!received && (std::chrono::steady_clock::now() - start) < std::chrono::milliseconds(remote_read_timeout_ms / 2))
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        } catch (const std::exception& e) {
+            LOG_ERROR("An error occurred in Camerareader ReceiveRemoteFrame: " + std::string(e.what()));
         }
     }
 };
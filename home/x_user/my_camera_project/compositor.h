@@ -0,0 +1,260 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include "Logger.h"
+// Undefine the Status macro before including OpenCV to prevent conflict with X11
+#undef Status
+#include <opencv2/opencv.hpp>
+
+// Picture-in-picture compositor for the call display. One output frame is built
+// from a main frame (remote expert or local camera) and a scaled inset of the
+// other, with the text and icon overlays, in a single pass over the output:
+// the main frame is copied around the inset rectangle only, the inset is scaled
+// straight into its rectangle, and overlays are drawn in place. No intermediate
+// full-size frame is made.
+class FrameCompositor {
+public:
+    enum class Layout {
+        Off,         // remote video alone, as before
+        RemoteMain,  // remote full-screen, local camera inset
+        LocalMain    // local camera full-screen, remote inset
+    };
+
+    enum class Corner {
+        TopLeft,
+        TopRight,
+        BottomLeft,
+        BottomRight
+    };
+
+    struct Settings {
+        Layout layout = Layout::RemoteMain;
+        int inset_percent = 30;         // inset width in percent of the output width
+        Corner corner = Corner::BottomRight;
+        int margin = 16;                // pixels between the inset and the output edges
+        int border = 2;                 // inset frame thickness, 0 = none
+        bool counter = false;           // draws the composed frame number, like the capture debug overlay
+    };
+
+    struct Stats {
+        uint64_t composed = 0;
+        uint64_t without_inset = 0;     // composed while the inset source had no frame
+        double mean_ms = 0;
+        double max_ms = 0;
+    };
+
+    FrameCompositor() {
+        LOG_INFO("FrameCompositor Constructor");
+    }
+
+    void configure(const Settings& _settings) {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings = _settings;
+        settings.inset_percent = std::clamp(settings.inset_percent, 5, 50);
+        settings.margin = std::max(0, settings.margin);
+        settings.border = std::max(0, settings.border);
+    }
+
+    Settings getSettings() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return settings;
+    }
+
+    bool isEnabled() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return settings.layout != Layout::Off;
+    }
+
+    // Text drawn in _corner with _scale as the font scale; an empty _text removes the overlay
+    void setText(const std::string& _id, const std::string& _text, Corner _corner, double _scale = 1.0,
+                 cv::Scalar _color = cv::Scalar(0, 255, 0)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (_text.empty()) {
+            overlays.erase(_id);
+            return;
+        }
+        Overlay& overlay = overlays[_id];
+        overlay.text = _text;
+        overlay.icon.release();
+        overlay.corner = _corner;
+        overlay.scale = _scale;
+        overlay.color = _color;
+    }
+
+    // BGRA (alpha blended) or BGR icon drawn in _corner; an empty _icon removes the overlay
+    void setIcon(const std::string& _id, const cv::Mat& _icon, Corner _corner) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (_icon.empty() || (_icon.type() != CV_8UC4 && _icon.type() != CV_8UC3)) {
+            overlays.erase(_id);
+            return;
+        }
+        Overlay& overlay = overlays[_id];
+        overlay.text.clear();
+        overlay.icon = _icon.clone();
+        overlay.corner = _corner;
+    }
+
+    void clearOverlays() {
+        std::lock_guard<std::mutex> lock(mutex);
+        overlays.clear();
+    }
+
+    // Composes _main with _inset scaled into its corner into _out, which must already have the
+    // output size and type CV_8UC3 (a pooled buffer). _inset may be empty, then only _main and
+    // the overlays are drawn. _main and _inset are only read.
+    bool compose(const cv::Mat& _main, const cv::Mat& _inset, cv::Mat& _out) {
+        try {
+            if (_main.empty() || _out.empty() || _main.type() != CV_8UC3 || _out.type() != CV_8UC3)
+                return false;
+            std::lock_guard<std::mutex> lock(mutex);
+            auto start = std::chrono::steady_clock::now();
+            bool inset = !_inset.empty() && _inset.type() == CV_8UC3;
+            cv::Rect rect = inset ? insetRect(_out.size(), _inset.size(), settings) : cv::Rect();
+            if (_main.size() == _out.size()) {
+                copyAround(_main, _out, rect);
+            } else {
+                cv::resize(_main, _out, _out.size(), 0, 0, cv::INTER_LINEAR);
+            }
+            if (inset && rect.area() > 0) {
+                cv::Mat target = _out(rect);
+                cv::resize(_inset, target, rect.size(), 0, 0, cv::INTER_AREA);
+                if (settings.border > 0)
+                    cv::rectangle(_out, rect, cv::Scalar(255, 255, 255), settings.border);
+            } else {
+                stats.without_inset++;
+            }
+            stats.composed++;
+            if (settings.counter)
+                drawText(_out, std::to_string(stats.composed), Corner::TopLeft, 2.0, cv::Scalar(0, 255, 0));
+            for (const auto& entry : overlays) {
+                if (!entry.second.icon.empty())
+                    drawIcon(_out, entry.second.icon, entry.second.corner);
+                else
+                    drawText(_out, entry.second.text, entry.second.corner, entry.second.scale, entry.second.color);
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            stats.mean_ms += (ms - stats.mean_ms) / stats.composed;
+            stats.max_ms = std::max(stats.max_ms, ms);
+            return true;
+        } catch (const std::exception& e) {
+            LOG_ERROR("An error occurred in FrameCompositor compose: " + std::string(e.what()));
+            return false;
+        }
+    }
+
+    // Inset rectangle for an _inset_size source in an _out_size frame, keeping the source aspect
+    static cv::Rect insetRect(cv::Size _out_size, cv::Size _inset_size, const Settings& _settings) {
+        if (_inset_size.width <= 0 || _inset_size.height <= 0)
+            return cv::Rect();
+        int width = _out_size.width * _settings.inset_percent / 100;
+        int height = width * _inset_size.height / _inset_size.width;
+        width = std::min(width, _out_size.width - 2 * _settings.margin);
+        height = std::min(height, _out_size.height - 2 * _settings.margin);
+        if (width <= 0 || height <= 0)
+            return cv::Rect();
+        cv::Point origin = place(_out_size, cv::Size(width, height), _settings.corner, _settings.margin);
+        return cv::Rect(origin, cv::Size(width, height));
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    void resetStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats = Stats();
+    }
+
+    void logStats() {
+        Stats _stats = getStats();
+        LOG_INFO("FrameCompositor composed " + std::to_string(_stats.composed) + " (without inset " + std::to_string(_stats.without_inset) +
+                 "), mean " + std::to_string(_stats.mean_ms) + " ms, max " + std::to_string(_stats.max_ms) + " ms");
+    }
+
+private:
+    struct Overlay {
+        std::string text;
+        cv::Mat icon;
+        Corner corner = Corner::TopLeft;
+        double scale = 1.0;
+        cv::Scalar color;
+    };
+
+    Settings settings;
+    // Ordered by id, so overlays in the same corner keep their stacking
+    std::map<std::string, Overlay> overlays;
+    Stats stats;
+    std::mutex mutex;
+    static constexpr int overlay_margin = 10;
+
+    static cv::Point place(cv::Size _out_size, cv::Size _size, Corner _corner, int _margin) {
+        bool right = _corner == Corner::TopRight || _corner == Corner::BottomRight;
+        bool bottom = _corner == Corner::BottomLeft || _corner == Corner::BottomRight;
+        return cv::Point(right ? _out_size.width - _size.width - _margin : _margin,
+                         bottom ? _out_size.height - _size.height - _margin : _margin);
+    }
+
+    // Copies _src into _dst except inside _hole, which the inset overwrites anyway
+    static void copyAround(const cv::Mat& _src, cv::Mat& _dst, const cv::Rect& _hole) {
+        cv::Rect hole = _hole & cv::Rect(0, 0, _src.cols, _src.rows);
+        if (hole.area() == 0) {
+            _src.copyTo(_dst);
+            return;
+        }
+        std::vector<cv::Rect> bands = {
+            cv::Rect(0, 0, _src.cols, hole.y),
+            cv::Rect(0, hole.y + hole.height, _src.cols, _src.rows - hole.y - hole.height),
+            cv::Rect(0, hole.y, hole.x, hole.height),
+            cv::Rect(hole.x + hole.width, hole.y, _src.cols - hole.x - hole.width, hole.height)};
+        for (const cv::Rect& band : bands) {
+            if (band.area() == 0)
+                continue;
+            cv::Mat target = _dst(band);
+            _src(band).copyTo(target);
+        }
+    }
+
+    static void drawText(cv::Mat& _out, const std::string& _text, Corner _corner, double _scale, cv::Scalar _color) {
+        int baseline = 0;
+        int thickness = std::max(1, static_cast<int>(_scale * 2));
+        cv::Size size = cv::getTextSize(_text, cv::FONT_HERSHEY_SIMPLEX, _scale, thickness, &baseline);
+        cv::Point origin = place(_out.size(), cv::Size(size.width, size.height + baseline), _corner, overlay_margin);
+        origin.y += size.height;
+        // Dark outline first, so the text stays readable on any background
+        cv::putText(_out, _text, origin, cv::FONT_HERSHEY_SIMPLEX, _scale, cv::Scalar(0, 0, 0), thickness + 2, cv::LINE_AA);
+        cv::putText(_out, _text, origin, cv::FONT_HERSHEY_SIMPLEX, _scale, _color, thickness, cv::LINE_AA);
+    }
+
+    static void drawIcon(cv::Mat& _out, const cv::Mat& _icon, Corner _corner) {
+        if (_icon.cols > _out.cols - 2 * overlay_margin || _icon.rows > _out.rows - 2 * overlay_margin)
+            return;
+        cv::Rect rect(place(_out.size(), _icon.size(), _corner, overlay_margin), _icon.size());
+        cv::Mat target = _out(rect);
+        if (_icon.channels() == 3) {
+            _icon.copyTo(target);
+            return;
+        }
+        for (int y = 0; y < _icon.rows; ++y) {
+            const uint8_t* s = _icon.ptr<uint8_t>(y);
+            uint8_t* d = target.ptr<uint8_t>(y);
+            for (int x = 0; x < _icon.cols; ++x, s += 4, d += 3) {
+                int a = s[3];
+                if (a == 0)
+                    continue;
+                d[0] = static_cast<uint8_t>((s[0] * a + d[0] * (255 - a)) / 255);
+                d[1] = static_cast<uint8_t>((s[1] * a + d[1] * (255 - a)) / 255);
+                d[2] = static_cast<uint8_t>((s[2] * a + d[2] * (255 - a)) / 255);
+            }
+        }
+    }
+};
+#endif // COMPOSITOR_H
@@ -0,0 +1,376 @@
+#ifndef FRAMEBUS_H
+#define FRAMEBUS_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include "Logger.h"
+// Undefine the Status macro before including OpenCV to prevent conflict with X11
+#undef Status
+#include <opencv2/opencv.hpp>
+#include "framepool.h"
+#include "imagekernels.h"
+#include "frametrace.h"
+
+// Distributes every captured frame to any number of subscribers.
+// Each subscriber owns a delivery thread, a small mailbox and (when it asks for
+// a different resolution) its own FramePool, so publish() only enqueues headers
+// and a slow consumer can never stall capture or the other subscribers.
+class FrameBus {
+public:
+    enum class Policy {
+        LatestOnly, // keep only the newest undelivered frame
+        Queue       // keep up to depth frames, dropping the oldest
+    };
+
+    enum class Format {
+        BGR,  // 3-channel colour frame
+        GRAY, // luma only, taken straight from YUY2 when the publisher provides it
+        RAW   // the publisher's YUY2 (or GRAY8) source as is when given at the delivered size, BGR otherwise
+    };
+
+    struct Options {
+        std::string name;
+        double max_fps = 0;         // 0 = every published frame
+        cv::Size size;              // empty = publisher resolution
+        Policy policy = Policy::LatestOnly;
+        int depth = 1;              // only used by Policy::Queue
+        Format format = Format::BGR;
+        int pool_size = 0;          // converted buffers, 0 = depth + 2; raise it when frames are held after the callback
+        std::function<bool(double)> admit;  // optional filter on the capture timestamp, runs before conversion
+    };
+
+    struct Stats {
+        std::string name;
+        uint64_t offered = 0;       // frames published while subscribed
+        uint64_t rate_limited = 0;  // skipped by max_fps
+        uint64_t dropped = 0;       // superseded in the mailbox before delivery
+        uint64_t delivered = 0;     // handed to the callback
+    };
+
+    FrameBus() {
+        LOG_INFO("FrameBus Constructor");
+    }
+
+    ~FrameBus() {
+        clear();
+    }
+
+    // Deleted copy operations, the bus owns the subscriber threads
+    FrameBus(const FrameBus&) = delete;
+    FrameBus& operator=(const FrameBus&) = delete;
+
+    int subscribe(const Options& _options, std::function<void(cv::Mat)> callback) {
+        return subscribeTimed(_options, [callback](cv::Mat _frame, double) {
+            if (callback)
+                callback(_frame);
+        });
+    }
+
+    // Same as subscribe(), the callback also receives the capture timestamp given to publish()
+    int subscribeTimed(const Options& _options, std::function<void(cv::Mat, double)> callback) {
+        auto sub = std::make_shared<Subscriber>(_options, callback);
+        {
+            std::lock_guard<std::mutex> lock(subs_mutex);
+            sub->id = ++last_id;
+            subscribers.push_back(sub);
+        }
+        sub->worker = std::thread([sub]() { sub->run(); });
+        LOG_INFO("FrameBus subscribe " + _options.name + " id " + std::to_string(sub->id));
+        return sub->id;
+    }
+
+    void unsubscribe(int _id) {
+        std::shared_ptr<Subscriber> sub;
+        {
+            std::lock_guard<std::mutex> lock(subs_mutex);
+            for (auto it = subscribers.begin(); it != subscribers.end(); ++it) {
+                if ((*it)->id == _id) {
+                    sub = *it;
+                    subscribers.erase(it);
+                    break;
+                }
+            }
+        }
+        if (sub) {
+            sub->stop();
+            sub->logStats();
+        }
+    }
+
+    // Changes the delivered resolution of a subscriber, frames already waiting keep theirs
+    void resize(int _id, cv::Size _size) {
+        std::lock_guard<std::mutex> lock(subs_mutex);
+        for (auto& sub : subscribers) {
+            if (sub->id == _id) {
+                std::lock_guard<std::mutex> sub_lock(sub->mutex);
+                sub->options.size = _size;
+            }
+        }
+    }
+
+    // Changes the delivered format of a subscriber, frames already waiting are converted to it
+    void setFormat(int _id, Format _format) {
+        std::lock_guard<std::mutex> lock(subs_mutex);
+        for (auto& sub : subscribers) {
+            if (sub->id == _id) {
+                std::lock_guard<std::mutex> sub_lock(sub->mutex);
+                sub->options.format = _format;
+            }
+        }
+    }
+
+    // True when a subscriber needs the BGR frame even if the raw source is published, so the
+    // publisher can skip the conversion while every subscriber takes raw or grayscale frames
+    bool needsBgr() {
+        std::lock_guard<std::mutex> lock(subs_mutex);
+        for (auto& sub : subscribers) {
+            std::lock_guard<std::mutex> sub_lock(sub->mutex);
+            if (sub->options.format == Format::BGR)
+                return true;
+        }
+        return false;
+    }
+
+    void clear() {
+        std::vector<std::shared_ptr<Subscriber>> old;
+        {
+            std::lock_guard<std::mutex> lock(subs_mutex);
+            old.swap(subscribers);
+        }
+        for (auto& sub : old) {
+            sub->stop();
+            sub->logStats();
+        }
+    }
+
+    // Never blocks on a subscriber, only takes each mailbox lock long enough to swap a header.
+    // _raw is the optional YUY2 (or GRAY8) source of _frame; subscribers that scale or want
+    // grayscale convert from it in one pass instead of re-processing the BGR frame. _frame may
+    // be empty when _raw is given and needsBgr() is false; latest() is then empty as well.
+    // _timestamp_ms is the capture timestamp (pipeline running time), -1 when unknown.
+    void publish(const cv::Mat& _frame, const cv::Mat& _raw = cv::Mat(), double _timestamp_ms = -1) {
+        {
+            std::lock_guard<std::mutex> lock(latest_mutex);
+            latest_frame = _frame;
+        }
+        std::vector<std::shared_ptr<Subscriber>> current;
+        {
+            std::lock_guard<std::mutex> lock(subs_mutex);
+            current = subscribers;
+        }
+        auto now = std::chrono::steady_clock::now();
+        for (auto& sub : current) {
+            sub->offer(_frame, _raw, _timestamp_ms, now);
+        }
+    }
+
+    // Last published frame, shared with the subscribers so it must be treated as read-only
+    cv::Mat latest() {
+        std::lock_guard<std::mutex> lock(latest_mutex);
+        return latest_frame;
+    }
+
+    void resetLatest() {
+        std::lock_guard<std::mutex> lock(latest_mutex);
+        latest_frame.release();
+    }
+
+    std::vector<Stats> getStats() {
+        std::vector<Stats> result;
+        std::lock_guard<std::mutex> lock(subs_mutex);
+        for (auto& sub : subscribers) {
+            result.push_back(sub->getStats());
+        }
+        return result;
+    }
+
+    void logStats() {
+        std::lock_guard<std::mutex> lock(subs_mutex);
+        for (auto& sub : subscribers) {
+            sub->logStats();
+        }
+    }
+
+private:
+    struct Entry {
+        cv::Mat frame;
+        cv::Mat raw;
+        double timestamp_ms = -1;
+    };
+
+    struct Subscriber {
+        int id = 0;
+        Options options;
+        std::function<void(cv::Mat, double)> callback;
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::deque<Entry> mailbox;
+        bool running = true;
+        std::chrono::steady_clock::time_point last_accepted;
+        bool has_accepted = false;
+        Stats stats;
+        FramePool pool;
+
+        // options is declared before pool, so the pool is sized from the clamped depth
+        Subscriber(const Options& _options, std::function<void(cv::Mat, double)> _callback)
+            : options(clamped(_options)), callback(_callback),
+              pool(options.name, options.pool_size > 0 ? options.pool_size : options.depth + 2) {
+            stats.name = options.name;
+        }
+
+        static Options clamped(Options _options) {
+            if (_options.depth < 1)
+                _options.depth = 1;
+            return _options;
+        }
+
+        void offer(const cv::Mat& _frame, const cv::Mat& _raw, double _timestamp_ms, std::chrono::steady_clock::time_point _now) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!running)
+                    return;
+                stats.offered++;
+                if (options.max_fps > 0 && has_accepted) {
+                    auto min_gap = std::chrono::duration<double>(1.0 / options.max_fps);
+                    if (_now - last_accepted < min_gap) {
+                        stats.rate_limited++;
+                        return;
+                    }
+                }
+                if (options.admit && !options.admit(_timestamp_ms)) {
+                    stats.rate_limited++;
+                    return;
+                }
+                last_accepted = _now;
+                has_accepted = true;
+                size_t limit = options.policy == Policy::LatestOnly ? 1 : static_cast<size_t>(options.depth);
+                while (mailbox.size() >= limit) {
+                    mailbox.pop_front();
+                    stats.dropped++;
+                }
+                mailbox.push_back(Entry{_frame, _raw, _timestamp_ms});
+            }
+            wakeup.notify_one();
+        }
+
+        void run() {
+            while (true) {
+                Entry next;
+                cv::Size size;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wakeup.wait(lock, [this]() { return !running || !mailbox.empty(); });
+                    if (!running)
+                        break;
+                    next = mailbox.front();
+                    mailbox.pop_front();
+                    size = options.size;
+                }
+                try {
+                    cv::Mat out = convert(next, size);
+                    if ((!next.frame.empty() || !next.raw.empty()) && out.empty())
+                        continue; // pool exhausted
+                    FrameTrace::derive(next.frame.empty() ? next.raw : next.frame, out);
+                    if (callback)
+                        callback(out, next.timestamp_ms);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stats.delivered++;
+                } catch (const std::exception& e) {
+                    LOG_ERROR("FrameBus subscriber " + options.name + " error: " + std::string(e.what()));
+                }
+            }
+        }
+
+        // Produces the frame in the subscriber's format and size, using the fused
+        // YUY2 kernels when the raw frame is available
+        cv::Mat convert(const Entry& _entry, cv::Size _size) {
+            bool bgr = !_entry.frame.empty();
+            if (!bgr && _entry.raw.empty())
+                return _entry.frame;
+            cv::Size source = bgr ? _entry.frame.size() : _entry.raw.size();
+            cv::Size size = _size.area() > 0 ? _size : source;
+            bool yuy2 = !_entry.raw.empty() && _entry.raw.type() == CV_8UC2 && _entry.raw.size() == source;
+            bool luma = !_entry.raw.empty() && _entry.raw.type() == CV_8UC1 && _entry.raw.size() == source;
+            if (options.format == Format::RAW && (yuy2 || luma) && size == source)
+                return _entry.raw;
+            if (options.format == Format::GRAY) {
+                cv::Mat gray = pool.acquire(size, CV_8UC1);
+                if (gray.empty())
+                    return gray;
+                if (yuy2) {
+                    ImageKernels::yuy2ToGray(_entry.raw, gray, size);
+                } else if (luma) {
+                    cv::resize(_entry.raw, gray, size, 0, 0, cv::INTER_NEAREST);
+                } else if (size == source) {
+                    cv::cvtColor(_entry.frame, gray, cv::COLOR_BGR2GRAY);
+                } else {
+                    cv::Mat scaled;
+                    cv::resize(_entry.frame, scaled, size, 0, 0, cv::INTER_NEAREST);
+                    cv::cvtColor(scaled, gray, cv::COLOR_BGR2GRAY);
+                }
+                return gray;
+            }
+            if (bgr && size == source)
+                return _entry.frame;
+            cv::Mat scaled = pool.acquire(size, CV_8UC3);
+            if (scaled.empty())
+                return scaled;
+            if (yuy2) {
+                ImageKernels::yuy2ToBgr(_entry.raw, scaled, size);
+            } else if (bgr) {
+                cv::resize(_entry.frame, scaled, size, 0, 0, cv::INTER_NEAREST);
+            } else {
+                cv::Mat colour;
+                cv::cvtColor(_entry.raw, colour, cv::COLOR_GRAY2BGR);
+                cv::resize(colour, scaled, size, 0, 0, cv::INTER_NEAREST);
+            }
+            return scaled;
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                running = false;
+                mailbox.clear();
+            }
+            wakeup.notify_all();
+            if (worker.joinable()) {
+                if (worker.get_id() == std::this_thread::get_id())
+                    worker.detach(); // unsubscribed from inside its own callback
+                else
+                    worker.join();
+            }
+        }
+
+        Stats getStats() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return stats;
+        }
+
+        void logStats() {
+            Stats _stats = getStats();
+            LOG_INFO("FrameBus " + _stats.name + " offered " + std::to_string(_stats.offered) +
+                     ", rate limited " + std::to_string(_stats.rate_limited) +
+                     ", dropped " + std::to_string(_stats.dropped) +
+                     ", delivered " + std::to_string(_stats.delivered));
+        }
+    };
+
+    std::vector<std::shared_ptr<Subscriber>> subscribers;
+    std::mutex subs_mutex;
+    int last_id = 0;
+    cv::Mat latest_frame;
+    std::mutex latest_mutex;
+};
+#endif // FRAMEBUS_H
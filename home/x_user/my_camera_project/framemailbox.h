@@ -0,0 +1,90 @@
+#ifndef FRAMEMAILBOX_H
+#define FRAMEMAILBOX_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <mutex>
+#include "Logger.h"
+// Undefine the Status macro before including OpenCV to prevent conflict with X11
+#undef Status
+#include <opencv2/opencv.hpp>
+
+// Single-slot latest-value mailbox between a producer thread and the Qt UI.
+// post() overwrites the slot and reports whether the consumer still has to be
+// woken, so at most one queued event per mailbox sits in the UI event loop no
+// matter how long the GUI thread stalls; frames posted meanwhile replace each
+// other and are counted as superseded.
+class FrameMailbox {
+public:
+    struct Stats {
+        uint64_t posted = 0;      // frames written by the producer
+        uint64_t superseded = 0;  // overwritten before the UI took them
+        uint64_t consumed = 0;    // taken by the UI
+    };
+
+    explicit FrameMailbox(const std::string& _name) : name(_name) {
+        LOG_INFO("FrameMailbox " + name + " Constructor");
+    }
+
+    // Deleted copy operations, the slot is shared between threads
+    FrameMailbox(const FrameMailbox&) = delete;
+    FrameMailbox& operator=(const FrameMailbox&) = delete;
+
+    // Returns true when the caller must schedule take() on the UI thread
+    bool post(const cv::Mat& _frame) {
+        std::lock_guard<std::mutex> lock(slot_mutex);
+        stats.posted++;
+        if (full)
+            stats.superseded++;
+        slot = _frame;
+        full = true;
+        if (scheduled)
+            return false;
+        scheduled = true;
+        return true;
+    }
+
+    // Takes the newest frame; false when it was already consumed
+    bool take(cv::Mat& _frame) {
+        std::lock_guard<std::mutex> lock(slot_mutex);
+        scheduled = false;
+        if (!full)
+            return false;
+        _frame = slot;
+        slot.release();
+        full = false;
+        stats.consumed++;
+        return true;
+    }
+
+    // Drops a pending frame, e.g. when the view it was meant for is hidden
+    void clear() {
+        std::lock_guard<std::mutex> lock(slot_mutex);
+        if (full)
+            stats.superseded++;
+        slot.release();
+        full = false;
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(slot_mutex);
+        return stats;
+    }
+
+    void logStats() {
+        Stats _stats = getStats();
+        LOG_INFO("FrameMailbox " + name + " posted " + std::to_string(_stats.posted) +
+                 ", superseded " + std::to_string(_stats.superseded) +
+                 ", consumed " + std::to_string(_stats.consumed));
+    }
+
+private:
+    std::string name;
+    cv::Mat slot;
+    bool full = false;
+    bool scheduled = false;
+    Stats stats;
+    std::mutex slot_mutex;
+};
+#endif // FRAMEMAILBOX_H
@@ -0,0 +1,115 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#pragma once
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include "Logger.h"
+// Undefine the Status macro before including OpenCV to prevent conflict with X11
+#undef Status
+#include <opencv2/opencv.hpp>
+
+// Fixed-size pool of preallocated frame buffers.
+// Every buffer is an ordinary cv::Mat owned by the pool; acquire() hands out a
+// shallow header so cv::Mat's own reference count tells the pool when every
+// consumer (display, stream, QR, ...) has dropped the frame and the buffer can
+// be filled again. No pixel memory is allocated once the pool is warm.
+class FramePool {
+public:
+    struct Stats {
+        uint64_t acquired = 0;   // frames handed out
+        uint64_t reused = 0;     // acquisitions served by an already sized buffer
+        uint64_t allocated = 0;  // acquisitions that had to (re)allocate pixel memory
+        uint64_t exhausted = 0;  // acquisitions that failed because every buffer was in use
+        int capacity = 0;
+        int in_use = 0;
+    };
+
+    FramePool(const std::string& _name, int _capacity = 6) : name(_name), slots(_capacity > 0 ? _capacity : 1) {
+        LOG_INFO("FramePool " + name + " Constructor, capacity " + std::to_string(slots.size()));
+    }
+
+    // Deleted copy operations, consumers keep headers into the pool buffers
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Preallocate every buffer for the given geometry so the first frames do not allocate
+    void reserve(cv::Size _size, int _type) {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        for (auto& slot : slots) {
+            if (isFree(slot))
+                slot.create(_size, _type);
+        }
+    }
+
+    // Returns a header on a free pooled buffer of the requested geometry,
+    // or an empty cv::Mat when every buffer is still referenced by a consumer.
+    cv::Mat acquire(cv::Size _size, int _type) {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        stats.acquired++;
+        cv::Mat* candidate = nullptr;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            cv::Mat& slot = slots[(next + i) % slots.size()];
+            if (!isFree(slot))
+                continue;
+            if (slot.size() == _size && slot.type() == _type) {
+                candidate = &slot;
+                next = (next + i + 1) % slots.size();
+                break;
+            }
+            if (!candidate)
+                candidate = &slot;
+        }
+        if (!candidate) {
+            stats.exhausted++;
+            if (stats.exhausted % 100 == 1)
+                LOG_WARN("FramePool " + name + " exhausted (" + std::to_string(stats.exhausted) + " times)");
+            return cv::Mat();
+        }
+        if (candidate->size() == _size && candidate->type() == _type) {
+            stats.reused++;
+        } else {
+            candidate->release();
+            candidate->create(_size, _type);
+            stats.allocated++;
+        }
+        return *candidate;
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        Stats _stats = stats;
+        _stats.capacity = static_cast<int>(slots.size());
+        _stats.in_use = 0;
+        for (auto& slot : slots) {
+            if (!isFree(slot))
+                _stats.in_use++;
+        }
+        return _stats;
+    }
+
+    void logStats() {
+        Stats _stats = getStats();
+        LOG_INFO("FramePool " + name + " capacity " + std::to_string(_stats.capacity) +
+                 ", in use " + std::to_string(_stats.in_use) +
+                 ", acquired " + std::to_string(_stats.acquired) +
+                 ", reused " + std::to_string(_stats.reused) +
+                 ", allocated " + std::to_string(_stats.allocated) +
+                 ", exhausted " + std::to_string(_stats.exhausted));
+    }
+
+private:
+    std::string name;
+    std::vector<cv::Mat> slots;
+    size_t next = 0;
+    Stats stats;
+    std::mutex pool_mutex;
+
+    // A buffer is free when the pool holds the only reference to its pixel data
+    static bool isFree(cv::Mat& slot) {
+        return slot.u == nullptr || CV_XADD(&slot.u->refcount, 0) <= 1;
+    }
+};
+#endif // FRAMEPOOL_H
@@ -0,0 +1,259 @@
+#ifndef FRAMETRACE_H
+#define FRAMETRACE_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "Logger.h"
+// Undefine the Status macro before including OpenCV to prevent conflict with X11
+#undef Status
+#include <opencv2/opencv.hpp>
+
+// Per-frame latency trace from sensor to glass and to the network.
+// A frame is identified by its buffer: begin() stamps the converted capture
+// buffer with the time the sensor produced it, derive() carries that stamp over
+// to buffers made from it (scaled copies of the frame bus), and mark() records
+// the age of the frame when it reaches a stage. Each stage keeps a rolling
+// window of the last samples, from which report() computes p50/p95/p99.
+// Every entry point returns after one relaxed atomic load while tracing is off.
+class FrameTrace {
+public:
+    enum Stage {
+        Captured,    // sensor to appsink read (pipeline clock against buffer PTS)
+        Converted,   // YUY2 converted into the pooled BGR frame
+        Dispatched,  // taken by the UI thread from its mailbox
+        Painted,     // drawn (GL surface) or handed to the view (pixmap path)
+        Encoding,    // handed to the stream encoder
+        Sent,        // accepted by the stream pipeline
+        StageCount
+    };
+
+    static bool enabled() {
+        return on.load(std::memory_order_relaxed);
+    }
+
+    static void enable(bool _on) {
+        on.store(_on, std::memory_order_relaxed);
+        LOG_INFO(std::string("FrameTrace ") + (_on ? "enabled" : "disabled"));
+    }
+
+    // _age_ms is how old the frame already was when it was read, -1 when unknown
+    static void begin(const cv::Mat& _frame, double _age_ms) {
+        if (!enabled() || _frame.empty())
+            return;
+        int64_t now = nowNs();
+        int64_t origin = _age_ms >= 0 ? now - static_cast<int64_t>(_age_ms * 1e6) : now;
+        std::lock_guard<std::mutex> lock(mutex());
+        remember(_frame.data, origin);
+        if (_age_ms >= 0)
+            push(Captured, _age_ms);
+    }
+
+    // _to was produced from _from (scaled, converted) and inherits its origin
+    static void derive(const cv::Mat& _from, const cv::Mat& _to) {
+        if (!enabled() || _from.empty() || _to.empty() || _from.data == _to.data)
+            return;
+        std::lock_guard<std::mutex> lock(mutex());
+        int64_t origin = 0;
+        if (lookup(_from.data, origin))
+            remember(_to.data, origin);
+    }
+
+    static void mark(const cv::Mat& _frame, Stage _stage) {
+        if (!enabled() || _frame.empty())
+            return;
+        int64_t now = nowNs();
+        std::lock_guard<std::mutex> lock(mutex());
+        int64_t origin = 0;
+        if (lookup(_frame.data, origin))
+            push(_stage, (now - origin) / 1e6);
+    }
+
+    // Asynchronous export request, safe to call from a signal handler
+    static void requestExport() {
+        export_requested.store(true, std::memory_order_relaxed);
+    }
+
+    static bool takeExportRequest() {
+        return export_requested.exchange(false, std::memory_order_relaxed);
+    }
+
+    // One line per stage: samples in the window, p50/p95/p99/max in ms
+    static std::string report() {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(2);
+        for (int s = 0; s < StageCount; ++s) {
+            Summary summary = summarize(static_cast<Stage>(s));
+            if (summary.count == 0)
+                continue;
+            oss << stageName(static_cast<Stage>(s)) << " n=" << summary.count << " p50=" << summary.p50
+                << " p95=" << summary.p95 << " p99=" << summary.p99 << " max=" << summary.max << " ms; ";
+        }
+        return oss.str();
+    }
+
+    // Writes the percentiles and a coarse latency histogram of every stage as JSON
+    static bool exportTo(const std::string& _path) {
+        try {
+            std::ofstream file(_path, std::ios::trunc);
+            if (!file.is_open()) {
+                LOG_ERROR("FrameTrace cannot write " + _path);
+                return false;
+            }
+            file << std::fixed << std::setprecision(3) << "{\n";
+            bool first = true;
+            for (int s = 0; s < StageCount; ++s) {
+                Summary summary = summarize(static_cast<Stage>(s));
+                if (summary.count == 0)
+                    continue;
+                file << (first ? "" : ",\n") << "  \"" << stageName(static_cast<Stage>(s)) << "\": { \"count\": " << summary.count
+                     << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+                     << ", \"max\": " << summary.max << ", \"histogram_ms\": {";
+                for (size_t b = 0; b < bucket_limits.size(); ++b) {
+                    file << (b ? ", " : " ") << "\"" << (b + 1 < bucket_limits.size() ? "<" + std::to_string(static_cast<int>(bucket_limits[b])) : "inf")
+                         << "\": " << summary.buckets[b];
+                }
+                file << " } }";
+                first = false;
+            }
+            file << "\n}\n";
+            LOG_INFO("FrameTrace exported to " + _path);
+            return true;
+        } catch (const std::exception& e) {
+            LOG_ERROR("An error occurred in FrameTrace exportTo: " + std::string(e.what()));
+            return false;
+        }
+    }
+
+    static void reset() {
+        std::lock_guard<std::mutex> lock(mutex());
+        for (auto& window : windows())
+            window = Window();
+    }
+
+    static const char* stageName(Stage _stage) {
+        switch (_stage) {
+            case Captured: return "captured";
+            case Converted: return "converted";
+            case Dispatched: return "dispatched";
+            case Painted: return "painted";
+            case Encoding: return "encoding";
+            case Sent: return "sent";
+            default: return "unknown";
+        }
+    }
+
+private:
+    static constexpr size_t window_size = 1024;  // samples kept per stage
+    static constexpr size_t origin_slots = 64;   // buffers in flight that can be traced
+
+    struct Window {
+        std::vector<float> samples;
+        size_t next = 0;
+    };
+
+    struct Origin {
+        const uchar* key = nullptr;
+        int64_t origin_ns = 0;
+    };
+
+    struct Summary {
+        size_t count = 0;
+        double p50 = 0, p95 = 0, p99 = 0, max = 0;
+        std::array<size_t, 10> buckets{};
+    };
+
+    static inline std::atomic<bool> on{false};
+    static inline std::atomic<bool> export_requested{false};
+    static inline const std::array<double, 10> bucket_limits{1, 2, 5, 10, 20, 50, 100, 200, 500, 1e12};
+
+    static std::mutex& mutex() {
+        static std::mutex m;
+        return m;
+    }
+
+    static std::array<Window, StageCount>& windows() {
+        static std::array<Window, StageCount> w;
+        return w;
+    }
+
+    static std::array<Origin, origin_slots>& origins() {
+        static std::array<Origin, origin_slots> o;
+        return o;
+    }
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Pooled buffers are reused, so a key simply takes over the slot of its previous frame
+    static void remember(const uchar* _key, int64_t _origin) {
+        static size_t next = 0;
+        auto& slots = origins();
+        for (auto& slot : slots) {
+            if (slot.key == _key) {
+                slot.origin_ns = _origin;
+                return;
+            }
+        }
+        slots[next] = Origin{_key, _origin};
+        next = (next + 1) % origin_slots;
+    }
+
+    static bool lookup(const uchar* _key, int64_t& _origin) {
+        for (const auto& slot : origins()) {
+            if (slot.key == _key) {
+                _origin = slot.origin_ns;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void push(Stage _stage, double _ms) {
+        Window& window = windows()[_stage];
+        if (window.samples.size() < window_size) {
+            window.samples.push_back(static_cast<float>(_ms));
+        } else {
+            window.samples[window.next] = static_cast<float>(_ms);
+        }
+        window.next = (window.next + 1) % window_size;
+    }
+
+    static Summary summarize(Stage _stage) {
+        std::vector<float> samples;
+        {
+            std::lock_guard<std::mutex> lock(mutex());
+            samples = windows()[_stage].samples;
+        }
+        Summary summary;
+        summary.count = samples.size();
+        if (samples.empty())
+            return summary;
+        std::sort(samples.begin(), samples.end());
+        auto at = [&samples](double _q) {
+            return samples[std::min(samples.size() - 1, static_cast<size_t>(_q * samples.size()))];
+        };
+        summary.p50 = at(0.50);
+        summary.p95 = at(0.95);
+        summary.p99 = at(0.99);
+        summary.max = samples.back();
+        for (float sample : samples) {
+            size_t b = 0;
+            while (sample >= bucket_limits[b] && b + 1 < bucket_limits.size())
+                ++b;
+            summary.buckets[b]++;
+        }
+        return summary;
+    }
+};
+#endif // FRAMETRACE_H
@@ -0,0 +1,438 @@
+#ifndef GSTCAPTURE_H
+#define GSTCAPTURE_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cmath>
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
+#include "Logger.h"
+#include "rtpprotection.h"
+#include "gstsampleallocator.h"
+// Undefine the Status macro before including OpenCV to prevent conflict with X11
+#undef Status
+#include <opencv2/opencv.hpp>
+
+// Native appsink capture backend.
+// Pulls samples from the appsink of a gst_parse_launch pipeline and returns them
+// as cv::Mat headers on the mapped buffer, replacing cv::VideoCapture and its
+// per-frame copy out of the appsink. A receiving pipeline with an rtpbin gets
+// RtpProtection: retransmission requests, FEC recovery and keyframe requests.
+class GstCapture {
+public:
+    // In-place renegotiations, latency is measured from the request to the first frame with the new caps
+    struct SwitchStats {
+        uint64_t switches = 0;
+        double last_ms = 0;
+        double max_ms = 0;
+    };
+
+    GstCapture() {
+        LOG_INFO("GstCapture Constructor");
+    }
+
+    ~GstCapture() {
+        close();
+    }
+
+    // Deleted copy operations, the pipeline is owned by this object
+    GstCapture(const GstCapture&) = delete;
+    GstCapture& operator=(const GstCapture&) = delete;
+
+    // A receiver may open before its sender starts: with _wait_first_frame false, open() does not
+    // wait for the first frame and the geometry is taken from the first frame read() returns.
+    int open(const std::string& _pipeline, bool _wait_first_frame = true) {
+        try {
+            close();
+            if (!gst_is_initialized())
+                gst_init(nullptr, nullptr);
+            GError* error = nullptr;
+            pipeline = gst_parse_launch(_pipeline.c_str(), &error);
+            if (!pipeline || error) {
+                LOG_ERROR("GstCapture failed to create pipeline: " + std::string(error ? error->message : "Unknown error"));
+                if (error) g_error_free(error);
+                close();
+                return -1;
+            }
+            appsink = findAppsink();
+            if (!appsink) {
+                LOG_ERROR("GstCapture pipeline has no appsink");
+                close();
+                return -1;
+            }
+            // Optional, lets reconfigure() change the sensor mode as well
+            sensorcaps = gst_bin_get_by_name(GST_BIN(pipeline), "sensorcaps");
+            if (protection.isEnabled() && !protection.attachReceiver(pipeline))
+                LOG_WARN("GstCapture loss protection needs an rtpbin named rtpbin, receiving unprotected");
+            if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE ||
+                gst_element_get_state(pipeline, nullptr, nullptr, 5 * GST_SECOND) == GST_STATE_CHANGE_FAILURE) {
+                LOG_ERROR("GstCapture could not start the pipeline");
+                logBusErrors();
+                close();
+                return -1;
+            }
+            if (!_wait_first_frame) {
+                LOG_INFO("GstCapture opened, waiting for the first frame");
+                return 0;
+            }
+            // The first sample fixes the negotiated geometry, keep it as the first frame
+            GstSample* sample = gst_app_sink_try_pull_sample(GST_APP_SINK(appsink), 5 * GST_SECOND);
+            if (!sample || !readCaps(gst_sample_get_caps(sample))) {
+                LOG_ERROR("GstCapture did not receive a usable first frame");
+                if (sample) gst_sample_unref(sample);
+                logBusErrors();
+                close();
+                return -1;
+            }
+            pending = sample;
+            current_caps = gst_caps_ref(gst_sample_get_caps(sample));
+            LOG_INFO("GstCapture opened " + std::to_string(width) + "x" + std::to_string(height) + " " + format + " @ " + std::to_string(fps));
+            return 0;
+        } catch (const std::exception& e) {
+            LOG_ERROR("An error occurred in GstCapture open: " + std::string(e.what()));
+            close();
+            return -1;
+        }
+    }
+
+    void close() {
+        if (pending) {
+            gst_sample_unref(pending);
+            pending = nullptr;
+        }
+        if (current_caps) {
+            gst_caps_unref(current_caps);
+            current_caps = nullptr;
+        }
+        if (capsfilter) {
+            gst_object_unref(capsfilter);
+            capsfilter = nullptr;
+        }
+        if (sensorcaps) {
+            gst_object_unref(sensorcaps);
+            sensorcaps = nullptr;
+        }
+
+        if (appsink) {
+            gst_object_unref(appsink);
+            appsink = nullptr;
+        }
+        if (pipeline) {
+            gst_element_set_state(pipeline, GST_STATE_NULL);
+            gst_object_unref(pipeline);
+            pipeline = nullptr;
+            if (protection.isEnabled())
+                protection.logStats("capture");
+        }
+        protection.detach();
+    }
+
+    bool isOpened() const {
+        return pipeline != nullptr;
+    }
+
+    // Retransmission requests and FEC recovery of an RTP receiving pipeline, takes effect with the next open()
+    void setProtection(const RtpProtection::Settings& _settings) {
+        protection.configure(_settings);
+    }
+
+    RtpProtection::Stats getProtectionStats() {
+        return protection.getStats();
+    }
+
+    // Asks the sender for a keyframe (PLI), e.g. after the decoder reported corrupt frames
+    bool requestKeyframe() {
+        return pipeline && protection.requestKeyframe();
+    }
+
+    // Waits up to _timeout_ms for the next frame. _timestamp_ms receives the buffer PTS (-1 when unset).
+    bool read(cv::Mat& _frame, double& _timestamp_ms, int _timeout_ms = 100) {
+        if (!appsink)
+            return false;
+        GstSample* sample = pending;
+        pending = nullptr;
+        if (!sample)
+            sample = gst_app_sink_try_pull_sample(GST_APP_SINK(appsink), static_cast<GstClockTime>(_timeout_ms) * GST_MSECOND);
+        if (!sample) {
+            if (gst_app_sink_is_eos(GST_APP_SINK(appsink))) {
+                LOG_WARN("GstCapture end of stream");
+                logBusErrors();
+            }
+            return false;
+        }
+        GstCaps* caps = gst_sample_get_caps(sample);
+        if (caps && caps != current_caps) {
+            if (!current_caps || !gst_caps_is_equal(caps, current_caps)) {
+                if (!readCaps(caps)) {
+                    gst_sample_unref(sample);
+                    return false;
+                }
+                LOG_INFO("GstCapture renegotiated " + std::to_string(width) + "x" + std::to_string(height) + " @ " + std::to_string(fps));
+            }
+            if (current_caps)
+                gst_caps_unref(current_caps);
+            current_caps = gst_caps_ref(caps);
+        }
+        checkSwitch();
+        GstBuffer* buffer = gst_sample_get_buffer(sample);
+        last_pts = buffer ? GST_BUFFER_PTS(buffer) : GST_CLOCK_TIME_NONE;
+        _timestamp_ms = GST_CLOCK_TIME_IS_VALID(last_pts) ? static_cast<double>(last_pts) / GST_MSECOND : -1;
+        size_t _stride = stride;
+        if (buffer) {
+            GstVideoMeta* meta = gst_buffer_get_video_meta(buffer);
+            if (meta)
+                _stride = meta->stride[0];
+        }
+        _frame = GstSampleAllocator::instance()->wrap(sample, height, width, type, _stride, outstanding);
+        return !_frame.empty();
+    }
+
+    // Renegotiates the "capcaps" capsfilter in front of the appsink while the pipeline keeps
+    // running; videoscale/videorate upstream of it adapt, the camera itself is not reopened.
+    // Returns -1 when the pipeline has no such capsfilter. An empty _format keeps the current one.
+    // A _sensor_width > 0 also renegotiates the "sensorcaps" capsfilter behind the camera source,
+    // so the sensor itself runs in that mode (v4l2src restarts streaming, the pipeline keeps running);
+    // the switch then completes once both the sensor and the delivered frames are in the new mode.
+    int reconfigure(int _width, int _height, int _fps, const std::string& _format = "",
+                    int _sensor_width = 0, int _sensor_height = 0, int _sensor_fps = 0) {
+        try {
+            if (!pipeline)
+                return -1;
+            if (!capsfilter)
+                capsfilter = gst_bin_get_by_name(GST_BIN(pipeline), "capcaps");
+            if (!capsfilter) {
+                LOG_WARN("GstCapture pipeline has no capcaps capsfilter, cannot renegotiate in place");
+                return -1;
+            }
+            GstCaps* sensor = nullptr;
+            if (_sensor_width > 0 && sensorcaps) {
+                GstCaps* current = nullptr;
+                g_object_get(sensorcaps, "caps", &current, nullptr);
+                if (current && !gst_caps_is_any(current) && gst_caps_get_size(current) > 0) {
+                    sensor = gst_caps_copy(current);
+                    gst_caps_set_simple(sensor, "width", G_TYPE_INT, _sensor_width, "height", G_TYPE_INT, _sensor_height,
+                                        "framerate", GST_TYPE_FRACTION, _sensor_fps, 1, nullptr);
+                }
+                if (current)
+                    gst_caps_unref(current);
+            }
+            std::string target_format = _format.empty() ? getFormat() : _format;
+            std::string caps_desc = "video/x-raw,format=" + target_format + ",width=" + std::to_string(_width) +
+                                    ",height=" + std::to_string(_height) + ",framerate=" + std::to_string(_fps) + "/1";
+            GstCaps* caps = gst_caps_from_string(caps_desc.c_str());
+            if (!caps) {
+                LOG_ERROR("GstCapture invalid caps " + caps_desc);
+                return -1;
+            }
+            {
+                std::lock_guard<std::mutex> lock(switch_mutex);
+                switch_pending = true;
+                switch_width = _width;
+                switch_height = _height;
+                switch_fps = _fps;
+                switch_format = target_format;
+                switch_sensor_width = sensor ? _sensor_width : 0;
+                switch_sensor_height = _sensor_height;
+                switch_sensor_fps = _sensor_fps;
+                switch_start = std::chrono::steady_clock::now();
+            }
+            if (sensor) {
+                g_object_set(sensorcaps, "caps", sensor, nullptr);
+                gst_caps_unref(sensor);
+            }
+            g_object_set(capsfilter, "caps", caps, nullptr);
+            gst_caps_unref(caps);
+            LOG_INFO("GstCapture renegotiating to " + caps_desc + (switch_sensor_width > 0 ? ", sensor " + std::to_string(_sensor_width) + "x" +
+                     std::to_string(_sensor_height) + "@" + std::to_string(_sensor_fps) : ""));
+            return 0;
+        } catch (const std::exception& e) {
+            LOG_ERROR("An error occurred in GstCapture reconfigure: " + std::string(e.what()));
+            return -1;
+        }
+    }
+
+    // Waits until read() delivered a frame with the caps requested by reconfigure()
+    bool waitReconfigured(int _timeout_ms) {
+        std::unique_lock<std::mutex> lock(switch_mutex);
+        return switch_done.wait_for(lock, std::chrono::milliseconds(_timeout_ms), [this]() { return !switch_pending; });
+    }
+
+    SwitchStats getSwitchStats() {
+        std::lock_guard<std::mutex> lock(switch_mutex);
+        return switchStats;
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    double getFps() const { return fps; }
+    std::string getFormat() const {
+        std::lock_guard<std::mutex> lock(switch_mutex);
+        return format;
+    }
+    int getOutstanding() const { return *outstanding; }
+
+    // Age of the last frame read: pipeline running time now minus its PTS, which the
+    // camera source stamps at capture. -1 when either is unavailable.
+    double lastFrameAge() const {
+        if (!pipeline || !GST_CLOCK_TIME_IS_VALID(last_pts))
+            return -1;
+        GstClock* clock = gst_element_get_clock(pipeline);
+        if (!clock)
+            return -1;
+        GstClockTime now = gst_clock_get_time(clock);
+        GstClockTime base = gst_element_get_base_time(pipeline);
+        gst_object_unref(clock);
+        if (now < base + last_pts)
+            return -1;
+        return static_cast<double>(now - base - last_pts) / GST_MSECOND;
+    }
+
+private:
+    GstElement* pipeline = nullptr;
+    GstElement* appsink = nullptr;
+    GstSample* pending = nullptr;
+    GstCaps* current_caps = nullptr;
+    GstElement* capsfilter = nullptr;
+    GstElement* sensorcaps = nullptr;
+    GstSampleAllocator::Counter outstanding = GstSampleAllocator::makeCounter();
+    RtpProtection protection;
+    int width = 0;
+    int height = 0;
+    int type = CV_8UC2;
+    size_t stride = 0;
+    GstClockTime last_pts = GST_CLOCK_TIME_NONE;
+    double fps = 0;
+    // Written by read() on the capture thread under switch_mutex, read from the GUI thread
+    std::string format;
+    // Renegotiation requested by reconfigure(), completed by read()
+    mutable std::mutex switch_mutex;
+    std::condition_variable switch_done;
+    bool switch_pending = false;
+    int switch_width = 0;
+    int switch_height = 0;
+    int switch_fps = 0;
+    std::string switch_format;
+    int switch_sensor_width = 0;  // 0 leaves the sensor mode as it is
+    int switch_sensor_height = 0;
+    int switch_sensor_fps = 0;
+    std::chrono::steady_clock::time_point switch_start;
+    SwitchStats switchStats;
+
+    void checkSwitch() {
+        {
+            std::lock_guard<std::mutex> lock(switch_mutex);
+            if (!switch_pending || width != switch_width || height != switch_height || std::lround(fps) != switch_fps || format != switch_format)
+                return;
+            if (switch_sensor_width > 0 && !sensorIn(switch_sensor_width, switch_sensor_height, switch_sensor_fps))
+                return;
+            double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - switch_start).count();
+            switch_pending = false;
+            switchStats.switches++;
+            switchStats.last_ms = latency;
+            switchStats.max_ms = std::max(switchStats.max_ms, latency);
+        }
+        switch_done.notify_all();
+    }
+
+    // True when the caps negotiated behind the camera source are _width x _height at _fps
+    bool sensorIn(int _width, int _height, int _fps) {
+        GstPad* pad = gst_element_get_static_pad(sensorcaps, "src");
+        if (!pad)
+            return true;
+        GstCaps* caps = gst_pad_get_current_caps(pad);
+        gst_object_unref(pad);
+        if (!caps)
+            return false;
+        GstStructure* structure = gst_caps_get_structure(caps, 0);
+        int w = 0, h = 0, num = 0, den = 1;
+        bool matches = gst_structure_get_int(structure, "width", &w) && gst_structure_get_int(structure, "height", &h) &&
+                       gst_structure_get_fraction(structure, "framerate", &num, &den) && den > 0 &&
+                       w == _width && h == _height && std::lround(static_cast<double>(num) / den) == _fps;
+        gst_caps_unref(caps);
+        return matches;
+    }
+
+    // Prefers an appsink named "camsink", otherwise the first appsink of the pipeline
+    GstElement* findAppsink() {
+        GstElement* named = gst_bin_get_by_name(GST_BIN(pipeline), "camsink");
+        if (named)
+            return named;
+        GstElement* found = nullptr;
+        GstIterator* it = gst_bin_iterate_sinks(GST_BIN(pipeline));
+        GValue item = G_VALUE_INIT;
+        bool done = false;
+        while (!done) {
+            switch (gst_iterator_next(it, &item)) {
+                case GST_ITERATOR_OK: {
+                    GstElement* element = GST_ELEMENT(g_value_get_object(&item));
+                    if (!found && GST_IS_APP_SINK(element))
+                        found = GST_ELEMENT(gst_object_ref(element));
+                    g_value_unset(&item);
+                    break;
+                }
+                case GST_ITERATOR_RESYNC:
+                    if (found) {
+                        gst_object_unref(found);
+                        found = nullptr;
+                    }
+                    gst_iterator_resync(it);
+                    break;
+                default:
+                    done = true;
+                    break;
+            }
+        }
+        gst_iterator_free(it);
+        return found;
+    }
+
+    bool readCaps(GstCaps* _caps) {
+        if (!_caps)
+            return false;
+        GstVideoInfo info;
+        if (!gst_video_info_from_caps(&info, _caps))
+            return false;
+        width = GST_VIDEO_INFO_WIDTH(&info);
+        height = GST_VIDEO_INFO_HEIGHT(&info);
+        stride = GST_VIDEO_INFO_PLANE_STRIDE(&info, 0);
+        fps = GST_VIDEO_INFO_FPS_D(&info) > 0 ? static_cast<double>(GST_VIDEO_INFO_FPS_N(&info)) / GST_VIDEO_INFO_FPS_D(&info) : 0;
+        const char* name = nullptr;
+        switch (GST_VIDEO_INFO_FORMAT(&info)) {
+            case GST_VIDEO_FORMAT_YUY2: type = CV_8UC2; name = "YUY2"; break;
+            case GST_VIDEO_FORMAT_BGR:  type = CV_8UC3; name = "BGR"; break;
+            case GST_VIDEO_FORMAT_GRAY8: type = CV_8UC1; name = "GRAY8"; break;
+            default:
+                LOG_ERROR("GstCapture unsupported format " + std::string(gst_video_format_to_string(GST_VIDEO_INFO_FORMAT(&info))));
+                return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(switch_mutex);
+            format = name;
+        }
+        return width > 0 && height > 0;
+    }
+
+    void logBusErrors() {
+        if (!pipeline)
+            return;
+        GstBus* bus = gst_element_get_bus(pipeline);
+        GstMessage* msg = nullptr;
+        while ((msg = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR)) != nullptr) {
+            GError* err = nullptr;
+            gchar* debug = nullptr;
+            gst_message_parse_error(msg, &err, &debug);
+            LOG_ERROR("GstCapture pipeline error: " + std::string(err ? err->message : "Unknown error"));
+            if (err) g_error_free(err);
+            g_free(debug);
+            gst_message_unref(msg);
+        }
+        gst_object_unref(bus);
+    }
+};
+#endif // GSTCAPTURE_H
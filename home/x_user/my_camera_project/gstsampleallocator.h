@@ -0,0 +1,113 @@
+#ifndef GSTSAMPLEALLOCATOR_H
+#define GSTSAMPLEALLOCATOR_H
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <gst/gst.h>
+#include "Logger.h"
+// Undefine the Status macro before including OpenCV to prevent conflict with X11
+#undef Status
+#include <opencv2/opencv.hpp>
+
+// cv::Mat allocator whose buffers are mapped GstSamples.
+// The sample stays referenced and mapped for as long as any cv::Mat header
+// shares the data, so a frame can travel through FrameBus mailboxes without
+// the appsink buffer ever being copied.
+// There is one process-wide instance, never destroyed (like cv::Mat::getStdAllocator()):
+// a frame records its allocator, so the allocator has to outlive every frame, including
+// frames still held by a mailbox or a widget after the capture or player that made them is gone.
+class GstSampleAllocator : public cv::MatAllocator {
+public:
+    // Frames of one source still referenced, shared with the frames so it outlives the source
+    typedef std::shared_ptr<std::atomic<int>> Counter;
+
+    struct Holder {
+        GstSample* sample;
+        GstBuffer* buffer;
+        GstMapInfo map;
+        Counter counter;
+    };
+
+    static GstSampleAllocator* instance() {
+        static GstSampleAllocator* const allocator = new GstSampleAllocator();
+        return allocator;
+    }
+
+    static Counter makeCounter() {
+        return std::make_shared<std::atomic<int>>(0);
+    }
+
+    // Takes ownership of _sample, returns an empty header when the buffer cannot be mapped.
+    // _counter, when given, counts the frame until it is released.
+    cv::Mat wrap(GstSample* _sample, int _rows, int _cols, int _type, size_t _stride, const Counter& _counter = Counter()) const {
+        Holder* holder = new Holder();
+        holder->sample = _sample;
+        holder->buffer = gst_sample_get_buffer(_sample);
+        if (!holder->buffer || !gst_buffer_map(holder->buffer, &holder->map, GST_MAP_READ)) {
+            gst_sample_unref(_sample);
+            delete holder;
+            return cv::Mat();
+        }
+        if (holder->map.size < _stride * _rows) {
+            LOG_ERROR("GstSampleAllocator buffer smaller than the negotiated frame");
+            gst_buffer_unmap(holder->buffer, &holder->map);
+            gst_sample_unref(_sample);
+            delete holder;
+            return cv::Mat();
+        }
+        cv::Mat frame(_rows, _cols, _type, holder->map.data, _stride);
+        cv::UMatData* u = new cv::UMatData(this);
+        u->data = u->origdata = holder->map.data;
+        u->size = holder->map.size;
+        u->userdata = holder;
+        u->flags = static_cast<cv::UMatData::MemoryFlag>(u->flags | cv::UMatData::USER_ALLOCATED);
+        frame.u = u;
+        frame.addref();
+        holder->counter = _counter;
+        if (holder->counter)
+            (*holder->counter)++;
+        outstanding++;
+        return frame;
+    }
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        // create() on a wrapped header with another geometry gets ordinary memory
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessflags, cv::UMatUsageFlags usageFlags) const override {
+        return cv::Mat::getStdAllocator()->allocate(data, accessflags, usageFlags);
+    }
+
+    void deallocate(cv::UMatData* u) const override {
+        if (!u)
+            return;
+        if (u->currAllocator != this || !u->userdata) {
+            cv::Mat::getStdAllocator()->deallocate(u);
+            return;
+        }
+        Holder* holder = static_cast<Holder*>(u->userdata);
+        gst_buffer_unmap(holder->buffer, &holder->map);
+        gst_sample_unref(holder->sample);
+        if (holder->counter)
+            (*holder->counter)--;
+        delete holder;
+        delete u;
+        outstanding--;
+    }
+
+    // Wrapped frames of all sources still referenced by a cv::Mat somewhere
+    int getOutstanding() const {
+        return outstanding;
+    }
+
+private:
+    GstSampleAllocator() {}
+    GstSampleAllocator(const GstSampleAllocator&) = delete;
+    GstSampleAllocator& operator=(const GstSampleAllocator&) = delete;
+
+    mutable std::atomic<int> outstanding{0};
+};
+#endif // GSTSAMPLEALLOCATOR_H
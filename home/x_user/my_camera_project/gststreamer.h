@@ -0,0 +1,725 @@
+#ifndef GSTSTREAMER_H
+#define GSTSTREAMER_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <array>
+#include <chrono>
+#include <regex>
+#include <algorithm>
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <vector>
+#include "Logger.h"
+#include "segmentstore.h"
+#include "rtpprotection.h"
+// Undefine the Status macro before including OpenCV to prevent conflict with X11
+#undef Status
+#include <opencv2/opencv.hpp>
+
+// Native appsrc streaming engine replacing cv::VideoWriter.
+// push() wraps the frame memory in a GstBuffer (gst_buffer_new_wrapped_full)
+// that keeps a cv::Mat header alive, so the pooled frame is referenced, not
+// copied, until the encoder releases the buffer. Buffers carry the capture PTS
+// rebased onto the stream pipeline's running time instead of the timestamps
+// OpenCV invents. When a hardware encoder named in the pipeline is missing the
+// software x264enc/x265enc equivalent is substituted, so the same pipeline
+// strings run on a development machine. The encoder bitrate and the stream
+// size/rate can be changed while the pipeline runs, and when the pipeline sends
+// through an rtpbin named "rtpbin" the receiver's RTCP reports are readable.
+// Outputs tee the encoded bitstream after the parser, so a rolling MP4 recorder
+// and additional RTP receivers cost no extra encode. With an rtpbin, RtpProtection
+// adds retransmissions and FEC, and keyframe requests reach the encoder rate-limited.
+class GstStreamer {
+public:
+    struct Stats {
+        uint64_t pushed = 0;          // buffers accepted by appsrc
+        uint64_t dropped = 0;         // frames skipped because the encoder queue was full
+        uint64_t failed = 0;          // push errors (pipeline flushing or stopped)
+        int in_flight = 0;            // pushed buffers not yet released by the pipeline
+        int max_in_flight = 0;
+        double mean_push_us = 0;      // time spent in gst_app_src_push_buffer()
+        double max_push_us = 0;
+        uint64_t encoded = 0;         // frames out of the encoder
+        uint64_t encoded_bytes = 0;
+        double mean_encode_ms = 0;    // frame in to frame out of the encoder, matched by PTS
+    };
+
+    // Last RTCP receiver report block about our stream
+    struct Report {
+        bool valid = false;       // the receiver has sent at least one report
+        bool fresh = false;       // a new report arrived since the previous call
+        double fraction_lost = 0; // 0..1, over the receiver's last report interval
+        double rtt_ms = -1;
+        int64_t packets_lost = 0; // cumulative
+        double jitter_ms = 0;
+    };
+
+    // Encoded-stream fan-out applied by the next open()
+    struct Outputs {
+        std::vector<std::string> destinations; // extra "host:port" RTP receivers fed by the same payloader
+        std::string record_dir;                // empty = no recording
+        int segment_seconds = 60;
+        uint64_t record_max_bytes = 0;         // disk budget of record_dir, the oldest segments are evicted
+    };
+
+    GstStreamer() {
+        LOG_INFO("GstStreamer Constructor");
+    }
+
+    ~GstStreamer() {
+        close();
+    }
+
+    // Deleted copy operations, the pipeline is owned by this object
+    GstStreamer(const GstStreamer&) = delete;
+    GstStreamer& operator=(const GstStreamer&) = delete;
+
+    // _queue_limit is the number of frames allowed inside the pipeline before push() drops
+    int open(const std::string& _pipeline, int _width, int _height, int _fps, int _queue_limit = 4) {
+        try {
+            close();
+            if (!gst_is_initialized())
+                gst_init(nullptr, nullptr);
+            bool record = outputs.record_dir.size() > 0 && outputs.record_max_bytes > 0 && recorder.startSession();
+            std::string description = withOutputs(withAvailableEncoder(_pipeline), outputs, record);
+            GError* error = nullptr;
+            pipeline = gst_parse_launch(description.c_str(), &error);
+            if (!pipeline || error) {
+                LOG_ERROR("GstStreamer failed to create pipeline: " + std::string(error ? error->message : "Unknown error"));
+                if (error) g_error_free(error);
+                close();
+                return -1;
+            }
+            appsrc = findAppsrc();
+            if (!appsrc) {
+                LOG_ERROR("GstStreamer pipeline has no appsrc");
+                close();
+                return -1;
+            }
+            if (record && !connectRecorder()) {
+                LOG_WARN("GstStreamer recording unavailable, streaming only");
+            }
+            GstElement* encoder = findEncoder();
+            if (!protection.attachSender(pipeline, encoder) && protection.isEnabled())
+                LOG_WARN("GstStreamer loss protection needs an rtpbin named rtpbin, sending unprotected");
+            if (encoder) {
+                watchEncoder(encoder);
+                gst_object_unref(encoder);
+            }
+            width = _width;
+            height = _height;
+            fps = _fps > 0 ? _fps : 30;
+            queue_limit = std::max(1, _queue_limit);
+            std::string caps_desc = "video/x-raw,format=BGR,width=" + std::to_string(width) + ",height=" + std::to_string(height) +
+                                    ",framerate=" + std::to_string(fps) + "/1";
+            GstCaps* caps = gst_caps_from_string(caps_desc.c_str());
+            gst_app_src_set_caps(GST_APP_SRC(appsrc), caps);
+            gst_caps_unref(caps);
+            // Live source in time format, never block the frame bus thread
+            g_object_set(appsrc, "format", GST_FORMAT_TIME, "is-live", TRUE, "do-timestamp", FALSE, "block", FALSE, nullptr);
+            gst_app_src_set_max_bytes(GST_APP_SRC(appsrc), static_cast<guint64>(width) * height * 3 * queue_limit);
+            if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+                LOG_ERROR("GstStreamer could not start the pipeline");
+                logBusErrors();
+                close();
+                return -1;
+            }
+            {
+                std::lock_guard<std::mutex> lock(stats_mutex);
+                stats = Stats();
+                push_ns = 0;
+                encode_ms = 0;
+                encode_pending.fill(EncodeStart());
+            }
+            first_capture_ms = -1;
+            base_running = GST_CLOCK_TIME_NONE;
+            last_pts = GST_CLOCK_TIME_NONE;
+            last_rb_seq = 0;
+            has_rb = false;
+            LOG_INFO("GstStreamer opened " + std::to_string(width) + "x" + std::to_string(height) + " @ " + std::to_string(fps) + ": " + description);
+            return 0;
+        } catch (const std::exception& e) {
+            LOG_ERROR("An error occurred in GstStreamer open: " + std::string(e.what()));
+            close();
+            return -1;
+        }
+    }
+
+    void close() {
+        if (appsrc) {
+            gst_app_src_end_of_stream(GST_APP_SRC(appsrc));
+            gst_object_unref(appsrc);
+            appsrc = nullptr;
+            // The recorder only writes a playable last segment once EOS reached it
+            if (recording && pipeline)
+                waitEos(2000);
+        }
+        if (recording) {
+            recording = false;
+            recorder.logStats();
+        }
+        if (pipeline) {
+            logBusErrors();
+            gst_element_set_state(pipeline, GST_STATE_NULL);
+            gst_object_unref(pipeline);
+            pipeline = nullptr;
+            logStats();
+            protection.logStats("stream");
+        }
+        protection.detach();
+    }
+
+    bool isOpened() const {
+        return pipeline != nullptr;
+    }
+
+    // _frame must be a continuous BGR frame of the opened size. _capture_ms is its capture
+    // timestamp (pipeline running time of the capture pipeline), -1 when unknown.
+    // Returns false when the frame was dropped or the push failed.
+    bool push(const cv::Mat& _frame, double _capture_ms) {
+        if (!appsrc || _frame.empty())
+            return false;
+        if (_frame.cols != width || _frame.rows != height || _frame.type() != CV_8UC3 || !_frame.isContinuous()) {
+            LOG_ERROR("GstStreamer frame does not match the negotiated caps");
+            return false;
+        }
+        if (in_flight.load() >= queue_limit) {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            stats.dropped++;
+            return false;
+        }
+        size_t size = _frame.total() * _frame.elemSize();
+        // The header keeps the pooled buffer referenced until the pipeline frees the GstBuffer
+        cv::Mat* hold = new cv::Mat(_frame);
+        GstBuffer* buffer = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY, hold->data, size, 0, size, new Release{hold, this},
+                                                        &GstStreamer::release);
+        in_flight++;
+        GST_BUFFER_PTS(buffer) = nextPts(_capture_ms);
+        GST_BUFFER_DURATION(buffer) = GST_SECOND / fps;
+        auto start = std::chrono::steady_clock::now();
+        GstFlowReturn ret = gst_app_src_push_buffer(GST_APP_SRC(appsrc), buffer);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        if (ret != GST_FLOW_OK) {
+            stats.failed++;
+            return false;
+        }
+        stats.pushed++;
+        push_ns += us * 1000;
+        stats.mean_push_us = push_ns / 1000.0 / stats.pushed;
+        stats.max_push_us = std::max(stats.max_push_us, us);
+        stats.max_in_flight = std::max(stats.max_in_flight, in_flight.load());
+        return true;
+    }
+
+    // Takes effect with the next open()
+    void setOutputs(const Outputs& _outputs) {
+        outputs = _outputs;
+        recorder.configure(_outputs.record_dir, _outputs.record_max_bytes);
+    }
+
+    // Retransmission, FEC and keyframe request handling, takes effect with the next open()
+    void setProtection(const RtpProtection::Settings& _settings) {
+        protection.configure(_settings);
+    }
+
+    RtpProtection::Stats getProtectionStats() {
+        return protection.getStats();
+    }
+
+    // Asks the encoder for a keyframe now, e.g. for a receiver that just joined. Dropped when
+    // the last forced keyframe is more recent than the protection's keyframe interval.
+    bool requestKeyframe() {
+        return pipeline && protection.requestKeyframe();
+    }
+
+    bool isRecording() const {
+        return recording;
+    }
+
+    SegmentStore::Stats getRecordStats() {
+        return recorder.getStats();
+    }
+
+    // Adds or removes an RTP receiver while streaming. Needs the multiudpsink that open()
+    // puts in place when Outputs::destinations is not empty.
+    bool addDestination(const std::string& _host, int _port) {
+        if (!changeDestination("add", _host, _port))
+            return false;
+        // The new receiver cannot decode anything before the next keyframe
+        requestKeyframe();
+        return true;
+    }
+
+    bool removeDestination(const std::string& _host, int _port) {
+        return changeDestination("remove", _host, _port);
+    }
+
+    // Changes the encoder bitrate of the running pipeline, in kbit/s
+    bool setBitrate(int _kbps) {
+        if (!pipeline || _kbps <= 0)
+            return false;
+        GstElement* encoder = findEncoder();
+        if (!encoder) {
+            LOG_WARN("GstStreamer pipeline has no encoder with a bitrate property");
+            return false;
+        }
+        GParamSpec* spec = g_object_class_find_property(G_OBJECT_GET_CLASS(encoder), "bitrate");
+        bool done = true;
+        if (spec && spec->value_type == G_TYPE_UINT)
+            g_object_set(encoder, "bitrate", static_cast<guint>(_kbps), nullptr);
+        else if (spec && spec->value_type == G_TYPE_INT)
+            g_object_set(encoder, "bitrate", static_cast<gint>(_kbps), nullptr);
+        else
+            done = false;
+        gst_object_unref(encoder);
+        return done;
+    }
+
+    // Current encoder bitrate in kbit/s, 0 when unknown
+    int getBitrate() {
+        if (!pipeline)
+            return 0;
+        GstElement* encoder = findEncoder();
+        if (!encoder)
+            return 0;
+        GParamSpec* spec = g_object_class_find_property(G_OBJECT_GET_CLASS(encoder), "bitrate");
+        int kbps = 0;
+        if (spec && spec->value_type == G_TYPE_UINT) {
+            guint value = 0;
+            g_object_get(encoder, "bitrate", &value, nullptr);
+            kbps = static_cast<int>(value);
+        } else if (spec && spec->value_type == G_TYPE_INT) {
+            gint value = 0;
+            g_object_get(encoder, "bitrate", &value, nullptr);
+            kbps = value;
+        }
+        gst_object_unref(encoder);
+        return kbps;
+    }
+
+    // Renegotiates the stream size and rate without restarting the pipeline: new appsrc
+    // caps, and the same size on a capsfilter named "streamcaps" when there is one.
+    // Must be called from the thread that calls push(); frames of the old size are refused afterwards.
+    bool setFormat(int _width, int _height, int _fps) {
+        if (!appsrc || _width <= 0 || _height <= 0)
+            return false;
+        width = _width;
+        height = _height;
+        fps = _fps > 0 ? _fps : fps;
+        std::string size_desc = "width=" + std::to_string(width) + ",height=" + std::to_string(height) +
+                                ",framerate=" + std::to_string(fps) + "/1";
+        GstCaps* caps = gst_caps_from_string(("video/x-raw,format=BGR," + size_desc).c_str());
+        gst_app_src_set_caps(GST_APP_SRC(appsrc), caps);
+        gst_caps_unref(caps);
+        gst_app_src_set_max_bytes(GST_APP_SRC(appsrc), static_cast<guint64>(width) * height * 3 * queue_limit);
+        GstElement* filter = gst_bin_get_by_name(GST_BIN(pipeline), "streamcaps");
+        if (filter) {
+            GstCaps* filter_caps = gst_caps_from_string(("video/x-raw," + size_desc).c_str());
+            g_object_set(filter, "caps", filter_caps, nullptr);
+            gst_caps_unref(filter_caps);
+            gst_object_unref(filter);
+        }
+        LOG_INFO("GstStreamer format " + std::to_string(width) + "x" + std::to_string(height) + " @ " + std::to_string(fps));
+        return true;
+    }
+
+    // Reads the receiver report block about our stream from the internal RTP session of
+    // an rtpbin named "rtpbin". Without one, or before the first report, valid is false.
+    Report getReceiverReport() {
+        Report report;
+        if (!pipeline)
+            return report;
+        GstElement* rtpbin = gst_bin_get_by_name(GST_BIN(pipeline), "rtpbin");
+        if (!rtpbin)
+            return report;
+        GObject* session = nullptr;
+        g_signal_emit_by_name(rtpbin, "get-internal-session", 0u, &session);
+        if (session) {
+            GstStructure* stats_structure = nullptr;
+            g_object_get(session, "stats", &stats_structure, nullptr);
+            if (stats_structure) {
+                readReportBlock(stats_structure, report);
+                gst_structure_free(stats_structure);
+            }
+            g_object_unref(session);
+        }
+        gst_object_unref(rtpbin);
+        return report;
+    }
+
+    // Frames waiting in appsrc plus those inside the converter/encoder
+    int getQueueDepth() const {
+        return in_flight.load();
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        Stats _stats = stats;
+        _stats.in_flight = in_flight.load();
+        return _stats;
+    }
+
+    void logStats() {
+        Stats _stats = getStats();
+        LOG_INFO("GstStreamer pushed " + std::to_string(_stats.pushed) + ", dropped " + std::to_string(_stats.dropped) +
+                 ", failed " + std::to_string(_stats.failed) + ", queue " + std::to_string(_stats.in_flight) +
+                 " (max " + std::to_string(_stats.max_in_flight) + "), push " + std::to_string(_stats.mean_push_us) +
+                 " us (max " + std::to_string(_stats.max_push_us) + " us), encoded " + std::to_string(_stats.encoded) +
+                 " (" + std::to_string(_stats.encoded_bytes / 1024) + " KB, " + std::to_string(_stats.mean_encode_ms) + " ms)");
+    }
+
+    // Tees the parsed bitstream in front of the RTP payloader into a splitmuxsink named
+    // "streamrec" (when _record), and turns the RTP udpsink into a multiudpsink named
+    // "streamsink" that also sends to Outputs::destinations. Unchanged when the pipeline
+    // has no payloader or nothing is requested.
+    static std::string withOutputs(const std::string& _pipeline, const Outputs& _outputs, bool _record) {
+        std::smatch payloader;
+        if (!std::regex_search(_pipeline, payloader, std::regex("rtp(h264|h265|vp8|vp9)pay")))
+            return _pipeline;
+        std::string result = _pipeline;
+        size_t pay_pos = payloader.position(0);
+        if (!_outputs.destinations.empty()) {
+            std::smatch sink;
+            std::string tail = result.substr(pay_pos);
+            if (std::regex_search(tail, sink, std::regex("udpsink host=(\\S+) port=(\\S+)"))) {
+                std::string clients = sink[1].str() + ":" + sink[2].str();
+                for (const std::string& destination : _outputs.destinations)
+                    clients += "," + destination;
+                result.replace(pay_pos + sink.position(0), sink.length(0), "multiudpsink name=streamsink clients=" + clients);
+            }
+        }
+        if (_record) {
+            std::string codec = payloader[1].str();
+            std::string parser = codec == "h264" ? "h264parse" : codec == "h265" ? "h265parse" : "";
+            if (parser.empty()) {
+                LOG_WARN("GstStreamer cannot record " + codec + " into MP4");
+                return result;
+            }
+            // The recorder branch may fall behind on a slow card, it drops instead of stalling the stream
+            result.insert(pay_pos, "tee name=enctee ! queue max-size-buffers=8 max-size-bytes=0 max-size-time=0 ! ");
+            result += " enctee. ! queue max-size-buffers=120 max-size-bytes=0 max-size-time=0 leaky=downstream ! " + parser +
+                      " ! splitmuxsink name=streamrec async-finalize=false send-keyframe-requests=true max-size-time=" +
+                      std::to_string(static_cast<uint64_t>(std::max(1, _outputs.segment_seconds)) * GST_SECOND);
+        }
+        return result;
+    }
+
+    // Replaces hardware encoders that are not installed by their software equivalent, keeping the bitrate (kbit/s for all)
+    static std::string withAvailableEncoder(const std::string& _pipeline) {
+        static const std::pair<const char*, const char*> fallbacks[] = {
+            {"vpuenc_h264", "x264enc tune=zerolatency speed-preset=ultrafast key-int-max=30"},
+            {"vpuenc_hevc", "x265enc tune=zerolatency speed-preset=ultrafast key-int-max=30"},
+        };
+        std::string result = _pipeline;
+        for (const auto& fallback : fallbacks) {
+            size_t pos = result.find(fallback.first);
+            if (pos == std::string::npos)
+                continue;
+            GstElementFactory* factory = gst_element_factory_find(fallback.first);
+            if (factory) {
+                gst_object_unref(factory);
+                continue;
+            }
+            size_t end = result.find('!', pos);
+            std::string element = result.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+            std::string replacement = fallback.second;
+            std::smatch match;
+            if (std::regex_search(element, match, std::regex("name=(\\S+)")))
+                replacement += " name=" + match[1].str();
+            if (std::regex_search(element, match, std::regex("bitrate=(\\d+)")))
+                replacement += " bitrate=" + match[1].str();
+            result.replace(pos, element.size(), replacement + (end == std::string::npos ? "" : " "));
+            LOG_WARN("GstStreamer " + std::string(fallback.first) + " not available, using " + replacement);
+        }
+        return result;
+    }
+
+private:
+    struct Release {
+        cv::Mat* frame;
+        GstStreamer* owner;
+    };
+
+    struct EncodeStart {
+        GstClockTime pts = GST_CLOCK_TIME_NONE;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    GstElement* pipeline = nullptr;
+    GstElement* appsrc = nullptr;
+    int width = 0;
+    int height = 0;
+    int fps = 30;
+    int queue_limit = 4;
+    std::atomic<int> in_flight{0};
+    double first_capture_ms = -1;
+    GstClockTime base_running = GST_CLOCK_TIME_NONE;
+    GstClockTime last_pts = GST_CLOCK_TIME_NONE;
+    std::chrono::steady_clock::time_point first_wall;
+    guint last_rb_seq = 0;
+    bool has_rb = false;
+    Outputs outputs;
+    SegmentStore recorder;
+    RtpProtection protection;
+    bool recording = false;
+    Stats stats;
+    double push_ns = 0;
+    // Frames inside the encoder by PTS, for its per-frame time
+    std::array<EncodeStart, 8> encode_pending;
+    size_t next_encode = 0;
+    double encode_ms = 0;
+    std::mutex stats_mutex;
+
+    // Times each frame through the encoder and counts the encoded bytes
+    void watchEncoder(GstElement* _encoder) {
+        GstPad* sink = gst_element_get_static_pad(_encoder, "sink");
+        GstPad* src = gst_element_get_static_pad(_encoder, "src");
+        if (sink) {
+            gst_pad_add_probe(sink, GST_PAD_PROBE_TYPE_BUFFER, &GstStreamer::encoderInProbe, this, nullptr);
+            gst_object_unref(sink);
+        }
+        if (src) {
+            gst_pad_add_probe(src, GST_PAD_PROBE_TYPE_BUFFER, &GstStreamer::encoderOutProbe, this, nullptr);
+            gst_object_unref(src);
+        }
+    }
+
+    static GstPadProbeReturn encoderInProbe(GstPad*, GstPadProbeInfo* _info, gpointer _data) {
+        GstStreamer* self = static_cast<GstStreamer*>(_data);
+        GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(_info);
+        std::lock_guard<std::mutex> lock(self->stats_mutex);
+        self->encode_pending[self->next_encode] = EncodeStart{GST_BUFFER_PTS(buffer), std::chrono::steady_clock::now()};
+        self->next_encode = (self->next_encode + 1) % self->encode_pending.size();
+        return GST_PAD_PROBE_OK;
+    }
+
+    static GstPadProbeReturn encoderOutProbe(GstPad*, GstPadProbeInfo* _info, gpointer _data) {
+        GstStreamer* self = static_cast<GstStreamer*>(_data);
+        GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(_info);
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(self->stats_mutex);
+        self->stats.encoded++;
+        self->stats.encoded_bytes += gst_buffer_get_size(buffer);
+        for (EncodeStart& start : self->encode_pending) {
+            if (start.pts != GST_CLOCK_TIME_NONE && start.pts == GST_BUFFER_PTS(buffer)) {
+                self->encode_ms += std::chrono::duration<double, std::milli>(now - start.time).count();
+                self->stats.mean_encode_ms = self->encode_ms / self->stats.encoded;
+                start.pts = GST_CLOCK_TIME_NONE;
+                break;
+            }
+        }
+        return GST_PAD_PROBE_OK;
+    }
+
+    static void release(gpointer _data) {
+        Release* release = static_cast<Release*>(_data);
+        delete release->frame;
+        release->owner->in_flight--;
+        delete release;
+    }
+
+    // Capture time relative to the first streamed frame, offset by the stream pipeline's
+    // running time at that frame, so frame spacing follows the camera and the sink stays in sync
+    GstClockTime nextPts(double _capture_ms) {
+        auto now = std::chrono::steady_clock::now();
+        if (base_running == GST_CLOCK_TIME_NONE) {
+            base_running = runningTime();
+            first_capture_ms = _capture_ms;
+            first_wall = now;
+        }
+        double offset_ms = _capture_ms >= 0 && first_capture_ms >= 0
+                           ? _capture_ms - first_capture_ms
+                           : std::chrono::duration<double, std::milli>(now - first_wall).count();
+        GstClockTime pts = base_running + static_cast<GstClockTime>(std::max(0.0, offset_ms) * GST_MSECOND);
+        if (last_pts != GST_CLOCK_TIME_NONE && pts <= last_pts)
+            pts = last_pts + GST_MSECOND;
+        last_pts = pts;
+        return pts;
+    }
+
+    GstClockTime runningTime() {
+        GstClock* clock = gst_element_get_clock(pipeline);
+        if (!clock)
+            return 0;
+        GstClockTime now = gst_clock_get_time(clock);
+        GstClockTime base = gst_element_get_base_time(pipeline);
+        gst_object_unref(clock);
+        return now > base ? now - base : 0;
+    }
+
+    bool connectRecorder() {
+        GstElement* splitmux = gst_bin_get_by_name(GST_BIN(pipeline), "streamrec");
+        if (!splitmux)
+            return false;
+        g_signal_connect(splitmux, "format-location", G_CALLBACK(&GstStreamer::formatLocation), this);
+        gst_object_unref(splitmux);
+        recording = true;
+        LOG_INFO("GstStreamer recording " + std::to_string(outputs.segment_seconds) + " s segments into " + outputs.record_dir);
+        return true;
+    }
+
+    // splitmuxsink asks for each new file on its streaming thread; old segments are evicted first
+    static gchar* formatLocation(GstElement*, guint _fragment, gpointer _data) {
+        GstStreamer* self = static_cast<GstStreamer*>(_data);
+        int kbps = self->getBitrate();
+        uint64_t reserve = static_cast<uint64_t>(kbps > 0 ? kbps : 5000) * 1000 / 8 * std::max(1, self->outputs.segment_seconds);
+        std::string location = self->recorder.nextLocation(_fragment, reserve);
+        return g_strdup(location.c_str());
+    }
+
+    bool changeDestination(const char* _signal, const std::string& _host, int _port) {
+        if (!pipeline)
+            return false;
+        GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "streamsink");
+        if (!sink) {
+            LOG_WARN("GstStreamer pipeline has no multiudpsink for extra destinations");
+            return false;
+        }
+        g_signal_emit_by_name(sink, _signal, _host.c_str(), _port);
+        gst_object_unref(sink);
+        LOG_INFO("GstStreamer " + std::string(_signal) + " destination " + _host + ":" + std::to_string(_port));
+        return true;
+    }
+
+    void waitEos(int _timeout_ms) {
+        GstBus* bus = gst_element_get_bus(pipeline);
+        GstMessage* msg = gst_bus_timed_pop_filtered(bus, static_cast<GstClockTime>(_timeout_ms) * GST_MSECOND,
+                                                     static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        if (msg)
+            gst_message_unref(msg);
+        else
+            LOG_WARN("GstStreamer recording did not finish within " + std::to_string(_timeout_ms) + " ms");
+        gst_object_unref(bus);
+    }
+
+    // Our own (internal) source carries the report blocks the receiver sent about it
+    void readReportBlock(const GstStructure* _stats, Report& _report) {
+        const GValue* sources = gst_structure_get_value(_stats, "source-stats");
+        if (!sources || !G_VALUE_HOLDS(sources, G_TYPE_VALUE_ARRAY))
+            return;
+        G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+        GValueArray* array = static_cast<GValueArray*>(g_value_get_boxed(sources));
+        for (guint i = 0; array && i < array->n_values; ++i) {
+            const GstStructure* source = gst_value_get_structure(g_value_array_get_nth(array, i));
+            gboolean internal = FALSE;
+            gboolean have_rb = FALSE;
+            if (!source || !gst_structure_get_boolean(source, "internal", &internal) || !internal)
+                continue;
+            if (!gst_structure_get_boolean(source, "have-rb", &have_rb) || !have_rb)
+                continue;
+            guint fraction = 0, round_trip = 0, highest_seq = 0, jitter = 0;
+            gint packets_lost = 0;
+            gint clock_rate = 90000;
+            gst_structure_get_uint(source, "rb-fractionlost", &fraction);
+            gst_structure_get_uint(source, "rb-round-trip", &round_trip);
+            gst_structure_get_uint(source, "rb-exthighestseq", &highest_seq);
+            gst_structure_get_uint(source, "rb-jitter", &jitter);
+            gst_structure_get_int(source, "rb-packetslost", &packets_lost);
+            gst_structure_get_int(source, "clock-rate", &clock_rate);
+            _report.valid = true;
+            _report.fresh = !has_rb || highest_seq != last_rb_seq;
+            _report.fraction_lost = fraction / 256.0;
+            // Round trip is in 1/65536 s, jitter in RTP clock units
+            _report.rtt_ms = round_trip > 0 ? round_trip * 1000.0 / 65536.0 : -1;
+            _report.packets_lost = packets_lost;
+            _report.jitter_ms = clock_rate > 0 ? jitter * 1000.0 / clock_rate : 0;
+            has_rb = true;
+            last_rb_seq = highest_seq;
+            break;
+        }
+        G_GNUC_END_IGNORE_DEPRECATIONS
+    }
+
+    // Prefers an element named "streamenc", otherwise the first video encoder of the pipeline
+    GstElement* findEncoder() {
+        GstElement* named = gst_bin_get_by_name(GST_BIN(pipeline), "streamenc");
+        if (named)
+            return named;
+        GstElement* found = nullptr;
+        GstIterator* it = gst_bin_iterate_recurse(GST_BIN(pipeline));
+        GValue item = G_VALUE_INIT;
+        bool done = false;
+        while (!done) {
+            switch (gst_iterator_next(it, &item)) {
+                case GST_ITERATOR_OK: {
+                    GstElement* element = GST_ELEMENT(g_value_get_object(&item));
+                    GstElementFactory* factory = gst_element_get_factory(element);
+                    const gchar* klass = factory ? gst_element_factory_get_metadata(factory, GST_ELEMENT_METADATA_KLASS) : nullptr;
+                    if (!found && klass && std::string(klass).find("Encoder/Video") != std::string::npos)
+                        found = GST_ELEMENT(gst_object_ref(element));
+                    g_value_unset(&item);
+                    break;
+                }
+                case GST_ITERATOR_RESYNC:
+                    if (found) {
+                        gst_object_unref(found);
+                        found = nullptr;
+                    }
+                    gst_iterator_resync(it);
+                    break;
+                default:
+                    done = true;
+                    break;
+            }
+        }
+        gst_iterator_free(it);
+        return found;
+    }
+
+    // Prefers an appsrc named "streamsrc", otherwise the first appsrc of the pipeline
+    GstElement* findAppsrc() {
+        GstElement* named = gst_bin_get_by_name(GST_BIN(pipeline), "streamsrc");
+        if (named)
+            return named;
+        GstElement* found = nullptr;
+        GstIterator* it = gst_bin_iterate_sources(GST_BIN(pipeline));
+        GValue item = G_VALUE_INIT;
+        bool done = false;
+        while (!done) {
+            switch (gst_iterator_next(it, &item)) {
+                case GST_ITERATOR_OK: {
+                    GstElement* element = GST_ELEMENT(g_value_get_object(&item));
+                    if (!found && GST_IS_APP_SRC(element))
+                        found = GST_ELEMENT(gst_object_ref(element));
+                    g_value_unset(&item);
+                    break;
+                }
+                case GST_ITERATOR_RESYNC:
+                    if (found) {
+                        gst_object_unref(found);
+                        found = nullptr;
+                    }
+                    gst_iterator_resync(it);
+                    break;
+                default:
+                    done = true;
+                    break;
+            }
+        }
+        gst_iterator_free(it);
+        return found;
+    }
+
+    void logBusErrors() {
+        if (!pipeline)
+            return;
+        GstBus* bus = gst_element_get_bus(pipeline);
+        GstMessage* msg = nullptr;
+        while ((msg = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR)) != nullptr) {
+            GError* err = nullptr;
+            gchar* debug = nullptr;
+            gst_message_parse_error(msg, &err, &debug);
+            LOG_ERROR("GstStreamer pipeline error: " + std::string(err ? err->message : "Unknown error"));
+            if (err) g_error_free(err);
+            g_free(debug);
+            gst_message_unref(msg);
+        }
+        gst_object_unref(bus);
+    }
+};
+#endif // GSTSTREAMER_H
@@ -0,0 +1,212 @@
+#ifndef IMAGEKERNELS_H
+#define IMAGEKERNELS_H
+
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMAGEKERNELS_NEON 1
+#endif
+#ifndef IMAGEKERNELS_NO_OPENCV
+// Undefine the Status macro before including OpenCV to prevent conflict with X11
+#undef Status
+#include <opencv2/opencv.hpp>
+#endif
+
+// Fused colour conversion and scaling kernels for the YUY2 camera frames.
+// Every kernel picks source pixels with nearest-neighbour sampling (the same
+// INTER_NEAREST the pipeline already uses) and converts while writing the
+// destination, so a scaled BGR or grayscale frame is produced in one pass
+// without a full-resolution BGR intermediate.
+// The colour maths is BT.601 limited range in 6-bit fixed point; the NEON and
+// scalar paths use identical arithmetic and produce identical output.
+class ImageKernels {
+public:
+    // YUY2 (Y0 U Y1 V) to packed BGR, scaled from sw x sh to dw x dh
+    static void yuy2ToBgr(const uint8_t* src, int sw, int sh, int sstride,
+                          uint8_t* dst, int dw, int dh, int dstride) {
+        const std::vector<int>& xmap = sampleMap(sw, dw);
+        // Per-thread scratch rows, reused across frames
+        thread_local std::vector<uint8_t> row;
+        row.resize(static_cast<size_t>(dw) * 3);
+        uint8_t* y = row.data();
+        uint8_t* u = y + dw;
+        uint8_t* v = u + dw;
+        for (int j = 0; j < dh; ++j) {
+            const uint8_t* s = src + static_cast<size_t>(sampleIndex(j, sh, dh)) * sstride;
+            uint8_t* d = dst + static_cast<size_t>(j) * dstride;
+            if (dw == sw) {
+                deinterleaveRow(s, sw, y, u, v);
+            } else {
+                for (int i = 0; i < dw; ++i) {
+                    int x = xmap[i];
+                    const uint8_t* pair = s + (x & ~1) * 2;
+                    y[i] = s[x * 2];
+                    u[i] = pair[1];
+                    v[i] = pair[3];
+                }
+            }
+            convertRow(y, u, v, d, dw);
+        }
+    }
+
+    // Luma plane of a YUY2 frame, scaled from sw x sh to dw x dh
+    static void yuy2ToGray(const uint8_t* src, int sw, int sh, int sstride,
+                           uint8_t* dst, int dw, int dh, int dstride) {
+        const std::vector<int>& xmap = sampleMap(sw, dw);
+        for (int j = 0; j < dh; ++j) {
+            const uint8_t* s = src + static_cast<size_t>(sampleIndex(j, sh, dh)) * sstride;
+            uint8_t* d = dst + static_cast<size_t>(j) * dstride;
+            int i = 0;
+            if (dw == sw) {
+#ifdef IMAGEKERNELS_NEON
+                for (; i + 16 <= dw; i += 16) {
+                    uint8x16x2_t px = vld2q_u8(s + i * 2);
+                    vst1q_u8(d + i, px.val[0]);
+                }
+#endif
+                for (; i < dw; ++i)
+                    d[i] = s[i * 2];
+            } else if (dw * 2 == sw) {
+#ifdef IMAGEKERNELS_NEON
+                for (; i + 16 <= dw; i += 16) {
+                    uint8x16x4_t px = vld4q_u8(s + i * 4);
+                    vst1q_u8(d + i, px.val[0]);
+                }
+#endif
+                for (; i < dw; ++i)
+                    d[i] = s[i * 4];
+            } else {
+                for (; i < dw; ++i)
+                    d[i] = s[xmap[i] * 2];
+            }
+        }
+    }
+
+    // Sums of absolute differences of a and b over each group of 8 pixels, w / 8 sums
+    // (w a multiple of 8), e.g. one row of 8x8 blocks of two luma thumbnails
+    static void sad8(const uint8_t* a, const uint8_t* b, uint32_t* sums, int w) {
+        int i = 0;
+#ifdef IMAGEKERNELS_NEON
+        for (; i + 16 <= w; i += 16) {
+            uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+            uint64x2_t total = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(diff)));
+            sums[i / 8] = static_cast<uint32_t>(vgetq_lane_u64(total, 0));
+            sums[i / 8 + 1] = static_cast<uint32_t>(vgetq_lane_u64(total, 1));
+        }
+#endif
+        for (; i + 8 <= w; i += 8) {
+            uint32_t total = 0;
+            for (int k = 0; k < 8; ++k)
+                total += a[i + k] > b[i + k] ? a[i + k] - b[i + k] : b[i + k] - a[i + k];
+            sums[i / 8] = total;
+        }
+    }
+
+#ifndef IMAGEKERNELS_NO_OPENCV
+    // cv::Mat wrappers, dst keeps its buffer when it already has the right geometry
+    static void yuy2ToBgr(const cv::Mat& src, cv::Mat& dst, cv::Size size = cv::Size()) {
+        if (size.area() == 0)
+            size = src.size();
+        dst.create(size, CV_8UC3);
+        yuy2ToBgr(src.data, src.cols, src.rows, static_cast<int>(src.step),
+                  dst.data, dst.cols, dst.rows, static_cast<int>(dst.step));
+    }
+
+    static void yuy2ToGray(const cv::Mat& src, cv::Mat& dst, cv::Size size = cv::Size()) {
+        if (size.area() == 0)
+            size = src.size();
+        dst.create(size, CV_8UC1);
+        yuy2ToGray(src.data, src.cols, src.rows, static_cast<int>(src.step),
+                   dst.data, dst.cols, dst.rows, static_cast<int>(dst.step));
+    }
+#endif
+
+private:
+    // Fixed-point BT.601 coefficients, scaled by 64
+    static constexpr int CY = 75;   // 1.164
+    static constexpr int CVR = 102; // 1.596
+    static constexpr int CUG = 25;  // 0.391
+    static constexpr int CVG = 52;  // 0.813
+    static constexpr int CUB = 129; // 2.018
+
+    // Same rounding as cv::resize INTER_NEAREST
+    static int sampleIndex(int _i, int _src, int _dst) {
+        return std::min(static_cast<int>(static_cast<int64_t>(_i) * _src / _dst), _src - 1);
+    }
+
+    // Column lookup for the current thread, only rebuilt when the geometry changes
+    static const std::vector<int>& sampleMap(int _src, int _dst) {
+        thread_local std::vector<int> map;
+        thread_local int map_src = -1;
+        if (map_src != _src || static_cast<int>(map.size()) != _dst) {
+            map.resize(_dst);
+            for (int i = 0; i < _dst; ++i)
+                map[i] = sampleIndex(i, _src, _dst);
+            map_src = _src;
+        }
+        return map;
+    }
+
+    static void deinterleaveRow(const uint8_t* s, int w, uint8_t* y, uint8_t* u, uint8_t* v) {
+        int i = 0;
+#ifdef IMAGEKERNELS_NEON
+        for (; i + 16 <= w; i += 16) {
+            uint8x8x4_t px = vld4_u8(s + i * 2); // Y0 U Y1 V for 8 pixel pairs
+            uint8x8x2_t yy = vzip_u8(px.val[0], px.val[2]);
+            uint8x8x2_t uu = vzip_u8(px.val[1], px.val[1]);
+            uint8x8x2_t vv = vzip_u8(px.val[3], px.val[3]);
+            vst1q_u8(y + i, vcombine_u8(yy.val[0], yy.val[1]));
+            vst1q_u8(u + i, vcombine_u8(uu.val[0], uu.val[1]));
+            vst1q_u8(v + i, vcombine_u8(vv.val[0], vv.val[1]));
+        }
+#endif
+        for (; i < w; ++i) {
+            const uint8_t* pair = s + (i & ~1) * 2;
+            y[i] = s[i * 2];
+            u[i] = pair[1];
+            v[i] = pair[3];
+        }
+    }
+
+    static uint8_t clampPixel(int _value) {
+        return static_cast<uint8_t>(std::min(255, std::max(0, _value)));
+    }
+
+    static void convertRow(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* d, int w) {
+        int i = 0;
+#ifdef IMAGEKERNELS_NEON
+        const int16x8_t k16 = vdupq_n_s16(16);
+        const int16x8_t k128 = vdupq_n_s16(128);
+        for (; i + 8 <= w; i += 8) {
+            int16x8_t yy = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + i))), k16), CY);
+            int16x8_t uu = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + i))), k128);
+            int16x8_t vv = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + i))), k128);
+            int16x8_t r = vqaddq_s16(yy, vmulq_n_s16(vv, CVR));
+            int16x8_t g = vqsubq_s16(vqsubq_s16(yy, vmulq_n_s16(uu, CUG)), vmulq_n_s16(vv, CVG));
+            int16x8_t b = vqaddq_s16(yy, vmulq_n_s16(uu, CUB));
+            uint8x8x3_t bgr;
+            bgr.val[0] = vqrshrun_n_s16(b, 6);
+            bgr.val[1] = vqrshrun_n_s16(g, 6);
+            bgr.val[2] = vqrshrun_n_s16(r, 6);
+            vst3_u8(d + i * 3, bgr);
+        }
+#endif
+        for (; i < w; ++i) {
+            int yy = (y[i] - 16) * CY;
+            int uu = u[i] - 128;
+            int vv = v[i] - 128;
+            d[i * 3 + 0] = clampPixel((saturate16(yy + uu * CUB) + 32) >> 6);
+            d[i * 3 + 1] = clampPixel((saturate16(yy - uu * CUG - vv * CVG) + 32) >> 6);
+            d[i * 3 + 2] = clampPixel((saturate16(yy + vv * CVR) + 32) >> 6);
+        }
+    }
+
+    // Mirrors the saturating int16 arithmetic of the NEON path
+    static int saturate16(int _value) {
+        return std::min(32767, std::max(-32768, _value));
+    }
+};
+#endif // IMAGEKERNELS_H
@@ -0,0 +1,347 @@
+#ifndef KEYFRAMEINDEX_H
+#define KEYFRAMEINDEX_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <gst/gst.h>
+#include "Logger.h"
+
+namespace fs = std::filesystem;
+
+// Keyframe positions of an MP4, so a seek can land on a keyframe and decode only a
+// bounded stretch after it. The index is built by demuxing the file without decoding
+// (only the sync-sample flags and timestamps are read), on one background worker, and cached
+// in cache_dir as <hash of the path>.kfi. The cache holds the file size and modification
+// time and is rebuilt when the file changes.
+class KeyframeIndex {
+public:
+    struct Settings {
+        std::string cache_dir = "/home/x_user/.cache/keyframes";
+        double max_decode_ahead_ms = 1000;  // longest stretch decoded after a keyframe to reach the exact target
+    };
+
+    // Where a seek to a target should go
+    struct Plan {
+        double position_ms = 0;      // seek position
+        double keyframe_ms = -1;     // keyframe decoding starts from, -1 without index
+        double decode_ahead_ms = 0;  // decoded and not shown before the first frame
+        bool accurate = false;       // exact seek to position_ms (else to the keyframe at or before it)
+    };
+
+    void configure(const Settings& _settings) {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings = _settings;
+        settings.max_decode_ahead_ms = std::max(0.0, settings.max_decode_ahead_ms);
+    }
+
+    Settings getSettings() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return settings;
+    }
+
+    // Loads the cached index of _video_path, or queues its build ahead of prepared files
+    void open(const std::string& _video_path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries = std::make_shared<Entries>();
+        std::vector<double> keyframes;
+        if (load(settings.cache_dir, _video_path, keyframes)) {
+            entries->set(std::move(keyframes));
+            LOG_INFO("KeyframeIndex loaded " + std::to_string(entries->size()) + " keyframes of " + _video_path);
+            return;
+        }
+        Indexer::instance()->enqueue(_video_path, settings.cache_dir, entries, true);
+    }
+
+    bool isReady() {
+        std::shared_ptr<Entries> current = getEntries();
+        return current && current->ready();
+    }
+
+    size_t size() {
+        std::shared_ptr<Entries> current = getEntries();
+        return current ? current->size() : 0;
+    }
+
+    // A target at most max_decode_ahead_ms after its keyframe is reached exactly. Further
+    // away, the seek goes to the nearest keyframe, before or after the target, and nothing
+    // is decoded in vain. Without a ready index: the keyframe at or before the target.
+    Plan plan(double _target_ms) {
+        Plan result;
+        result.position_ms = std::max(0.0, _target_ms);
+        std::shared_ptr<Entries> current = getEntries();
+        double max_ahead = getSettings().max_decode_ahead_ms;
+        std::vector<double> keyframes;
+        if (!current || !current->copy(keyframes) || keyframes.empty())
+            return result;
+        auto next = std::upper_bound(keyframes.begin(), keyframes.end(), result.position_ms);
+        double before = next == keyframes.begin() ? keyframes.front() : *(next - 1);
+        if (result.position_ms - before <= max_ahead) {
+            result.keyframe_ms = before;
+            result.decode_ahead_ms = std::max(0.0, result.position_ms - before);
+            result.accurate = true;
+            return result;
+        }
+        result.keyframe_ms = before;
+        if (next != keyframes.end() && *next - result.position_ms < result.position_ms - before)
+            result.keyframe_ms = *next;
+        result.position_ms = result.keyframe_ms;
+        result.accurate = true;
+        return result;
+    }
+
+    // Queues the build of the index of _video_path unless a valid cache exists, e.g. right
+    // after a package is extracted. A file already queued or being built is not queued again.
+    static void prepare(const std::string& _video_path, const std::string& _cache_dir) {
+        std::vector<double> keyframes;
+        if (load(_cache_dir, _video_path, keyframes))
+            return;
+        Indexer::instance()->enqueue(_video_path, _cache_dir, nullptr, false);
+    }
+
+    static std::string cachePath(const std::string& _cache_dir, const std::string& _video_path) {
+        std::error_code ec;
+        fs::path absolute = fs::absolute(_video_path, ec);
+        std::ostringstream name;
+        name << std::hex << std::hash<std::string>{}(ec ? _video_path : absolute.string()) << ".kfi";
+        return (fs::path(_cache_dir) / name.str()).string();
+    }
+
+    // Keyframe presentation times in ms, sorted, read by demuxing the video track without decoding it
+    static bool build(const std::string& _video_path, std::vector<double>& _keyframes) {
+        _keyframes.clear();
+        gst_init(nullptr, nullptr);
+        std::string description = "filesrc location=\"" + _video_path + "\" ! qtdemux name=demux demux.video_0 ! fakesink name=sink sync=false";
+        GError* error = nullptr;
+        GstElement* pipeline = gst_parse_launch(description.c_str(), &error);
+        if (!pipeline) {
+            LOG_ERROR("KeyframeIndex could not demux " + _video_path + ": " + std::string(error ? error->message : "unknown error"));
+            if (error) g_error_free(error);
+            return false;
+        }
+        if (error)
+            g_error_free(error);
+        GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+        GstPad* pad = sink ? gst_element_get_static_pad(sink, "sink") : nullptr;
+        if (pad) {
+            gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, [](GstPad*, GstPadProbeInfo* _info, gpointer _data) -> GstPadProbeReturn {
+                GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(_info);
+                if (buffer && !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT) && GST_BUFFER_PTS_IS_VALID(buffer))
+                    static_cast<std::vector<double>*>(_data)->push_back(static_cast<double>(GST_BUFFER_PTS(buffer)) / GST_MSECOND);
+                return GST_PAD_PROBE_OK;
+            }, &_keyframes, nullptr);
+            gst_object_unref(pad);
+        }
+        if (sink)
+            gst_object_unref(sink);
+        gst_element_set_state(pipeline, GST_STATE_PLAYING);
+        GstBus* bus = gst_element_get_bus(pipeline);
+        GstMessage* msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, GstMessageType(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        bool ok = msg && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS;
+        if (msg)
+            gst_message_unref(msg);
+        gst_object_unref(bus);
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_object_unref(pipeline);
+        std::sort(_keyframes.begin(), _keyframes.end());
+        _keyframes.erase(std::unique(_keyframes.begin(), _keyframes.end()), _keyframes.end());
+        return ok && !_keyframes.empty();
+    }
+
+    static bool load(const std::string& _cache_dir, const std::string& _video_path, std::vector<double>& _keyframes) {
+        try {
+            std::ifstream in(cachePath(_cache_dir, _video_path));
+            std::string magic, stamp;
+            uintmax_t size = 0;
+            if (!in || !(in >> magic >> size >> stamp) || magic != "KFI1" || size != fs::file_size(_video_path) || stamp != fileStamp(_video_path))
+                return false;
+            _keyframes.clear();
+            double position = 0;
+            while (in >> position)
+                _keyframes.push_back(position);
+            return !_keyframes.empty();
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    static bool save(const std::string& _cache_dir, const std::string& _video_path, const std::vector<double>& _keyframes) {
+        try {
+            fs::create_directories(_cache_dir);
+            std::string path = cachePath(_cache_dir, _video_path);
+            std::string temp = path + ".tmp";
+            {
+                std::ofstream out(temp, std::ios::trunc);
+                out << "KFI1 " << fs::file_size(_video_path) << " " << fileStamp(_video_path) << "\n";
+                for (double position : _keyframes)
+                    out << position << "\n";
+                if (!out)
+                    return false;
+            }
+            fs::rename(temp, path); // readers never see a half written index
+            return true;
+        } catch (const std::exception& e) {
+            LOG_ERROR("An error occurred in KeyframeIndex save: " + std::string(e.what()));
+            return false;
+        }
+    }
+
+private:
+    // Keyframes of the open file, shared with its background build so a later open() does not wait for it
+    class Entries {
+    public:
+        void set(std::vector<double>&& _keyframes) {
+            std::lock_guard<std::mutex> lock(mutex);
+            keyframes = std::move(_keyframes);
+            is_ready = true;
+        }
+        bool ready() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return is_ready;
+        }
+        size_t size() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return keyframes.size();
+        }
+        bool copy(std::vector<double>& _keyframes) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (is_ready)
+                _keyframes = keyframes;
+            return is_ready;
+        }
+    private:
+        std::vector<double> keyframes;
+        bool is_ready = false;
+        std::mutex mutex;
+    };
+
+    Settings settings;
+    std::shared_ptr<Entries> entries;
+    std::mutex mutex;
+
+    std::shared_ptr<Entries> getEntries() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries;
+    }
+
+    static std::string fileStamp(const std::string& _video_path) {
+        return std::to_string(fs::last_write_time(_video_path).time_since_epoch().count());
+    }
+
+    // Builds and caches one index, unless a valid cache appeared while it was queued
+    static bool buildCached(const std::string& _cache_dir, const std::string& _video_path, std::vector<double>& _keyframes) {
+        if (load(_cache_dir, _video_path, _keyframes))
+            return true;
+        auto start = std::chrono::steady_clock::now();
+        bool ok = build(_video_path, _keyframes);
+        if (ok) {
+            save(_cache_dir, _video_path, _keyframes);
+            LOG_INFO("KeyframeIndex built " + std::to_string(_keyframes.size()) + " keyframes of " + _video_path + " in " +
+                     std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()) + " ms");
+        } else {
+            LOG_WARN("KeyframeIndex could not index " + _video_path);
+        }
+        return ok;
+    }
+
+    // The one background worker of the process: builds run one at a time, so indexing a folder
+    // never runs several demuxes against playback. Each path is queued once; open() requests go
+    // to the front and are handed the result, also when the path was already queued or building.
+    class Indexer {
+    public:
+        // Never destroyed, so its detached worker cannot outlive it
+        static Indexer* instance() {
+            static Indexer* const indexer = new Indexer();
+            return indexer;
+        }
+
+        void enqueue(const std::string& _video_path, const std::string& _cache_dir, const std::shared_ptr<Entries>& _target, bool _urgent) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (building && active.video_path == _video_path) {
+                    if (_target)
+                        active.targets.push_back(_target);
+                    return;
+                }
+                auto queued = std::find_if(jobs.begin(), jobs.end(), [&](const Job& _job) { return _job.video_path == _video_path; });
+                Job job;
+                if (queued != jobs.end()) {
+                    job = std::move(*queued);
+                    jobs.erase(queued);
+                } else {
+                    job.video_path = _video_path;
+                    job.cache_dir = _cache_dir;
+                }
+                if (_target)
+                    job.targets.push_back(_target);
+                if (_urgent)
+                    jobs.push_front(std::move(job));
+                else
+                    jobs.push_back(std::move(job));
+                if (!started) {
+                    started = true;
+                    std::thread([this]() { run(); }).detach();
+                }
+            }
+            wake.notify_one();
+        }
+
+    private:
+        struct Job {
+            std::string video_path;
+            std::string cache_dir;
+            std::vector<std::shared_ptr<Entries>> targets;  // open() calls waiting for this index
+        };
+
+        Indexer() = default;
+
+        void run() {
+            while (true) {
+                std::string video_path, cache_dir;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [this]() { return !jobs.empty(); });
+                    active = std::move(jobs.front());
+                    jobs.pop_front();
+                    building = true;
+                    video_path = active.video_path;
+                    cache_dir = active.cache_dir;
+                }
+                std::vector<double> built;
+                bool ok = buildCached(cache_dir, video_path, built);
+                std::vector<std::shared_ptr<Entries>> targets;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    targets = std::move(active.targets);
+                    active = Job();
+                    building = false;
+                }
+                if (!ok)
+                    continue;
+                for (const std::shared_ptr<Entries>& target : targets) {
+                    std::vector<double> keyframes = built;
+                    target->set(std::move(keyframes));
+                }
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<Job> jobs;
+        Job active;
+        bool building = false;
+        bool started = false;
+    };
+};
+#endif // KEYFRAMEINDEX_H
@@ -27,6 +27,7 @@ int main(int argc, char *argv[]) {
 
     try {
         // std::signal(SIGINT, signal_handler);  // Handle Ctrl+C
+        std::signal(SIGUSR1, [](int) { FrameTrace::requestExport(); });  // Export the frame trace on demand
         gst_init(&argc, &argv);
         freopen("/home/x_user/my_camera_project/Outputs.log", "a", stdout);
         freopen("/home/x_user/my_camera_project/Errors.log", "a", stderr);
@@ -29,12 +29,29 @@ HEADERS += camera_viewer.h \
             power_management.h \
             speechThread.h \
             camerareader.h \ 
+            framepool.h \
+            framebus.h \
+            imagekernels.h \
+            gstcapture.h \
+            gststreamer.h \
+            streampacer.h \
+            streamcontroller.h \
+            segmentstore.h \
+            rtpprotection.h \
+            compositor.h \
+            scenemonitor.h \
+            qrscanner.h \
+            videosurface.h \
+            frametrace.h \
             PDFCreator.h \
             videocontroller.h \
             LanguageManager.h \
             FloatingMessage.h \
             imu_classifier_thread.h
 
+# Playback engine shared with video_player
+include(playback.pri)
+
 INCLUDEPATH += /usr/include/opencv4 \
                /usr/include/gstreamer-1.0 \
                /usr/lib/aarch64-linux-gnu/gstreamer-1.0 \
@@ -0,0 +1,19 @@
+# Shared media playback engine (playbackengine.h), header-only.
+# my_camera_project.pro and video_player/video_player.pro include this file.
+
+PLAYBACK_DIR = $$PWD
+
+INCLUDEPATH += $$PLAYBACK_DIR \
+               /usr/include/opencv4 \
+               /usr/include/gstreamer-1.0 \
+               /usr/include/glib-2.0 \
+               /usr/lib/aarch64-linux-gnu/glib-2.0/include
+
+HEADERS += $$PLAYBACK_DIR/playbackengine.h \
+           $$PLAYBACK_DIR/presentscheduler.h \
+           $$PLAYBACK_DIR/keyframeindex.h \
+           $$PLAYBACK_DIR/gstsampleallocator.h \
+           $$PLAYBACK_DIR/framemailbox.h
+
+LIBS += `pkg-config --libs gstreamer-1.0 gstreamer-app-1.0 gstreamer-video-1.0`
+LIBS += -lopencv_core -lpthread
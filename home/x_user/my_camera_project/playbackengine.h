@@ -0,0 +1,634 @@
+#ifndef PLAYBACKENGINE_H
+#define PLAYBACKENGINE_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
+#include "Logger.h"
+#include "gstsampleallocator.h"
+#include "presentscheduler.h"
+#include "keyframeindex.h"
+
+// Media playback engine shared by the helmet app (Videocontroller) and video_player
+// (playback.pri). It plays an MP4 with a single GStreamer playbin: the file is demuxed
+// and decoded once, audio goes to the audio sink and video to an appsink, and both follow
+// the pipeline clock (provided by the audio sink). A presenter thread takes each decoded
+// frame, waits on that clock until the frame's running time is due and hands it to the
+// frame callback; frames that come too late are dropped (PresentScheduler). Picture and
+// sound stay together, also after a seek, which is one flush seek of the whole pipeline.
+// With the file's keyframe index (KeyframeIndex) a seek lands on a keyframe and decodes at
+// most max_decode_ahead_ms after it. Decoded frames wait in a queue bounded by a memory
+// budget (setQueueBudget()), so the decoder works ahead on its own streaming thread and a
+// slow frame, e.g. an I-frame at a scene change, is absorbed before it is due.
+// Frames are cv::Mat headers on the mapped decoder output (GstSampleAllocator), meant to
+// be posted into a FrameMailbox by the callback.
+class PlaybackEngine {
+public:
+    struct SeekStats {
+        uint64_t seeks = 0;
+        uint64_t indexed = 0;             // planned with the keyframe index
+        double last_ms = 0;               // from the seek request to the first frame shown
+        double mean_ms = 0;
+        double max_ms = 0;
+        double mean_decode_ahead_ms = 0;  // of the indexed seeks
+    };
+
+    struct QueueStats {
+        size_t budget_bytes = 0;
+        int capacity_frames = 0;          // frames of the current size that fit the budget
+        int level_frames = 0;             // decoded frames waiting now
+        size_t level_bytes = 0;
+        double mean_level_frames = 0;     // seen by the presenter when it took a frame
+        int min_level_frames = 0;
+        uint64_t underruns = 0;           // the presenter found the queue empty during playback
+    };
+
+    PlaybackEngine() {
+        LOG_INFO("PlaybackEngine Constructor");
+    }
+
+    virtual ~PlaybackEngine() {
+        LOG_INFO("PlaybackEngine Destructor");
+        stop();
+        close();
+    }
+
+    // Deleted copy operations, the presenter thread points at this instance
+    PlaybackEngine(const PlaybackEngine&) = delete;
+    PlaybackEngine& operator=(const PlaybackEngine&) = delete;
+
+    // Called on the presenter thread with each frame when it is due
+    void setFrameCallback(std::function<void(cv::Mat)> _callback) {
+        Frame_callback = _callback;
+    }
+
+    // Called on the presenter thread when the file has played to its end
+    void setEndCallback(std::function<void()> _callback) {
+        End_callback = _callback;
+    }
+
+    // Audio output of the next open(), a gst-launch bin description
+    void setAudioSink(const std::string& _audio_sink) {
+        audio_sink = _audio_sink;
+    }
+
+    // Keyframe index cache and the decode-ahead bound of seeks, used from the next open()
+    void setSeekSettings(const KeyframeIndex::Settings& _settings) {
+        keyframes.configure(_settings);
+    }
+
+    // Memory for decoded frames waiting to be shown, used from the next open(); at least two frames are kept
+    void setQueueBudget(size_t _bytes) {
+        queue_budget = _bytes;
+    }
+
+    // Opens _video_path paused on its first frame, ready for play(); 0 on success, -1 on failure
+    int open(const std::string& _video_path) {
+        try {
+            gst_init(nullptr, nullptr);
+            close();
+            video_path = _video_path;
+            GError* error = nullptr;
+            gchar* uri = gst_filename_to_uri(video_path.c_str(), &error);
+            if (!uri) {
+                LOG_ERROR("Error: Could not open video file " + video_path + ": " + std::string(error ? error->message : "invalid path"));
+                if (error) g_error_free(error);
+                return -1;
+            }
+            pipeline = gst_element_factory_make("playbin", "videoplayer");
+            GstElement* video_bin = gst_parse_bin_from_description(videoSinkDescription().c_str(), TRUE, nullptr);
+            GstElement* audio_bin = gst_parse_bin_from_description(audio_sink.c_str(), TRUE, nullptr);
+            if (!pipeline || !video_bin || !audio_bin) {
+                LOG_ERROR("Failed to create GStreamer playback pipeline.");
+                if (video_bin) gst_object_unref(video_bin);
+                if (audio_bin) gst_object_unref(audio_bin);
+                g_free(uri);
+                close();
+                return -1;
+            }
+            appsink = gst_bin_get_by_name(GST_BIN(video_bin), "videosink");
+            decoded = gst_bin_get_by_name(GST_BIN(video_bin), "decoded");
+            g_object_set(pipeline, "uri", uri, "video-sink", video_bin, "audio-sink", audio_bin, "volume", volume / 100.0, nullptr);
+            g_free(uri);
+
+            // Preroll to learn the frame geometry and rate before playing
+            gst_element_set_state(pipeline, GST_STATE_PAUSED);
+            if (gst_element_get_state(pipeline, nullptr, nullptr, 5 * GST_SECOND) == GST_STATE_CHANGE_FAILURE || !readCaps()) {
+                LOG_ERROR("Error: Could not open video file " + video_path);
+                logBusErrors();
+                close();
+                return -1;
+            }
+            LOG_INFO("PlaybackEngine " + std::to_string(width) + "x" + std::to_string(height) + " @ " + std::to_string(fps) + ", frame queue " +
+                     std::to_string(queue_budget / (1024 * 1024)) + " MB = " + std::to_string(queueCapacity()) + " frames");
+            if (decoded) // a budget below two frames of this size would serialize decoding and presenting
+                g_object_set(decoded, "max-size-bytes", static_cast<guint>(std::max(queue_budget, 2 * stride * static_cast<size_t>(height))), nullptr);
+            scheduler.reset(fps);
+            resetQueueStats();
+            keyframes.open(video_path);
+            isStop = false;
+            isPause = true;
+            return 0;
+        } catch (const std::exception& e) {
+            LOG_ERROR("PlaybackEngine open error: " + std::string(e.what()));
+            return -1;
+        }
+    }
+
+    // Plays from the current position; after stop() or the end, from the beginning
+    void play() {
+        if (!pipeline)
+            return;
+        stopPresenter();
+        gst_element_set_state(pipeline, GST_STATE_PLAYING);
+        startPresenter();
+        isStop = false;
+        isPause = false;
+    }
+
+    void pause() {
+        if (!pipeline || isPause)
+            return;
+        gst_element_set_state(pipeline, GST_STATE_PAUSED);
+        stopPresenter();
+        isPause = true;
+    }
+
+    // The running time excludes the pause, the frame that was waiting is still on time
+    void togglePause() {
+        if (isPause)
+            play();
+        else
+            pause();
+    }
+
+    // Back to the start: the next play() plays the file from the beginning
+    void stop() {
+        if (!pipeline)
+            return;
+        stopPresenter();
+        dropPending();
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        last_pts_ms = -1;
+        isStop = true;
+        isPause = true;
+        logStats();
+    }
+
+    // Frees the pipeline, open() is needed before playing again
+    void close() {
+        stopPresenter();
+        isStop = true;
+        isPause = true;
+        dropPending();
+        if (pipeline) {
+            gst_element_set_state(pipeline, GST_STATE_NULL);
+        }
+        if (appsink) {
+            gst_object_unref(appsink);
+            appsink = nullptr;
+        }
+        if (decoded) {
+            gst_object_unref(decoded);
+            decoded = nullptr;
+        }
+        if (pipeline) {
+            gst_object_unref(pipeline);
+            pipeline = nullptr;
+        }
+        if (current_caps) {
+            gst_caps_unref(current_caps);
+            current_caps = nullptr;
+        }
+        last_pts_ms = -1;
+    }
+
+    // The one seek path: a flush seek of the whole pipeline, audio and video restart together.
+    // With the keyframe index the target is reached exactly when it is at most max_decode_ahead_ms
+    // after a keyframe, else the seek goes to the nearest keyframe; without it, to the keyframe
+    // at or before _position_ms. The time until the first frame is shown is the seek latency.
+    void seekTo(double _position_ms) {
+        if (!pipeline)
+            return;
+        auto start = std::chrono::steady_clock::now();
+        double duration = getDuration();
+        if (duration > 0)
+            _position_ms = std::min(_position_ms, duration);
+        KeyframeIndex::Plan plan = keyframes.plan(_position_ms);
+        stopPresenter(); // no frame reading during the seek
+        dropPending();
+        GstSeekFlags flags = GstSeekFlags(GST_SEEK_FLAG_FLUSH | (plan.accurate ? GST_SEEK_FLAG_ACCURATE : GST_SEEK_FLAG_KEY_UNIT));
+        gst_element_seek_simple(pipeline, GST_FORMAT_TIME, flags, static_cast<gint64>(plan.position_ms * GST_MSECOND));
+        last_pts_ms = -1;
+        {
+            std::lock_guard<std::mutex> lock(seek_mutex);
+            seek_start = start;
+            seek_plan = plan;
+            seek_target_ms = _position_ms;
+            seek_pending = true;
+        }
+        if (!isStop && !isPause) // only restart if playback isn’t stopped or paused
+            startPresenter();
+    }
+
+    // Relative seek from getPosition(), _delta_ms < 0 goes back
+    void seekBy(double _delta_ms) {
+        if (!pipeline)
+            return;
+        seekTo(std::max(getPosition() + _delta_ms, 0.0));
+    }
+
+    // 0-100, the playbin volume; kept for the next open() when nothing is open
+    void setVolume(int _volume) {
+        volume = std::max(0, std::min(_volume, 100));
+        if (pipeline)
+            g_object_set(pipeline, "volume", volume / 100.0, nullptr);
+    }
+
+    int getVolume() {
+        LOG_INFO("getVolume " + std::to_string(volume));
+        return volume;
+    }
+
+    // Playback position in ms: the pipeline position, else the last presented frame
+    double getPosition() {
+        gint64 position = 0;
+        if (pipeline && gst_element_query_position(pipeline, GST_FORMAT_TIME, &position) && position >= 0)
+            return static_cast<double>(position) / GST_MSECOND;
+        return std::max(last_pts_ms.load(), 0.0);
+    }
+
+    // Stream time of the last frame handed to the frame callback, -1 before the first one
+    double getFramePosition() const {
+        return last_pts_ms;
+    }
+
+    // Length of the open file in ms, 0 when unknown
+    double getDuration() {
+        gint64 duration = 0;
+        if (pipeline && gst_element_query_duration(pipeline, GST_FORMAT_TIME, &duration) && duration > 0)
+            return static_cast<double>(duration) / GST_MSECOND;
+        return 0;
+    }
+
+    double getFps() const {
+        return fps;
+    }
+
+    bool isStopped() const {
+        return isStop;
+    }
+
+    bool isPaused() const {
+        return isPause;
+    }
+
+    // Presented, dropped and late-by statistics since open()
+    PresentScheduler::Stats getPresentStats() {
+        return scheduler.getStats();
+    }
+
+    // Seek latencies since the engine was created
+    SeekStats getSeekStats() {
+        std::lock_guard<std::mutex> lock(seek_mutex);
+        return seek_stats;
+    }
+
+    bool hasKeyframeIndex() {
+        return keyframes.isReady();
+    }
+
+    // Budget, capacity and occupancy of the decoded frame queue, the level read now
+    QueueStats getQueueStats() {
+        QueueStats stats;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            stats = queue_stats;
+        }
+        stats.budget_bytes = queue_budget;
+        stats.capacity_frames = queueCapacity();
+        readQueueLevel(stats.level_frames, stats.level_bytes);
+        return stats;
+    }
+
+private:
+    std::string video_path;
+    std::atomic<bool> isStop{true};
+    std::atomic<bool> isPause{true};
+    int volume = 35;
+    GstElement *pipeline = nullptr;
+    // Video end of the playbin, BGR frames pulled by PlayFrame()
+    GstElement *appsink = nullptr;
+    // Queue of decoded frames before the appsink, its streaming thread decouples decoding from presenting
+    GstElement *decoded = nullptr;
+    size_t queue_budget = 48 * 1024 * 1024;
+    std::mutex queue_mutex;
+    QueueStats queue_stats;
+    uint64_t queue_samples = 0;
+    std::string audio_sink = "audioconvert ! audioresample ! pulsesink device=alsa_output.platform-sound-wm8904.stereo-fallback";
+    // Presenter thread, and the clock wait it may be blocked in so stopPresenter() can cut it short
+    std::thread presenter;
+    std::atomic<bool> presenting{false};
+    std::mutex wait_mutex;
+    GstClockID wait_id = nullptr;
+    PresentScheduler scheduler;
+    KeyframeIndex keyframes;
+    // The seek waiting for its first frame, and the latencies so far
+    std::mutex seek_mutex;
+    bool seek_pending = false;
+    std::chrono::steady_clock::time_point seek_start;
+    KeyframeIndex::Plan seek_plan;
+    double seek_target_ms = 0;
+    SeekStats seek_stats;
+    double fps = 25;
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;
+    GstCaps* current_caps = nullptr;
+    // Decoded frame waiting for its presentation time
+    GstSample* pending = nullptr;
+    std::atomic<double> last_pts_ms{-1};
+    // Frames handed out keep their sample mapped, no copy out of the appsink
+    std::function<void(cv::Mat)> Frame_callback;
+    std::function<void()> End_callback;
+
+    void startPresenter() {
+        if (presenting)
+            return;
+        if (presenter.joinable())
+            presenter.join(); // ended by itself at the end of the stream
+        presenting = true;
+        presenter = std::thread([this]() {
+            while (presenting) {
+                PlayFrame();
+            }
+        });
+    }
+
+    void stopPresenter() {
+        presenting = false;
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex);
+            if (wait_id)
+                gst_clock_id_unschedule(wait_id);
+        }
+        if (presenter.joinable() && presenter.get_id() != std::this_thread::get_id())
+            presenter.join();
+    }
+
+    // One frame: takes the next decoded frame (waiting at most 100 ms so the thread can be
+    // stopped), waits on the pipeline clock until it is due and presents or drops it
+    void PlayFrame() {
+        if (!appsink) {
+            presenting = false;
+            return;
+        }
+        if (!pending) {
+            pending = gst_app_sink_try_pull_sample(GST_APP_SINK(appsink), 0);
+            if (pending) {
+                sampleQueueLevel();
+            } else if (!gst_app_sink_is_eos(GST_APP_SINK(appsink))) {
+                countUnderrun();
+                pending = gst_app_sink_try_pull_sample(GST_APP_SINK(appsink), 100 * GST_MSECOND);
+            }
+        }
+        if (!pending) {
+            if (gst_app_sink_is_eos(GST_APP_SINK(appsink))) {
+                // End of video, the presenter ends itself; the next play() restarts the file
+                LOG_INFO("PlaybackEngine end of video");
+                presenting = false;
+                gst_element_set_state(pipeline, GST_STATE_NULL);
+                isStop = true;
+                isPause = true;
+                logStats();
+                if (End_callback)
+                    End_callback();
+            }
+            return;
+        }
+        GstClockTime due = runningTime(pending);
+        GstClock* clock = gst_element_get_clock(pipeline);
+        PresentScheduler::Action action = PresentScheduler::Action::Present;
+        if (clock && due != GST_CLOCK_TIME_NONE) {
+            GstClockTime base = gst_element_get_base_time(pipeline);
+            action = scheduler.decide(toMs(due), toMs(gst_clock_get_time(clock) - base));
+            if (action == PresentScheduler::Action::Wait) {
+                if (!waitUntil(clock, base + due)) {
+                    gst_object_unref(clock);
+                    return; // interrupted, the frame stays pending
+                }
+                action = scheduler.decide(toMs(due), toMs(gst_clock_get_time(clock) - base));
+            }
+        }
+        if (clock)
+            gst_object_unref(clock);
+        GstSample* sample = pending;
+        pending = nullptr;
+        if (action == PresentScheduler::Action::Drop) {
+            gst_sample_unref(sample);
+            return;
+        }
+        GstBuffer* buffer = gst_sample_get_buffer(sample);
+        GstCaps* caps = gst_sample_get_caps(sample);
+        if (caps && caps != current_caps && !readCaps(caps)) {
+            gst_sample_unref(sample);
+            return;
+        }
+        size_t _stride = stride;
+        if (buffer) {
+            if (GST_BUFFER_PTS_IS_VALID(buffer))
+                last_pts_ms = static_cast<double>(GST_BUFFER_PTS(buffer)) / GST_MSECOND;
+            GstVideoMeta* meta = gst_buffer_get_video_meta(buffer);
+            if (meta)
+                _stride = meta->stride[0];
+        }
+        cv::Mat frame = GstSampleAllocator::instance()->wrap(sample, height, width, CV_8UC3, _stride);
+        if (!frame.empty() && Frame_callback) {
+            Frame_callback(frame);
+        }
+        seekDone();
+    }
+
+    // Blocks until _time on _clock; false when stopPresenter() unscheduled the wait
+    bool waitUntil(GstClock* _clock, GstClockTime _time) {
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex);
+            if (!presenting)
+                return false;
+            wait_id = gst_clock_new_single_shot_id(_clock, _time);
+        }
+        GstClockReturn result = gst_clock_id_wait(wait_id, nullptr);
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        gst_clock_id_unref(wait_id);
+        wait_id = nullptr;
+        return result != GST_CLOCK_UNSCHEDULED && presenting;
+    }
+
+    // Running time of the sample's PTS in its segment, GST_CLOCK_TIME_NONE when it has none
+    static GstClockTime runningTime(GstSample* _sample) {
+        GstBuffer* buffer = gst_sample_get_buffer(_sample);
+        const GstSegment* segment = gst_sample_get_segment(_sample);
+        if (!buffer || !segment || !GST_BUFFER_PTS_IS_VALID(buffer))
+            return GST_CLOCK_TIME_NONE;
+        return gst_segment_to_running_time(segment, GST_FORMAT_TIME, GST_BUFFER_PTS(buffer));
+    }
+
+    static double toMs(GstClockTime _time) {
+        return static_cast<double>(_time) / GST_MSECOND;
+    }
+
+    // BGR conversion on the decoder's streaming thread, then the decoded frame queue bounded by bytes only
+    std::string videoSinkDescription() {
+        return "videoconvert ! video/x-raw,format=BGR ! queue name=decoded max-size-buffers=0 max-size-time=0 max-size-bytes=" +
+               std::to_string(queue_budget) + " ! appsink name=videosink sync=false max-buffers=1 drop=false";
+    }
+
+    int queueCapacity() {
+        size_t frame_bytes = stride * static_cast<size_t>(height);
+        return frame_bytes > 0 ? static_cast<int>(std::max<size_t>(queue_budget / frame_bytes, 2)) : 0;
+    }
+
+    void readQueueLevel(int& _frames, size_t& _bytes) {
+        _frames = 0;
+        _bytes = 0;
+        if (!decoded)
+            return;
+        guint buffers = 0;
+        guint bytes = 0;
+        g_object_get(decoded, "current-level-buffers", &buffers, "current-level-bytes", &bytes, nullptr);
+        _frames = static_cast<int>(buffers);
+        _bytes = bytes;
+    }
+
+    // Level when the presenter takes a frame: how far the decoder is ahead
+    void sampleQueueLevel() {
+        int frames = 0;
+        size_t bytes = 0;
+        readQueueLevel(frames, bytes);
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queue_samples++;
+        queue_stats.mean_level_frames += (frames - queue_stats.mean_level_frames) / queue_samples;
+        queue_stats.min_level_frames = queue_samples == 1 ? frames : std::min(queue_stats.min_level_frames, frames);
+    }
+
+    // An empty queue right after a seek is expected, later the decoder fell behind
+    void countUnderrun() {
+        {
+            std::lock_guard<std::mutex> lock(seek_mutex);
+            if (seek_pending)
+                return;
+        }
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (queue_samples > 0)
+            queue_stats.underruns++;
+    }
+
+    void resetQueueStats() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queue_stats = QueueStats();
+        queue_samples = 0;
+    }
+
+    // The first frame after a seek was shown: records the seek latency
+    void seekDone() {
+        std::lock_guard<std::mutex> lock(seek_mutex);
+        if (!seek_pending)
+            return;
+        seek_pending = false;
+        double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - seek_start).count();
+        seek_stats.seeks++;
+        seek_stats.last_ms = latency;
+        seek_stats.mean_ms += (latency - seek_stats.mean_ms) / seek_stats.seeks;
+        seek_stats.max_ms = std::max(seek_stats.max_ms, latency);
+        if (seek_plan.keyframe_ms >= 0) {
+            seek_stats.indexed++;
+            seek_stats.mean_decode_ahead_ms += (seek_plan.decode_ahead_ms - seek_stats.mean_decode_ahead_ms) / seek_stats.indexed;
+        }
+        LOG_INFO("PlaybackEngine seek to " + std::to_string(static_cast<int>(seek_target_ms)) + " ms" +
+                 (seek_plan.keyframe_ms >= 0 ? " (keyframe " + std::to_string(static_cast<int>(seek_plan.keyframe_ms)) + " ms, decode-ahead " +
+                                                   std::to_string(static_cast<int>(seek_plan.decode_ahead_ms)) + " ms)"
+                                             : std::string(" (no keyframe index)")) +
+                 " shown at " + std::to_string(static_cast<int>(last_pts_ms.load())) + " ms after " + std::to_string(latency) + " ms");
+    }
+
+    // Presentation, seek and frame queue statistics, on stop and at the end of the file
+    void logStats() {
+        scheduler.logStats("video");
+        SeekStats seeks = getSeekStats();
+        if (seeks.seeks > 0)
+            LOG_INFO("PlaybackEngine seeks " + std::to_string(seeks.seeks) + " (indexed " + std::to_string(seeks.indexed) + ", mean decode-ahead " +
+                     std::to_string(seeks.mean_decode_ahead_ms) + " ms), latency mean " + std::to_string(seeks.mean_ms) + " ms, max " +
+                     std::to_string(seeks.max_ms) + " ms");
+        QueueStats queue = getQueueStats();
+        LOG_INFO("PlaybackEngine frame queue " + std::to_string(queue.budget_bytes / (1024 * 1024)) + " MB (" + std::to_string(queue.capacity_frames) +
+                 " frames): mean level " + std::to_string(queue.mean_level_frames) + " frames, min " + std::to_string(queue.min_level_frames) +
+                 ", underruns " + std::to_string(queue.underruns));
+    }
+
+    void dropPending() {
+        if (pending) {
+            gst_sample_unref(pending);
+            pending = nullptr;
+        }
+    }
+
+    // Negotiated frame geometry from the appsink pad
+    bool readCaps() {
+        if (!appsink)
+            return false;
+        GstPad* pad = gst_element_get_static_pad(appsink, "sink");
+        if (!pad)
+            return false;
+        GstCaps* caps = gst_pad_get_current_caps(pad);
+        gst_object_unref(pad);
+        if (!caps)
+            return false;
+        bool ok = readCaps(caps);
+        gst_caps_unref(caps);
+        return ok;
+    }
+
+    bool readCaps(GstCaps* _caps) {
+        GstVideoInfo info;
+        if (!gst_video_info_from_caps(&info, _caps) || GST_VIDEO_INFO_FORMAT(&info) != GST_VIDEO_FORMAT_BGR)
+            return false;
+        width = GST_VIDEO_INFO_WIDTH(&info);
+        height = GST_VIDEO_INFO_HEIGHT(&info);
+        stride = GST_VIDEO_INFO_PLANE_STRIDE(&info, 0);
+        if (GST_VIDEO_INFO_FPS_N(&info) > 0 && GST_VIDEO_INFO_FPS_D(&info) > 0)
+            fps = static_cast<double>(GST_VIDEO_INFO_FPS_N(&info)) / GST_VIDEO_INFO_FPS_D(&info);
+        else
+            fps = 25; // Default if the file has no frame rate
+        if (current_caps)
+            gst_caps_unref(current_caps);
+        current_caps = gst_caps_ref(_caps);
+        return width > 0 && height > 0;
+    }
+
+    void logBusErrors() {
+        if (!pipeline)
+            return;
+        GstBus* bus = gst_element_get_bus(pipeline);
+        GstMessage* msg = nullptr;
+        while ((msg = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR)) != nullptr) {
+            GError* err = nullptr;
+            gchar* debug = nullptr;
+            gst_message_parse_error(msg, &err, &debug);
+            LOG_ERROR("PlaybackEngine pipeline error: " + std::string(err ? err->message : "Unknown error"));
+            if (err) g_error_free(err);
+            g_free(debug);
+            gst_message_unref(msg);
+        }
+        gst_object_unref(bus);
+    }
+};
+#endif // PLAYBACKENGINE_H
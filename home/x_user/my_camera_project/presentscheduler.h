@@ -0,0 +1,104 @@
+#ifndef PRESENTSCHEDULER_H
+#define PRESENTSCHEDULER_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <mutex>
+#include <algorithm>
+#include "Logger.h"
+
+// Decides when a decoded video frame is shown, from its due time and the current time
+// on the playback clock (both in ms of running time). An early frame waits until it is
+// due; a frame late by more than the drop threshold is dropped, because the next one is
+// already due, so lag never accumulates. At most max_drop_run frames in a row are dropped,
+// so a decoder that is slow for a while still updates the picture.
+class PresentScheduler {
+public:
+    enum class Action {
+        Wait,     // not due yet, wait until the due time and decide again
+        Present,  // show it now
+        Drop      // too late, skip it
+    };
+
+    struct Settings {
+        double late_drop_ms = 0;    // lateness beyond which a frame is dropped, 0 = one frame interval
+        int max_drop_run = 4;       // frames dropped in a row before one is shown regardless
+    };
+
+    struct Stats {
+        uint64_t presented = 0;
+        uint64_t dropped = 0;
+        uint64_t late = 0;          // presented more than a quarter interval after their due time
+        double mean_late_ms = 0;    // lateness of the presented frames
+        double max_late_ms = 0;
+        double mean_dropped_late_ms = 0;
+        double fps = 0;
+    };
+
+    explicit PresentScheduler(double _fps = 25) {
+        reset(_fps);
+    }
+
+    // Starts over at _fps, e.g. for a new file
+    void reset(double _fps) {
+        std::lock_guard<std::mutex> lock(mutex);
+        interval_ms = 1000.0 / (_fps > 0 ? _fps : 25);
+        drop_run = 0;
+        stats = Stats();
+        stats.fps = 1000.0 / interval_ms;
+    }
+
+    void configure(const Settings& _settings) {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings = _settings;
+        settings.max_drop_run = std::max(0, settings.max_drop_run);
+    }
+
+    Action decide(double _due_ms, double _now_ms) {
+        std::lock_guard<std::mutex> lock(mutex);
+        double late = _now_ms - _due_ms;
+        if (late < 0)
+            return Action::Wait;
+        double threshold = settings.late_drop_ms > 0 ? settings.late_drop_ms : interval_ms;
+        if (late > threshold && drop_run < settings.max_drop_run) {
+            drop_run++;
+            stats.dropped++;
+            stats.mean_dropped_late_ms += (late - stats.mean_dropped_late_ms) / stats.dropped;
+            return Action::Drop;
+        }
+        drop_run = 0;
+        stats.presented++;
+        if (late > interval_ms / 4)
+            stats.late++;
+        stats.mean_late_ms += (late - stats.mean_late_ms) / stats.presented;
+        stats.max_late_ms = std::max(stats.max_late_ms, late);
+        return Action::Present;
+    }
+
+    double getInterval() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return interval_ms;
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    void logStats(const std::string& _name) {
+        Stats _stats = getStats();
+        LOG_INFO("PresentScheduler " + _name + " @ " + std::to_string(_stats.fps) + " fps presented " + std::to_string(_stats.presented) +
+                 " (late " + std::to_string(_stats.late) + ", mean " + std::to_string(_stats.mean_late_ms) + " ms, max " +
+                 std::to_string(_stats.max_late_ms) + " ms), dropped " + std::to_string(_stats.dropped) + " (mean " +
+                 std::to_string(_stats.mean_dropped_late_ms) + " ms late)");
+    }
+
+private:
+    Settings settings;
+    double interval_ms = 40;
+    int drop_run = 0;
+    Stats stats;
+    std::mutex mutex;
+};
+#endif // PRESENTSCHEDULER_H
@@ -0,0 +1,207 @@
+#ifndef QRSCANNER_H
+#define QRSCANNER_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <zbar.h>
+#include "Logger.h"
+// Undefine the Status macro before including OpenCV to prevent conflict with X11
+#undef Status
+#include <opencv2/opencv.hpp>
+#include "framebus.h"
+
+// QR code scanner running on its own frame bus subscription. Frames arrive as
+// full-resolution luma (straight from the YUY2 Y samples), so nothing is scaled or
+// converted on the GUI thread. Each frame is tried in passes, cheapest first: the
+// centre of the view at full resolution, where a code held up to the camera usually
+// is, then the whole frame at each of the scales. The first pass that decodes
+// ends the frame. Each distinct payload is delivered once per start().
+class QrScanner {
+public:
+    struct Settings {
+        double fps = 4;                      // frames scanned per second
+        int roi_percent = 50;                // centre region, in percent of the frame width and height, 0 = none
+        std::vector<double> scales = {0.5, 1.0};  // whole-frame passes, smallest first
+    };
+
+    struct Stats {
+        uint64_t scanned = 0;
+        uint64_t decoded = 0;                // frames with a QR code
+        uint64_t roi_hits = 0;               // decoded in the centre pass
+        uint64_t full_hits = 0;              // decoded in a whole-frame pass
+        double mean_scan_ms = 0;
+        double max_scan_ms = 0;
+        double first_decode_ms = -1;         // start() to the first payload, -1 = none yet
+        uint64_t frames_to_first = 0;        // frames scanned until the first payload
+    };
+
+    QrScanner() {
+        LOG_INFO("QrScanner Constructor");
+        // QR codes only, the other symbologies would be searched in every pass
+        scanner.set_config(zbar::ZBAR_NONE, zbar::ZBAR_CFG_ENABLE, 0);
+        scanner.set_config(zbar::ZBAR_QRCODE, zbar::ZBAR_CFG_ENABLE, 1);
+    }
+
+    void configure(const Settings& _settings) {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings = _settings;
+        settings.fps = std::max(0.1, settings.fps);
+        settings.roi_percent = std::clamp(settings.roi_percent, 0, 100);
+        settings.scales.erase(std::remove_if(settings.scales.begin(), settings.scales.end(),
+                                             [](double s) { return s <= 0 || s > 1; }),
+                              settings.scales.end());
+        if (settings.scales.empty())
+            settings.scales.push_back(1.0);
+        std::sort(settings.scales.begin(), settings.scales.end());
+    }
+
+    Settings getSettings() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return settings;
+    }
+
+    // Frame bus subscription for the scanner: luma at the capture resolution, latest only
+    FrameBus::Options busOptions() {
+        std::lock_guard<std::mutex> lock(mutex);
+        FrameBus::Options options;
+        options.name = "qrcode";
+        options.max_fps = settings.fps;
+        options.policy = FrameBus::Policy::LatestOnly;
+        options.format = FrameBus::Format::GRAY;
+        return options;
+    }
+
+    // _on_payload runs on the scanning thread, once for each distinct payload
+    void start(std::function<void(const std::string&)> _on_payload) {
+        std::lock_guard<std::mutex> lock(mutex);
+        on_payload = _on_payload;
+        delivered.clear();
+        stats = Stats();
+        start_time = std::chrono::steady_clock::now();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            on_payload = nullptr;
+        }
+        logStats();
+    }
+
+    // Scans one CV_8UC1 frame, called from the frame bus subscriber thread
+    void process(const cv::Mat& _gray) {
+        try {
+            if (_gray.empty() || _gray.type() != CV_8UC1)
+                return;
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!on_payload)
+                return;
+            auto begin = std::chrono::steady_clock::now();
+            std::vector<std::string> payloads;
+            bool in_roi = false;
+            cv::Rect roi = centre(_gray.size(), settings.roi_percent);
+            if (roi.area() > 0) {
+                // zbar wants a contiguous plane, the centre region is copied out
+                _gray(roi).copyTo(roi_plane);
+                in_roi = scan(roi_plane, payloads);
+            }
+            if (!in_roi) {
+                for (double scale : settings.scales) {
+                    if (scale >= 1.0 && _gray.isContinuous()) {
+                        if (scan(_gray, payloads))
+                            break;
+                        continue;
+                    }
+                    cv::resize(_gray, scaled_plane, cv::Size(std::max(1, static_cast<int>(_gray.cols * scale)),
+                               std::max(1, static_cast<int>(_gray.rows * scale))), 0, 0, cv::INTER_AREA);
+                    if (scan(scaled_plane, payloads))
+                        break;
+                }
+            }
+            auto end = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+            stats.scanned++;
+            stats.mean_scan_ms += (ms - stats.mean_scan_ms) / stats.scanned;
+            stats.max_scan_ms = std::max(stats.max_scan_ms, ms);
+            if (payloads.empty())
+                return;
+            stats.decoded++;
+            if (in_roi)
+                stats.roi_hits++;
+            else
+                stats.full_hits++;
+            std::vector<std::string> fresh;
+            for (const std::string& payload : payloads) {
+                if (delivered.insert(payload).second)
+                    fresh.push_back(payload);
+            }
+            if (fresh.empty())
+                return;
+            if (stats.first_decode_ms < 0) {
+                stats.first_decode_ms = std::chrono::duration<double, std::milli>(end - start_time).count();
+                stats.frames_to_first = stats.scanned;
+                LOG_INFO("QrScanner first decode after " + std::to_string(stats.first_decode_ms) + " ms, " +
+                         std::to_string(stats.frames_to_first) + " frames, " + (in_roi ? "centre" : "full frame"));
+            }
+            auto callback = on_payload;
+            lock.unlock();
+            for (const std::string& payload : fresh)
+                callback(payload);
+        } catch (const std::exception& e) {
+            LOG_ERROR("An error occurred in QrScanner process: " + std::string(e.what()));
+        }
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    void logStats() {
+        Stats _stats = getStats();
+        LOG_INFO("QrScanner scanned " + std::to_string(_stats.scanned) + " (" + std::to_string(_stats.mean_scan_ms) + " ms, max " +
+                 std::to_string(_stats.max_scan_ms) + " ms), decoded " + std::to_string(_stats.decoded) + " (centre " +
+                 std::to_string(_stats.roi_hits) + ", full " + std::to_string(_stats.full_hits) + "), first decode " +
+                 (_stats.first_decode_ms < 0 ? std::string("none") : std::to_string(_stats.first_decode_ms) + " ms"));
+    }
+
+    // Centre region covering _percent of each dimension
+    static cv::Rect centre(cv::Size _size, int _percent) {
+        if (_percent <= 0 || _percent >= 100)
+            return cv::Rect();
+        int width = _size.width * _percent / 100;
+        int height = _size.height * _percent / 100;
+        return cv::Rect((_size.width - width) / 2, (_size.height - height) / 2, width, height);
+    }
+
+private:
+    Settings settings;
+    zbar::ImageScanner scanner;
+    std::function<void(const std::string&)> on_payload;
+    std::set<std::string> delivered;
+    Stats stats;
+    std::chrono::steady_clock::time_point start_time;
+    // Reused planes for the centre copy and the scaled passes
+    cv::Mat roi_plane;
+    cv::Mat scaled_plane;
+    std::mutex mutex;
+
+    bool scan(const cv::Mat& _plane, std::vector<std::string>& _payloads) {
+        zbar::Image image(_plane.cols, _plane.rows, "Y800", _plane.data, static_cast<unsigned long>(_plane.cols) * _plane.rows);
+        if (scanner.scan(image) <= 0)
+            return false;
+        for (auto symbol = image.symbol_begin(); symbol != image.symbol_end(); ++symbol) {
+            if (symbol->get_type() == zbar::ZBAR_QRCODE)
+                _payloads.push_back(symbol->get_data());
+        }
+        return !_payloads.empty();
+    }
+};
+#endif // QRSCANNER_H
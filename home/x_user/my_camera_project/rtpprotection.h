@@ -0,0 +1,365 @@
+#ifndef RTPPROTECTION_H
+#define RTPPROTECTION_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include "Logger.h"
+
+// Packet loss protection for the RTP session of an rtpbin named "rtpbin", on the
+// sending and on the receiving side of a call. Both ends run the AVPF profile so
+// feedback is sent immediately instead of on the regular RTCP interval.
+// - nack: the receiver's jitterbuffer asks for missing packets, the sender keeps
+//   its recent packets in an rtprtxsend and retransmits them (RFC 4588, SSRC
+//   multiplexed on the media port).
+// - fec_percentage: the sender adds ULPFEC packets (RFC 5109) worth that share of
+//   the media packets, the receiver rebuilds lost packets from them without a
+//   round trip.
+// - keyframes: a loss neither of them repaired makes the receiver ask for a
+//   keyframe (PLI). The sender forwards those requests to the encoder at most
+//   once per keyframe_interval_ms, so a bad link cannot turn every frame into an IDR.
+class RtpProtection {
+public:
+    struct Settings {
+        bool nack = false;
+        int fec_percentage = 0;           // ULPFEC overhead in percent of the media packets, 0 = off (receiver: > 0 decodes FEC)
+        int rtx_time_ms = 500;            // sender retransmission history
+        int keyframe_interval_ms = 1000;  // minimum spacing of keyframes forced by requests
+        int payload = 96;                 // media payload type
+        int rtx_payload = 97;
+        int fec_payload = 122;
+        int clock_rate = 90000;
+    };
+
+    struct Stats {
+        uint64_t rtx_requests = 0;         // packets NACKed (sender: by the receiver, receiver: by us)
+        uint64_t rtx_packets = 0;          // retransmissions sent (sender) or received for a missing packet (receiver)
+        uint64_t fec_protected = 0;        // sender: media packets covered by FEC
+        uint64_t fec_recovered = 0;        // receiver: packets rebuilt from FEC
+        uint64_t lost = 0;                 // receiver: packets neither retransmitted nor rebuilt in time
+        uint64_t keyframe_requests = 0;    // sender: requests that reached the encoder, receiver: PLIs sent
+        uint64_t keyframes_throttled = 0;  // requests dropped by keyframe_interval_ms
+    };
+
+    RtpProtection() {
+        LOG_INFO("RtpProtection Constructor");
+    }
+
+    ~RtpProtection() {
+        detach();
+    }
+
+    // Deleted copy operations, the signal handlers point at this object
+    RtpProtection(const RtpProtection&) = delete;
+    RtpProtection& operator=(const RtpProtection&) = delete;
+
+    // Takes effect with the next attach
+    void configure(const Settings& _settings) {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings = _settings;
+    }
+
+    Settings getSettings() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return settings;
+    }
+
+    bool isEnabled() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return settings.nack || settings.fec_percentage > 0;
+    }
+
+    // Hooks into a sending pipeline before it goes to PLAYING. _encoder (may be null) gets the
+    // keyframe requests. Returns false when the pipeline has no rtpbin, keyframe requests still work.
+    bool attachSender(GstElement* _pipeline, GstElement* _encoder) {
+        detach();
+        std::lock_guard<std::mutex> lock(mutex);
+        stats = Stats();
+        last_keyframe = std::chrono::steady_clock::time_point();
+        sender = true;
+        if (_encoder) {
+            keyframe_pad = gst_element_get_static_pad(_encoder, "src");
+            if (keyframe_pad)
+                gst_pad_add_probe(keyframe_pad, GST_PAD_PROBE_TYPE_EVENT_UPSTREAM, &RtpProtection::keyframeProbe, this, nullptr);
+        }
+        rtpbin = gst_bin_get_by_name(GST_BIN(_pipeline), "rtpbin");
+        if (!rtpbin)
+            return false;
+        if (settings.nack || settings.fec_percentage > 0)
+            gst_util_set_object_arg(G_OBJECT(rtpbin), "rtp-profile", "avpf");
+        if (settings.nack)
+            g_signal_connect(rtpbin, "request-aux-sender", G_CALLBACK(&RtpProtection::requestAuxSender), this);
+        if (settings.fec_percentage > 0)
+            g_signal_connect(rtpbin, "request-fec-encoder", G_CALLBACK(&RtpProtection::requestFecEncoder), this);
+        LOG_INFO("RtpProtection sender nack " + std::to_string(settings.nack) + ", fec " + std::to_string(settings.fec_percentage) + "%");
+        return true;
+    }
+
+    // Hooks into a receiving pipeline before it goes to PLAYING. Returns false when it has no rtpbin.
+    bool attachReceiver(GstElement* _pipeline) {
+        detach();
+        std::lock_guard<std::mutex> lock(mutex);
+        stats = Stats();
+        last_keyframe = std::chrono::steady_clock::time_point();
+        rtpbin = gst_bin_get_by_name(GST_BIN(_pipeline), "rtpbin");
+        if (!rtpbin)
+            return false;
+        sender = false;
+        gst_util_set_object_arg(G_OBJECT(rtpbin), "rtp-profile", "avpf");
+        // Lost packets become events, which is what triggers the keyframe requests
+        g_object_set(rtpbin, "do-lost", TRUE, "do-retransmission", settings.nack ? TRUE : FALSE, nullptr);
+        g_signal_connect(rtpbin, "new-jitterbuffer", G_CALLBACK(&RtpProtection::newJitterbuffer), this);
+        g_signal_connect(rtpbin, "request-pt-map", G_CALLBACK(&RtpProtection::requestPtMap), this);
+        if (settings.nack)
+            g_signal_connect(rtpbin, "request-aux-receiver", G_CALLBACK(&RtpProtection::requestAuxReceiver), this);
+        if (settings.fec_percentage > 0)
+            g_signal_connect(rtpbin, "request-fec-decoder", G_CALLBACK(&RtpProtection::requestFecDecoder), this);
+        LOG_INFO("RtpProtection receiver nack " + std::to_string(settings.nack) + ", fec " + std::to_string(settings.fec_percentage > 0));
+        return true;
+    }
+
+    // Sender: asks the encoder for a keyframe, e.g. for a receiver that just joined.
+    // Receiver: asks the sender for one (PLI). Both are limited by keyframe_interval_ms.
+    bool requestKeyframe() {
+        GstPad* pad = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!keyframe_pad)
+                return false;
+            // On the sender the probe applies the limit to every request alike
+            if (!sender && !admitKeyframe())
+                return false;
+            pad = GST_PAD(gst_object_ref(keyframe_pad));
+        }
+        bool sent = gst_pad_send_event(pad, gst_video_event_new_upstream_force_key_unit(GST_CLOCK_TIME_NONE, TRUE, 0));
+        gst_object_unref(pad);
+        return sent;
+    }
+
+    // Drops the references to the pipeline, its elements go with it
+    void detach() {
+        std::lock_guard<std::mutex> lock(mutex);
+        GstElement** elements[] = {&rtpbin, &rtx, &fec};
+        for (GstElement** element : elements) {
+            if (*element) {
+                gst_object_unref(*element);
+                *element = nullptr;
+            }
+        }
+        if (keyframe_pad) {
+            gst_object_unref(keyframe_pad);
+            keyframe_pad = nullptr;
+        }
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats _stats = stats;
+        guint value = 0;
+        if (rtx) {
+            g_object_get(rtx, "num-rtx-requests", &value, nullptr);
+            _stats.rtx_requests = value;
+            g_object_get(rtx, sender ? "num-rtx-packets" : "num-rtx-assoc-packets", &value, nullptr);
+            _stats.rtx_packets = value;
+        }
+        if (fec && sender) {
+            g_object_get(fec, "protected", &value, nullptr);
+            _stats.fec_protected = value;
+        } else if (fec) {
+            g_object_get(fec, "recovered", &value, nullptr);
+            _stats.fec_recovered = value;
+        }
+        return _stats;
+    }
+
+    void logStats(const std::string& _name) {
+        Stats _stats = getStats();
+        LOG_INFO("RtpProtection " + _name + " rtx requests " + std::to_string(_stats.rtx_requests) + ", rtx packets " +
+                 std::to_string(_stats.rtx_packets) + ", fec protected " + std::to_string(_stats.fec_protected) +
+                 ", fec recovered " + std::to_string(_stats.fec_recovered) + ", lost " + std::to_string(_stats.lost) +
+                 ", keyframe requests " + std::to_string(_stats.keyframe_requests) + " (throttled " +
+                 std::to_string(_stats.keyframes_throttled) + ")");
+    }
+
+private:
+    Settings settings;
+    Stats stats;
+    GstElement* rtpbin = nullptr;
+    GstElement* rtx = nullptr;     // rtprtxsend or rtprtxreceive
+    GstElement* fec = nullptr;     // rtpulpfecenc or rtpulpfecdec
+    GstPad* keyframe_pad = nullptr;  // encoder src (sender) or jitterbuffer src (receiver)
+    bool sender = true;
+    std::chrono::steady_clock::time_point last_keyframe;
+    std::mutex mutex;
+
+    // Called with the mutex held
+    bool admitKeyframe() {
+        auto now = std::chrono::steady_clock::now();
+        if (last_keyframe != std::chrono::steady_clock::time_point() &&
+            now - last_keyframe < std::chrono::milliseconds(settings.keyframe_interval_ms)) {
+            stats.keyframes_throttled++;
+            return false;
+        }
+        last_keyframe = now;
+        stats.keyframe_requests++;
+        return true;
+    }
+
+    // Media payload type -> retransmission payload type, the same map on both ends
+    GstStructure* rtxMap() {
+        GstStructure* map = gst_structure_new_empty("application/x-rtp-pt-map");
+        gst_structure_set(map, std::to_string(settings.payload).c_str(), G_TYPE_UINT, static_cast<guint>(settings.rtx_payload), nullptr);
+        return map;
+    }
+
+    // rtpbin links aux elements through ghost pads named after the session
+    static GstElement* wrapAux(GstElement* _element, guint _session) {
+        GstElement* bin = gst_bin_new(nullptr);
+        gst_bin_add(GST_BIN(bin), _element);
+        const char* names[] = {"src", "sink"};
+        for (const char* name : names) {
+            GstPad* pad = gst_element_get_static_pad(_element, name);
+            std::string ghost = std::string(name) + "_" + std::to_string(_session);
+            gst_element_add_pad(bin, gst_ghost_pad_new(ghost.c_str(), pad));
+            gst_object_unref(pad);
+        }
+        return bin;
+    }
+
+    void keepElement(GstElement*& _slot, GstElement* _element) {
+        if (_slot)
+            gst_object_unref(_slot);
+        _slot = GST_ELEMENT(gst_object_ref(_element));
+    }
+
+    static GstElement* requestAuxSender(GstElement*, guint _session, gpointer _data) {
+        RtpProtection* self = static_cast<RtpProtection*>(_data);
+        GstElement* element = gst_element_factory_make("rtprtxsend", nullptr);
+        if (!element) {
+            LOG_WARN("RtpProtection rtprtxsend not available, no retransmissions");
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(self->mutex);
+        GstStructure* map = self->rtxMap();
+        g_object_set(element, "payload-type-map", map, "max-size-time", static_cast<guint>(self->settings.rtx_time_ms), nullptr);
+        gst_structure_free(map);
+        self->keepElement(self->rtx, element);
+        return wrapAux(element, _session);
+    }
+
+    static GstElement* requestAuxReceiver(GstElement*, guint _session, gpointer _data) {
+        RtpProtection* self = static_cast<RtpProtection*>(_data);
+        GstElement* element = gst_element_factory_make("rtprtxreceive", nullptr);
+        if (!element) {
+            LOG_WARN("RtpProtection rtprtxreceive not available, no retransmissions");
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(self->mutex);
+        GstStructure* map = self->rtxMap();
+        g_object_set(element, "payload-type-map", map, nullptr);
+        gst_structure_free(map);
+        self->keepElement(self->rtx, element);
+        return wrapAux(element, _session);
+    }
+
+    static GstElement* requestFecEncoder(GstElement*, guint, gpointer _data) {
+        RtpProtection* self = static_cast<RtpProtection*>(_data);
+        GstElement* element = gst_element_factory_make("rtpulpfecenc", nullptr);
+        if (!element) {
+            LOG_WARN("RtpProtection rtpulpfecenc not available, no FEC");
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(self->mutex);
+        g_object_set(element, "pt", static_cast<guint>(self->settings.fec_payload), "percentage",
+                     static_cast<guint>(self->settings.fec_percentage), "multipacket", TRUE, nullptr);
+        self->keepElement(self->fec, element);
+        return element;
+    }
+
+    // The decoder rebuilds packets from the session's packet storage, which has to cover the jitterbuffer latency
+    static GstElement* requestFecDecoder(GstElement* _rtpbin, guint _session, gpointer _data) {
+        RtpProtection* self = static_cast<RtpProtection*>(_data);
+        GstElement* element = gst_element_factory_make("rtpulpfecdec", nullptr);
+        if (!element) {
+            LOG_WARN("RtpProtection rtpulpfecdec not available, no FEC");
+            return nullptr;
+        }
+        GObject* storage = nullptr;
+        g_signal_emit_by_name(_rtpbin, "get-internal-storage", _session, &storage);
+        guint latency_ms = 200;
+        g_object_get(_rtpbin, "latency", &latency_ms, nullptr);
+        if (storage) {
+            g_object_set(storage, "size-time", static_cast<guint64>(latency_ms + 50) * GST_MSECOND, nullptr);
+            g_object_set(element, "storage", storage, nullptr);
+            g_object_unref(storage);
+        }
+        std::lock_guard<std::mutex> lock(self->mutex);
+        g_object_set(element, "pt", static_cast<guint>(self->settings.fec_payload), nullptr);
+        self->keepElement(self->fec, element);
+        // Losses FEC could not repair leave the decoder as events
+        GstPad* src = gst_element_get_static_pad(element, "src");
+        if (src) {
+            gst_pad_add_probe(src, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, &RtpProtection::lostProbe, self, nullptr);
+            gst_object_unref(src);
+        }
+        return element;
+    }
+
+    static void newJitterbuffer(GstElement*, GstElement* _jitterbuffer, guint, guint, gpointer _data) {
+        RtpProtection* self = static_cast<RtpProtection*>(_data);
+        GstPad* src = gst_element_get_static_pad(_jitterbuffer, "src");
+        if (!src)
+            return;
+        std::lock_guard<std::mutex> lock(self->mutex);
+        if (self->settings.fec_percentage == 0)
+            gst_pad_add_probe(src, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, &RtpProtection::lostProbe, self, nullptr);
+        // Upstream keyframe requests leave the jitterbuffer towards the session, which sends the PLI
+        if (self->keyframe_pad)
+            gst_object_unref(self->keyframe_pad);
+        self->keyframe_pad = src;
+    }
+
+    // Caps of the FEC and retransmission payloads, which the media caps of the udpsrc do not cover
+    static GstCaps* requestPtMap(GstElement*, guint, guint _pt, gpointer _data) {
+        RtpProtection* self = static_cast<RtpProtection*>(_data);
+        std::lock_guard<std::mutex> lock(self->mutex);
+        const char* encoding = nullptr;
+        if (static_cast<int>(_pt) == self->settings.fec_payload)
+            encoding = "ULPFEC";
+        else if (static_cast<int>(_pt) == self->settings.rtx_payload)
+            encoding = "RTX";
+        if (!encoding)
+            return nullptr;
+        return gst_caps_new_simple("application/x-rtp", "media", G_TYPE_STRING, "video", "clock-rate", G_TYPE_INT,
+                                   self->settings.clock_rate, "encoding-name", G_TYPE_STRING, encoding, "payload", G_TYPE_INT,
+                                   static_cast<gint>(_pt), nullptr);
+    }
+
+    static GstPadProbeReturn lostProbe(GstPad*, GstPadProbeInfo* _info, gpointer _data) {
+        RtpProtection* self = static_cast<RtpProtection*>(_data);
+        GstEvent* event = GST_PAD_PROBE_INFO_EVENT(_info);
+        if (GST_EVENT_TYPE(event) != GST_EVENT_CUSTOM_DOWNSTREAM || !gst_event_has_name(event, "GstRTPPacketLost"))
+            return GST_PAD_PROBE_OK;
+        {
+            std::lock_guard<std::mutex> lock(self->mutex);
+            self->stats.lost++;
+        }
+        self->requestKeyframe();
+        return GST_PAD_PROBE_OK;
+    }
+
+    // Every keyframe request on its way to the encoder, from the receiver's PLI/FIR or from requestKeyframe()
+    static GstPadProbeReturn keyframeProbe(GstPad*, GstPadProbeInfo* _info, gpointer _data) {
+        RtpProtection* self = static_cast<RtpProtection*>(_data);
+        GstEvent* event = GST_PAD_PROBE_INFO_EVENT(_info);
+        if (!gst_video_event_is_force_key_unit(event))
+            return GST_PAD_PROBE_OK;
+        std::lock_guard<std::mutex> lock(self->mutex);
+        return self->admitKeyframe() ? GST_PAD_PROBE_OK : GST_PAD_PROBE_DROP;
+    }
+};
+#endif // RTPPROTECTION_H
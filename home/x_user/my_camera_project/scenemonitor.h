@@ -0,0 +1,190 @@
+#ifndef SCENEMONITOR_H
+#define SCENEMONITOR_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include "Logger.h"
+#include "imagekernels.h"
+
+// Static-scene detector for the outgoing stream. Every captured frame is reduced
+// to a small luma thumbnail and compared with the previous one in 8x8 blocks.
+// When neither the whole thumbnail nor any block has changed for hold_ms, the
+// scene is static: the stream is thinned to static_fps and its bitrate lowered.
+// The first frame with a change ends the static period at once.
+class SceneMonitor {
+public:
+    struct Settings {
+        bool enabled = true;
+        double threshold = 3.0;            // mean absolute luma difference per pixel over the thumbnail
+        double block_threshold = 12.0;     // the same over any 8x8 block, catches small moving objects
+        int hold_ms = 2000;                // calm time before the scene counts as static
+        int static_fps = 5;                // stream rate while static
+        int static_bitrate_percent = 30;   // stream bitrate while static, in percent of the normal one
+    };
+
+    struct Stats {
+        uint64_t analyzed = 0;
+        uint64_t static_periods = 0;
+        uint64_t frames_held = 0;          // stream frames not encoded because the scene was static
+        double static_ms = 0;              // total time in finished static periods
+        double bytes_saved = 0;            // encoded bytes below the normal bitrate during static periods
+        double encoder_ms_saved = 0;       // held frames times the mean encode time
+        double mean_analyze_us = 0;
+        double last_change = 0;            // mean difference of the last analyzed frame
+        bool is_static = false;
+    };
+
+    static constexpr int thumb_width = 80;
+    static constexpr int thumb_height = 64;
+
+    SceneMonitor() {
+        LOG_INFO("SceneMonitor Constructor");
+    }
+
+    void configure(const Settings& _settings) {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings = _settings;
+        settings.static_fps = std::max(1, settings.static_fps);
+        settings.static_bitrate_percent = std::clamp(settings.static_bitrate_percent, 1, 100);
+    }
+
+    Settings getSettings() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return settings;
+    }
+
+    bool isEnabled() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return settings.enabled;
+    }
+
+    // Starts over with no reference frame and moving state, e.g. when a stream starts
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        previous.clear();
+        is_static = false;
+        calm_since = -1;
+        static_since = -1;
+        last_admitted = -1;
+        stats = Stats();
+    }
+
+    // _thumb is a thumb_width x thumb_height luma plane; _timestamp_ms its capture time (-1 = now).
+    // Returns true when the static state changed with this frame.
+    bool update(const uint8_t* _thumb, int _stride, double _timestamp_ms) {
+        auto start = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        double t = _timestamp_ms >= 0 ? _timestamp_ms : nowMs();
+        current.resize(static_cast<size_t>(thumb_width) * thumb_height);
+        for (int y = 0; y < thumb_height; ++y)
+            std::copy(_thumb + static_cast<size_t>(y) * _stride, _thumb + static_cast<size_t>(y) * _stride + thumb_width,
+                      current.begin() + static_cast<size_t>(y) * thumb_width);
+        bool moving = true;
+        if (previous.size() == current.size()) {
+            // Block sums over 8 rows of 8-pixel groups
+            blocks.fill(0);
+            uint32_t row[thumb_width / 8];
+            uint64_t total = 0;
+            for (int y = 0; y < thumb_height; ++y) {
+                size_t offset = static_cast<size_t>(y) * thumb_width;
+                ImageKernels::sad8(previous.data() + offset, current.data() + offset, row, thumb_width);
+                for (int b = 0; b < thumb_width / 8; ++b) {
+                    blocks[(y / 8) * (thumb_width / 8) + b] += row[b];
+                    total += row[b];
+                }
+            }
+            uint32_t max_block = *std::max_element(blocks.begin(), blocks.end());
+            stats.last_change = static_cast<double>(total) / current.size();
+            moving = stats.last_change > settings.threshold || max_block / 64.0 > settings.block_threshold;
+        }
+        previous.swap(current);
+        stats.analyzed++;
+        bool changed = false;
+        if (moving) {
+            calm_since = -1;
+            if (is_static) {
+                is_static = false;
+                changed = true;
+                if (static_since >= 0)
+                    stats.static_ms += std::max(0.0, t - static_since);
+            }
+        } else {
+            if (calm_since < 0)
+                calm_since = t;
+            if (settings.enabled && !is_static && t - calm_since >= settings.hold_ms) {
+                is_static = true;
+                changed = true;
+                static_since = t;
+                last_admitted = -1;
+                stats.static_periods++;
+            }
+        }
+        stats.is_static = is_static;
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        stats.mean_analyze_us += (us - stats.mean_analyze_us) / stats.analyzed;
+        return changed;
+    }
+
+    bool isStatic() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return is_static;
+    }
+
+    // Stream admission: while static one frame per 1/static_fps passes, the others are held
+    bool admit(double _timestamp_ms) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!is_static)
+            return true;
+        double t = _timestamp_ms >= 0 ? _timestamp_ms : nowMs();
+        if (last_admitted >= 0 && t - last_admitted < 1000.0 / settings.static_fps) {
+            stats.frames_held++;
+            return false;
+        }
+        last_admitted = t;
+        return true;
+    }
+
+    // Savings of a finished static period, measured by the stream owner
+    void addSavings(double _bytes, double _encoder_ms) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.bytes_saved += std::max(0.0, _bytes);
+        stats.encoder_ms_saved += std::max(0.0, _encoder_ms);
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    void logStats(const std::string& _name) {
+        Stats _stats = getStats();
+        LOG_INFO("SceneMonitor " + _name + " analyzed " + std::to_string(_stats.analyzed) + " (" + std::to_string(_stats.mean_analyze_us) +
+                 " us), static periods " + std::to_string(_stats.static_periods) + ", static " + std::to_string(_stats.static_ms / 1000.0) +
+                 " s, frames held " + std::to_string(_stats.frames_held) + ", saved " + std::to_string(_stats.bytes_saved / 1024.0) +
+                 " KB and " + std::to_string(_stats.encoder_ms_saved) + " ms of encoding");
+    }
+
+private:
+    Settings settings;
+    // Thumbnails of the previous and the current frame, swapped after each comparison
+    std::vector<uint8_t> previous;
+    std::vector<uint8_t> current;
+    std::array<uint32_t, (thumb_width / 8) * (thumb_height / 8)> blocks;
+    bool is_static = false;
+    double calm_since = -1;
+    double static_since = -1;
+    double last_admitted = -1;
+    Stats stats;
+    std::mutex mutex;
+
+    static double nowMs() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+#endif // SCENEMONITOR_H
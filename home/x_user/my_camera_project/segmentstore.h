@@ -0,0 +1,134 @@
+#ifndef SEGMENTSTORE_H
+#define SEGMENTSTORE_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <ctime>
+#include <filesystem>
+#include <algorithm>
+#include "Logger.h"
+
+namespace fs = std::filesystem;
+
+// Rolling store for the recorded call segments. Each recording session names its
+// files <prefix><start time>_<fragment>.mp4, so names sort chronologically, and
+// before a new segment is opened the oldest segments are deleted until the
+// directory fits its byte budget with room for the new one.
+class SegmentStore {
+public:
+    struct Stats {
+        uint64_t segments = 0;       // segments opened
+        uint64_t evicted = 0;        // old segments deleted for the budget
+        uint64_t evicted_bytes = 0;
+        uint64_t disk_bytes = 0;     // recorded bytes on disk after the last prune
+    };
+
+    explicit SegmentStore(const std::string& _dir = "", uint64_t _max_bytes = 0, const std::string& _prefix = "call_")
+        : dir(_dir), prefix(_prefix), max_bytes(_max_bytes) {
+    }
+
+    void configure(const std::string& _dir, uint64_t _max_bytes, const std::string& _prefix = "call_") {
+        std::lock_guard<std::mutex> lock(mutex);
+        dir = _dir;
+        max_bytes = _max_bytes;
+        prefix = _prefix;
+    }
+
+    bool isEnabled() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return !dir.empty() && max_bytes > 0;
+    }
+
+    // Starts a new session name, called once per recording pipeline
+    bool startSession() {
+        std::lock_guard<std::mutex> lock(mutex);
+        try {
+            fs::create_directories(dir);
+            std::time_t now = std::time(nullptr);
+            char stamp[32];
+            std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+            session = stamp;
+            return true;
+        } catch (const std::exception& e) {
+            LOG_ERROR("An error occurred in SegmentStore startSession: " + std::string(e.what()));
+            return false;
+        }
+    }
+
+    // Path of the next segment. _reserve_bytes is the expected size of that segment,
+    // older segments are evicted first so it fits the budget.
+    std::string nextLocation(unsigned _fragment, uint64_t _reserve_bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pruneLocked(_reserve_bytes);
+        stats.segments++;
+        char name[64];
+        std::snprintf(name, sizeof(name), "_%05u.mp4", _fragment);
+        return (fs::path(dir) / (prefix + session + name)).string();
+    }
+
+    // Deletes the oldest segments until the recorded bytes plus _reserve_bytes fit the budget
+    uint64_t prune(uint64_t _reserve_bytes = 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pruneLocked(_reserve_bytes);
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    void logStats() {
+        Stats _stats = getStats();
+        LOG_INFO("SegmentStore " + dir + " segments " + std::to_string(_stats.segments) + ", evicted " + std::to_string(_stats.evicted) +
+                 " (" + std::to_string(_stats.evicted_bytes / (1024 * 1024)) + " MB), on disk " +
+                 std::to_string(_stats.disk_bytes / (1024 * 1024)) + " MB of " + std::to_string(max_bytes / (1024 * 1024)) + " MB");
+    }
+
+private:
+    std::string dir;
+    std::string prefix;
+    uint64_t max_bytes;
+    std::string session;
+    Stats stats;
+    std::mutex mutex;
+
+    uint64_t pruneLocked(uint64_t _reserve_bytes) {
+        std::vector<std::pair<std::string, uint64_t>> segments;
+        uint64_t total = 0;
+        try {
+            if (dir.empty() || !fs::is_directory(dir))
+                return 0;
+            for (const auto& entry : fs::directory_iterator(dir)) {
+                std::string name = entry.path().filename().string();
+                if (!entry.is_regular_file() || name.rfind(prefix, 0) != 0 || entry.path().extension() != ".mp4")
+                    continue;
+                uint64_t size = entry.file_size();
+                segments.emplace_back(entry.path().string(), size);
+                total += size;
+            }
+            std::sort(segments.begin(), segments.end());
+            // The newest segment may still be finalizing, it is never evicted
+            size_t evictable = segments.empty() ? 0 : segments.size() - 1;
+            uint64_t freed = 0;
+            for (size_t i = 0; i < evictable && total + _reserve_bytes > max_bytes; ++i) {
+                std::error_code error;
+                if (fs::remove(segments[i].first, error)) {
+                    total -= segments[i].second;
+                    freed += segments[i].second;
+                    stats.evicted++;
+                    stats.evicted_bytes += segments[i].second;
+                    LOG_INFO("SegmentStore evicted " + segments[i].first);
+                }
+            }
+            stats.disk_bytes = total;
+            return freed;
+        } catch (const std::exception& e) {
+            LOG_ERROR("An error occurred in SegmentStore prune: " + std::string(e.what()));
+            return 0;
+        }
+    }
+};
+#endif // SEGMENTSTORE_H
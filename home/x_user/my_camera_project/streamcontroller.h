@@ -0,0 +1,213 @@
+#ifndef STREAMCONTROLLER_H
+#define STREAMCONTROLLER_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cmath>
+#include <algorithm>
+#include "Logger.h"
+
+// Congestion-aware bitrate and resolution controller for the outgoing stream.
+// update() is called about once per second with the latest loss/RTT from the
+// receiver's RTCP reports (or, without reports, the encoder queue drops as a
+// local probe). Bitrate follows an AIMD rule: multiplicative decrease on loss
+// or rising RTT, slow multiplicative increase while the path is clean. When the
+// bitrate falls below what the current rung of the resolution/fps ladder needs,
+// the controller steps down a rung, and steps back up after a clean streak.
+class StreamController {
+public:
+    struct Rung {
+        int width = 0;
+        int height = 0;
+        int fps = 0;
+        int min_kbps = 0;  // below this bitrate the next lower rung looks better
+    };
+
+    struct Feedback {
+        bool report = false;    // a new RTCP receiver report arrived since the last update
+        double loss = 0;        // fraction lost from that report, 0..1
+        double rtt_ms = -1;     // round trip from that report, -1 = unknown
+        double queue_drop = 0;  // fraction of frames dropped at the encoder queue since the last update
+    };
+
+    struct Decision {
+        int kbps = 0;
+        int rung = 0;
+        bool bitrate_changed = false;
+        bool rung_changed = false;
+    };
+
+    struct Stats {
+        uint64_t updates = 0;
+        uint64_t reports = 0;     // updates that carried a fresh receiver report
+        uint64_t decreases = 0;
+        uint64_t increases = 0;
+        uint64_t steps_down = 0;
+        uint64_t steps_up = 0;
+        int kbps = 0;
+        int rung = 0;
+        double loss = 0;          // last reported loss
+        double rtt_ms = -1;       // last reported round trip
+        double base_rtt_ms = -1;  // uncongested round trip estimate
+    };
+
+    StreamController() {
+        LOG_INFO("StreamController Constructor");
+    }
+
+    // _ladder is ordered from the best rung (index 0) down; _start_kbps is clamped to [_min_kbps, _max_kbps]
+    void configure(const std::vector<Rung>& _ladder, int _start_kbps, int _min_kbps, int _max_kbps) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ladder = _ladder.empty() ? std::vector<Rung>{Rung()} : _ladder;
+        max_kbps = std::max(1, _max_kbps);
+        min_kbps = std::max(1, std::min(_min_kbps, max_kbps));
+        kbps = std::clamp(static_cast<double>(_start_kbps), static_cast<double>(min_kbps), static_cast<double>(max_kbps));
+        applied_kbps = static_cast<int>(kbps);
+        rung = 0;
+        good_streak = 0;
+        hold = 0;
+        updates_since_report = report_timeout;
+        base_rtt = -1;
+        stats = Stats();
+        stats.kbps = applied_kbps;
+    }
+
+    // Top rung is the negotiated stream itself; the configured rungs strictly smaller than it follow
+    static std::vector<Rung> buildLadder(int _width, int _height, int _fps, const std::vector<Rung>& _lower) {
+        std::vector<Rung> result;
+        Rung top{_width, _height, _fps, 0};
+        std::vector<Rung> lower;
+        for (const Rung& rung : _lower) {
+            if (rung.width * rung.height < _width * _height || (rung.width * rung.height == _width * _height && rung.fps < _fps))
+                lower.push_back(Rung{rung.width, rung.height, std::min(rung.fps, _fps), rung.min_kbps});
+            else
+                top.min_kbps = std::max(top.min_kbps, rung.min_kbps);
+        }
+        std::sort(lower.begin(), lower.end(), [](const Rung& a, const Rung& b) {
+            return a.width * a.height * a.fps > b.width * b.height * b.fps;
+        });
+        // Without a configured rung of its own, the top rung needs the next one's bitrate scaled by the pixel rate
+        if (top.min_kbps == 0 && !lower.empty() && lower[0].width * lower[0].height * lower[0].fps > 0)
+            top.min_kbps = static_cast<int>(static_cast<double>(lower[0].min_kbps) * _width * _height * _fps /
+                                            (static_cast<double>(lower[0].width) * lower[0].height * lower[0].fps));
+        result.push_back(top);
+        result.insert(result.end(), lower.begin(), lower.end());
+        return result;
+    }
+
+    Decision update(const Feedback& _feedback) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.updates++;
+        int old_rung = rung;
+        if (_feedback.report) {
+            stats.reports++;
+            updates_since_report = 0;
+            stats.loss = _feedback.loss;
+            stats.rtt_ms = _feedback.rtt_ms;
+            if (_feedback.rtt_ms > 0) {
+                // Minimum RTT, drifting up slowly so a route change does not pin it forever
+                base_rtt = base_rtt < 0 ? _feedback.rtt_ms : std::min(_feedback.rtt_ms, base_rtt + 0.02 * (_feedback.rtt_ms - base_rtt));
+                stats.base_rtt_ms = base_rtt;
+            }
+        } else if (updates_since_report < report_timeout) {
+            updates_since_report++;
+        }
+        // With reports coming in, updates between two reports carry no news about the path
+        bool reports_live = updates_since_report < report_timeout;
+        bool evidence = _feedback.report || !reports_live;
+
+        bool lossy = _feedback.report && _feedback.loss > loss_high;
+        bool delayed = _feedback.report && _feedback.rtt_ms > 0 && base_rtt > 0 && _feedback.rtt_ms - base_rtt > rtt_rise_ms;
+        bool backlog = _feedback.queue_drop > queue_drop_high;
+        bool clean = (!_feedback.report || _feedback.loss < loss_low) && _feedback.queue_drop == 0;
+
+        if (lossy || delayed || backlog) {
+            double factor = lossy ? std::max(0.5, 1.0 - 0.5 * _feedback.loss) : 0.85;
+            kbps = std::max(static_cast<double>(min_kbps), kbps * factor);
+            stats.decreases++;
+            good_streak = 0;
+            hold = hold_updates;
+        } else if (hold > 0) {
+            hold--;
+        } else if (clean && evidence) {
+            good_streak++;
+            if (kbps < max_kbps) {
+                kbps = std::min(static_cast<double>(max_kbps), kbps * increase_factor);
+                stats.increases++;
+            }
+        }
+
+        if (rung + 1 < static_cast<int>(ladder.size()) && kbps < ladder[rung].min_kbps) {
+            rung++;
+            stats.steps_down++;
+            good_streak = 0;
+        } else if (rung > 0 && good_streak >= up_streak && kbps >= ladder[rung - 1].min_kbps * up_margin) {
+            rung--;
+            stats.steps_up++;
+            good_streak = 0;
+        }
+
+        Decision decision;
+        decision.rung = rung;
+        decision.rung_changed = rung != old_rung;
+        // Small changes are not worth an encoder reconfiguration
+        bool at_bound = (kbps >= max_kbps || kbps <= min_kbps) && static_cast<int>(std::lround(kbps)) != applied_kbps;
+        if (at_bound || std::abs(kbps - applied_kbps) >= 0.05 * applied_kbps) {
+            applied_kbps = static_cast<int>(std::lround(kbps));
+            decision.bitrate_changed = true;
+        }
+        decision.kbps = applied_kbps;
+        stats.kbps = applied_kbps;
+        stats.rung = rung;
+        return decision;
+    }
+
+    Rung getRung(int _index) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (_index < 0 || _index >= static_cast<int>(ladder.size()))
+            return Rung();
+        return ladder[_index];
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    void logStats(const std::string& _name) {
+        Stats _stats = getStats();
+        LOG_INFO("StreamController " + _name + " " + std::to_string(_stats.kbps) + " kbps, rung " + std::to_string(_stats.rung) +
+                 ", updates " + std::to_string(_stats.updates) + " (reports " + std::to_string(_stats.reports) +
+                 "), decreases " + std::to_string(_stats.decreases) + ", increases " + std::to_string(_stats.increases) +
+                 ", steps down " + std::to_string(_stats.steps_down) + ", steps up " + std::to_string(_stats.steps_up) +
+                 ", loss " + std::to_string(_stats.loss) + ", rtt " + std::to_string(_stats.rtt_ms) + " ms");
+    }
+
+private:
+    std::vector<Rung> ladder{Rung()};
+    int min_kbps = 200;
+    int max_kbps = 5000;
+    double kbps = 5000;
+    int applied_kbps = 5000;
+    int rung = 0;
+    int good_streak = 0;
+    int hold = 0;
+    int updates_since_report = 0;
+    double base_rtt = -1;
+    Stats stats;
+    std::mutex mutex;
+
+    static constexpr double loss_high = 0.10;       // above: decrease
+    static constexpr double loss_low = 0.02;        // below: increase
+    static constexpr double rtt_rise_ms = 150;      // queueing delay over the base RTT treated as congestion
+    static constexpr double queue_drop_high = 0.2;  // encoder backlog treated as congestion
+    static constexpr double increase_factor = 1.05;
+    static constexpr int hold_updates = 3;          // no increase right after a decrease
+    static constexpr int up_streak = 5;             // clean updates before stepping a rung up
+    static constexpr double up_margin = 1.25;       // headroom over the upper rung's minimum before stepping up
+    static constexpr int report_timeout = 10;       // updates without reports before falling back to the local probe
+};
+#endif // STREAMCONTROLLER_H
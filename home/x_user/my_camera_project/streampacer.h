@@ -0,0 +1,162 @@
+#ifndef STREAMPACER_H
+#define STREAMPACER_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "Logger.h"
+
+// Paces captured frames onto the stream's output grid using capture timestamps.
+// The grid advances by 1/fps of capture time, so a 30 fps camera feeding a
+// 25 fps stream skips exactly the frames that land in an already filled slot,
+// and a 15 fps camera feeding a 30 fps stream either passes its frames through
+// or, with DuplicatePolicy::Repeat, fills the empty slots with the previous
+// frame. Arrival jitter on the capture thread does not affect the decision.
+class StreamPacer {
+public:
+    enum class DropPolicy {
+        None,    // every frame is sent, the stream rate follows the camera
+        Cadence  // at most one frame per output slot
+    };
+
+    enum class DuplicatePolicy {
+        None,    // empty slots stay empty, frames keep their capture timestamps
+        Repeat   // empty slots before a frame are filled with the previous frame
+    };
+
+    struct Stats {
+        uint64_t offered = 0;     // frames presented to admit()
+        uint64_t skipped = 0;     // dropped by the cadence policy
+        uint64_t sent = 0;        // frames handed to the encoder
+        uint64_t duplicated = 0;  // repeated frames handed to the encoder
+        uint64_t resyncs = 0;     // grid restarted after a gap too long to fill
+        double fps = 0;
+    };
+
+    explicit StreamPacer(double _fps = 25, DropPolicy _drop = DropPolicy::Cadence,
+                         DuplicatePolicy _duplicate = DuplicatePolicy::None, int _max_repeat = 2)
+        : drop(_drop), duplicate(_duplicate), max_repeat(_max_repeat) {
+        reset(_fps);
+    }
+
+    // Starts a new grid at _fps, e.g. when a stream is (re)started
+    void reset(double _fps) {
+        std::lock_guard<std::mutex> lock(mutex);
+        fps = _fps > 0 ? _fps : 25;
+        interval_ms = 1000.0 / fps;
+        started = false;
+        stats = Stats();
+        stats.fps = fps;
+        repeats.fill(Repeat());
+    }
+
+    void setPolicies(DropPolicy _drop, DuplicatePolicy _duplicate, int _max_repeat = 2) {
+        std::lock_guard<std::mutex> lock(mutex);
+        drop = _drop;
+        duplicate = _duplicate;
+        max_repeat = std::max(0, _max_repeat);
+    }
+
+    // Decides whether the frame captured at _capture_ms (-1 = unknown, the arrival time is used) is sent
+    bool admit(double _capture_ms) {
+        std::lock_guard<std::mutex> lock(mutex);
+        double t = _capture_ms >= 0 ? _capture_ms : nowMs();
+        stats.offered++;
+        if (!started) {
+            started = true;
+            next_slot = t + interval_ms;
+            remember(_capture_ms, 0);
+            return true;
+        }
+        if (drop == DropPolicy::Cadence && t < next_slot - interval_ms / 2) {
+            stats.skipped++;
+            return false;
+        }
+        // Slots between the last sent frame and this one that received no frame
+        int missing = static_cast<int>(std::floor((t - next_slot + interval_ms / 2) / interval_ms));
+        missing = std::max(0, missing);
+        if (missing > max_repeat) {
+            // A stall (mode switch, camera hiccup): restart the grid instead of flooding the encoder
+            stats.resyncs++;
+            next_slot = t + interval_ms;
+            remember(_capture_ms, 0);
+            return true;
+        }
+        next_slot += (missing + 1) * interval_ms;
+        remember(_capture_ms, duplicate == DuplicatePolicy::Repeat ? missing : 0);
+        return true;
+    }
+
+    // Number of times the previous frame has to be repeated before the admitted frame captured at _capture_ms
+    int repeatsBefore(double _capture_ms) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& repeat : repeats) {
+            if (repeat.valid && repeat.capture_ms == _capture_ms) {
+                repeat.valid = false;
+                return repeat.count;
+            }
+        }
+        return 0;
+    }
+
+    double getInterval() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return interval_ms;
+    }
+
+    // Counts what the consumer actually handed to the encoder
+    void recordSent(int _duplicates) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.sent++;
+        stats.duplicated += _duplicates;
+    }
+
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    void logStats(const std::string& _name) {
+        Stats _stats = getStats();
+        LOG_INFO("StreamPacer " + _name + " @ " + std::to_string(_stats.fps) + " fps offered " + std::to_string(_stats.offered) +
+                 ", sent " + std::to_string(_stats.sent) + ", duplicated " + std::to_string(_stats.duplicated) +
+                 ", skipped " + std::to_string(_stats.skipped) + ", resyncs " + std::to_string(_stats.resyncs));
+    }
+
+private:
+    struct Repeat {
+        double capture_ms = -1;
+        int count = 0;
+        bool valid = false;
+    };
+
+    DropPolicy drop;
+    DuplicatePolicy duplicate;
+    int max_repeat;
+    double fps = 25;
+    double interval_ms = 40;
+    bool started = false;
+    double next_slot = 0;
+    // Repeat counts of the frames admitted but not delivered yet, looked up by capture timestamp
+    std::array<Repeat, 4> repeats;
+    size_t next_repeat = 0;
+    Stats stats;
+    std::mutex mutex;
+
+    void remember(double _capture_ms, int _count) {
+        if (_count == 0 || _capture_ms < 0)
+            return;
+        repeats[next_repeat] = Repeat{_capture_ms, _count, true};
+        next_repeat = (next_repeat + 1) % repeats.size();
+    }
+
+    static double nowMs() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+#endif // STREAMPACER_H
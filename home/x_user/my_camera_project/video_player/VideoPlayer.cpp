@@ -3,7 +3,7 @@
 #include <QPixmap>
 
 VideoPlayer::VideoPlayer(const QString &videoPath, QWidget *parent)
-    : QWidget(parent), isPlaying(false), pipeline(nullptr), volumeElement(nullptr)
+    : QWidget(parent), videoMailbox("video_player")
 {
     videoLabel = new QLabel(this);
     videoLabel->setFixedSize(640, 360);
@@ -28,106 +28,67 @@ VideoPlayer::VideoPlayer(const QString &videoPath, QWidget *parent)
     setLayout(mainLayout);
 
     connect(playPauseButton, &QPushButton::clicked, this, &VideoPlayer::playPause);
-    connect(&frameTimer, &QTimer::timeout, this, &VideoPlayer::updateFrame);
     connect(forwardButton, &QPushButton::clicked, this, &VideoPlayer::seekForward);
     connect(backwardButton, &QPushButton::clicked, this, &VideoPlayer::seekBackward);
     connect(volumeSlider, &QSlider::valueChanged, this, &VideoPlayer::volumeChanged);
 
-    cap.open(videoPath.toStdString());
-    if (!cap.isOpened()) {
+    engine.setAudioSink("audioconvert ! audioresample ! autoaudiosink");
+    engine.setVolume(volumeSlider->value());
+    engine.setFrameCallback([this](const cv::Mat &frame) {
+        if (videoMailbox.post(frame)) {
+            QMetaObject::invokeMethod(this, [this]() {
+                cv::Mat next;
+                if (videoMailbox.take(next))
+                    showFrame(next);
+            }, Qt::QueuedConnection);
+        }
+    });
+    engine.setEndCallback([this]() {
+        QMetaObject::invokeMethod(this, [this]() { playbackEnded(); }, Qt::QueuedConnection);
+    });
+
+    if (engine.open(videoPath.toStdString()) != 0) {
         videoLabel->setText("Failed to open video.");
         return;
     }
-
-    frameTimer.setInterval(1000 / cap.get(cv::CAP_PROP_FPS));
-
-    gst_init(nullptr, nullptr);
-    initGStreamerPipeline(videoPath);
 }
 
 VideoPlayer::~VideoPlayer()
 {
-    if (pipeline) {
-        gst_element_set_state(pipeline, GST_STATE_NULL);
-        gst_object_unref(pipeline);
-    }
-}
-
-void VideoPlayer::initGStreamerPipeline(const QString &path)
-{
-    QString pipelineDesc = QString("filesrc location=\"%1\" ! decodebin name=d "
-                                   "d. ! audioconvert ! volume name=vol volume=0.5 ! autoaudiosink")
-                               .arg(path);
-
-    GError *error = nullptr;
-    pipeline = gst_parse_launch(pipelineDesc.toUtf8(), &error);
-    if (error) {
-        std::cout << "GStreamer pipeline error:" << error->message<< std::endl; 
-        g_error_free(error);
-        return;
-    }
-
-    volumeElement = gst_bin_get_by_name(GST_BIN(pipeline), "vol");
+    // The presenter thread calls back into this widget, stop it first
+    engine.close();
 }
 
 void VideoPlayer::playPause()
 {
-    if (!pipeline)
-        return;
-
-    if (isPlaying) {
-        gst_element_set_state(pipeline, GST_STATE_PAUSED);
-        frameTimer.stop();
-        playPauseButton->setText("Play");
-    } else {
-        gst_element_set_state(pipeline, GST_STATE_PLAYING);
-        frameTimer.start();
-        playPauseButton->setText("Pause");
-    }
-
-    isPlaying = !isPlaying;
+    engine.togglePause();
+    playPauseButton->setText(engine.isPaused() ? "Play" : "Pause");
 }
 
-void VideoPlayer::updateFrame()
+void VideoPlayer::showFrame(const cv::Mat &frame)
 {
-    cv::Mat frame;
-    if (!cap.read(frame)) {
-        frameTimer.stop();
-        return;
-    }
-
-    cv::cvtColor(frame, frame, cv::COLOR_BGR2RGB);
-    QImage img((uchar*)frame.data, frame.cols, frame.rows, frame.step, QImage::Format_RGB888);
+    cv::Mat rgb;
+    cv::cvtColor(frame, rgb, cv::COLOR_BGR2RGB);
+    QImage img((uchar*)rgb.data, rgb.cols, rgb.rows, rgb.step, QImage::Format_RGB888);
     videoLabel->setPixmap(QPixmap::fromImage(img).scaled(videoLabel->size(), Qt::KeepAspectRatio));
 }
 
-void VideoPlayer::seekForward()
+void VideoPlayer::playbackEnded()
 {
-    double pos = cap.get(cv::CAP_PROP_POS_MSEC);
-    gstSeek(pos + 10000);
+    playPauseButton->setText("Play");
 }
 
-void VideoPlayer::seekBackward()
+void VideoPlayer::seekForward()
 {
-    double pos = cap.get(cv::CAP_PROP_POS_MSEC);
-    gstSeek(qMax(pos - 10000, 0.0));
+    engine.seekBy(10000);
 }
 
-void VideoPlayer::gstSeek(qint64 milliseconds)
+void VideoPlayer::seekBackward()
 {
-    cap.set(cv::CAP_PROP_POS_MSEC, milliseconds);
-    gst_element_seek_simple(pipeline, GST_FORMAT_TIME,
-                            GstSeekFlags(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT),
-                            milliseconds * GST_MSECOND);
+    engine.seekBy(-10000);
 }
 
 void VideoPlayer::volumeChanged(int volume)
 {
-    setGstVolume(volume / 100.0);
-}
-
-void VideoPlayer::setGstVolume(double volume)
-{
-    if (volumeElement)
-        g_object_set(volumeElement, "volume", volume, nullptr);
+    engine.setVolume(volume);
 }
@@ -7,10 +7,9 @@
 #include <QSlider>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
-#include <QTimer>
 
-#include <opencv2/opencv.hpp>
-#include <gst/gst.h>
+#include "playbackengine.h"
+#include "framemailbox.h"
 
 class VideoPlayer : public QWidget
 {
@@ -22,15 +21,13 @@ public:
 
 private slots:
     void playPause();
-    void updateFrame();
     void seekForward();
     void seekBackward();
     void volumeChanged(int volume);
 
 private:
-    void initGStreamerPipeline(const QString &path);
-    void setGstVolume(double volume);
-    void gstSeek(qint64 milliseconds);
+    void showFrame(const cv::Mat &frame);
+    void playbackEnded();
 
     QLabel *videoLabel;
     QPushButton *playPauseButton;
@@ -38,13 +35,10 @@ private:
     QPushButton *backwardButton;
     QSlider *volumeSlider;
 
-    cv::VideoCapture cap;
-    QTimer frameTimer;
-
-    bool isPlaying;
-
-    GstElement *pipeline;
-    GstElement *volumeElement;
+    // Frames come from the engine's presenter thread, the newest one is shown on the UI thread.
+    // The mailbox is declared last so the frames it still holds are released first.
+    PlaybackEngine engine;
+    FrameMailbox videoMailbox;
 };
 
 #endif // VIDEOPLAYER_H
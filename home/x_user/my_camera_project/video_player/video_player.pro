@@ -9,10 +9,8 @@ SOURCES += main.cpp \
 
 HEADERS += VideoPlayer.h
 
+# Playback engine shared with my_camera_project
+include(../playback.pri)
+
 # OpenCV
-INCLUDEPATH += /usr/include/opencv4
 LIBS += `pkg-config --libs opencv4`
-
-# GStreamer
-CONFIG += link_pkgconfig
-PKGCONFIG += gstreamer-1.0 gstreamer-video-1.0 gstreamer-audio-1.0
@@ -0,0 +1,349 @@
+#ifndef VIDEOSURFACE_H
+#define VIDEOSURFACE_H
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLContext>
+#include <QElapsedTimer>
+#include <QImage>
+#include "Logger.h"
+#include "frametrace.h"
+// Undefine the Status macro before including OpenCV to prevent conflict with X11
+#undef Status
+#include <opencv2/opencv.hpp>
+
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_BUFFER_BIT
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#endif
+#ifndef GL_UNPACK_ROW_LENGTH
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+
+// OpenGL video surface replacing the QGraphicsView + QPixmap display path.
+// Frames are uploaded into one persistent texture (reallocated only when the
+// geometry changes), through two alternating pixel buffer objects when the
+// context is GL/GLES 3, and drawn as a single quad: colour conversion (YUY2 and
+// BGR) and scaling happen in the fragment shader. Works on Mesa llvmpipe, so it
+// can be tested on a machine without a GPU.
+class VideoSurface : public QOpenGLWidget, protected QOpenGLFunctions {
+public:
+    enum class ScaleMode {
+        Fit,     // Qt::KeepAspectRatio
+        Fill,    // Qt::KeepAspectRatioByExpanding, cropped to the widget
+        Stretch  // Qt::IgnoreAspectRatio
+    };
+
+    struct Stats {
+        uint64_t frames = 0;        // setFrame/setImage calls
+        uint64_t uploads = 0;       // textures uploaded by paintGL
+        uint64_t pbo_uploads = 0;   // of which through a pixel buffer object
+        uint64_t painted = 0;       // paintGL calls that drew a frame
+        double mean_set_ms = 0;     // UI-thread cost of setFrame/setImage
+        double mean_paint_ms = 0;   // UI-thread cost of paintGL (upload + draw)
+        double max_paint_ms = 0;
+    };
+
+    explicit VideoSurface(ScaleMode _mode = ScaleMode::Fill, QWidget* parent = nullptr)
+        : QOpenGLWidget(parent), mode(_mode) {
+        LOG_INFO("VideoSurface Constructor");
+        setAutoFillBackground(false);
+    }
+
+    ~VideoSurface() {
+        makeCurrent();
+        if (texture)
+            glDeleteTextures(1, &texture);
+        if (pbo[0] && extra)
+            extra->glDeleteBuffers(2, pbo);
+        delete program;
+        doneCurrent();
+    }
+
+    // Deleted copy operations, the surface owns GL objects
+    VideoSurface(const VideoSurface&) = delete;
+    VideoSurface& operator=(const VideoSurface&) = delete;
+
+    // True when an OpenGL context can be created on this platform
+    static bool isSupported() {
+        QOpenGLContext context;
+        return context.create();
+    }
+
+    // BGR (CV_8UC3), YUY2 (CV_8UC2) or grayscale (CV_8UC1) frame; the header is kept until the next paint
+    void setFrame(const cv::Mat& _frame) {
+        QElapsedTimer timer;
+        timer.start();
+        frame = _frame;
+        image = QImage();
+        dirty = !frame.empty();
+        has_frame = dirty;
+        update();
+        recordSet(timer.nsecsElapsed());
+    }
+
+    // Message images (no camera, no frame) drawn with the same path
+    void setImage(const QImage& _image) {
+        QElapsedTimer timer;
+        timer.start();
+        image = _image.convertToFormat(QImage::Format_BGR888);
+        frame = image.isNull() ? cv::Mat() : cv::Mat(image.height(), image.width(), CV_8UC3, const_cast<uchar*>(image.constBits()), image.bytesPerLine());
+        dirty = !frame.empty();
+        has_frame = dirty;
+        update();
+        recordSet(timer.nsecsElapsed());
+    }
+
+    // Blank surface, e.g. while no video is loaded
+    void clear() {
+        frame = cv::Mat();
+        image = QImage();
+        dirty = false;
+        has_frame = false;
+        update();
+    }
+
+    void setScaleMode(ScaleMode _mode) {
+        mode = _mode;
+        update();
+    }
+
+    Stats getStats() const {
+        return stats;
+    }
+
+    void resetStats() {
+        stats = Stats();
+        set_ns = 0;
+        paint_ns = 0;
+    }
+
+    void logStats(const std::string& _name) const {
+        LOG_INFO("VideoSurface " + _name + " frames " + std::to_string(stats.frames) +
+                 ", painted " + std::to_string(stats.painted) +
+                 ", uploads " + std::to_string(stats.uploads) + " (pbo " + std::to_string(stats.pbo_uploads) + ")" +
+                 ", set " + std::to_string(stats.mean_set_ms) + " ms" +
+                 ", paint " + std::to_string(stats.mean_paint_ms) + " ms (max " + std::to_string(stats.max_paint_ms) + " ms)");
+    }
+
+protected:
+    void initializeGL() override {
+        initializeOpenGLFunctions();
+        QOpenGLContext* ctx = context();
+        use_pbo = ctx && ctx->format().majorVersion() >= 3;
+        row_length = ctx && (!ctx->isOpenGLES() || ctx->format().majorVersion() >= 3);
+        if (use_pbo) {
+            extra = ctx->extraFunctions();
+            extra->glGenBuffers(2, pbo);
+        }
+        glGenTextures(1, &texture);
+        program = new QOpenGLShaderProgram();
+        program->addShaderFromSourceCode(QOpenGLShader::Vertex,
+            "attribute vec2 a_pos;\n"
+            "attribute vec2 a_tex;\n"
+            "varying vec2 v_tex;\n"
+            "void main() {\n"
+            "    gl_Position = vec4(a_pos, 0.0, 1.0);\n"
+            "    v_tex = a_tex;\n"
+            "}\n");
+        program->addShaderFromSourceCode(QOpenGLShader::Fragment,
+            "#ifdef GL_ES\n"
+            "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+            "precision highp float;\n"
+            "#else\n"
+            "precision mediump float;\n"
+            "#endif\n"
+            "#endif\n"
+            "uniform sampler2D u_tex;\n"
+            "uniform int u_format;\n"
+            "uniform float u_width;\n"
+            "varying vec2 v_tex;\n"
+            "void main() {\n"
+            "    vec4 t = texture2D(u_tex, v_tex);\n"
+            "    if (u_format == 1) {\n"
+            "        // YUY2 texel = Y0 U Y1 V, pick the luma of the left or right pixel\n"
+            "        float y = fract(v_tex.x * u_width * 0.5) < 0.5 ? t.r : t.b;\n"
+            "        float c = 1.164 * (y - 0.0625);\n"
+            "        float u = t.g - 0.5;\n"
+            "        float v = t.a - 0.5;\n"
+            "        gl_FragColor = vec4(c + 1.596 * v, c - 0.391 * u - 0.813 * v, c + 2.018 * u, 1.0);\n"
+            "    } else if (u_format == 2) {\n"
+            "        gl_FragColor = vec4(t.rrr, 1.0);\n"
+            "    } else {\n"
+            "        gl_FragColor = vec4(t.bgr, 1.0);\n"
+            "    }\n"
+            "}\n");
+        program->bindAttributeLocation("a_pos", 0);
+        program->bindAttributeLocation("a_tex", 1);
+        if (!program->link())
+            LOG_ERROR("VideoSurface shader link failed: " + program->log().toStdString());
+        LOG_INFO(std::string("VideoSurface OpenGL ") + (ctx && ctx->isOpenGLES() ? "ES " : "") +
+                 std::to_string(ctx ? ctx->format().majorVersion() : 0) + "." + std::to_string(ctx ? ctx->format().minorVersion() : 0) +
+                 (use_pbo ? ", PBO uploads" : ", direct uploads"));
+    }
+
+    void paintGL() override {
+        QElapsedTimer timer;
+        timer.start();
+        glClearColor(0, 0, 0, 1);
+        glClear(GL_COLOR_BUFFER_BIT);
+        if (!has_frame || !program || !program->isLinked())
+            return;
+        bool uploaded = dirty;
+        if (dirty) {
+            upload();
+            dirty = false;
+        }
+        if (tex_width == 0)
+            return;
+        float sx = 1.0f, sy = 1.0f;
+        if (mode != ScaleMode::Stretch && width() > 0 && height() > 0) {
+            float fx = static_cast<float>(width()) / frame_width;
+            float fy = static_cast<float>(height()) / frame_height;
+            float scale = mode == ScaleMode::Fit ? std::min(fx, fy) : std::max(fx, fy);
+            sx = frame_width * scale / width();
+            sy = frame_height * scale / height();
+        }
+        const GLfloat vertices[] = { -sx, -sy,  sx, -sy,  -sx, sy,  sx, sy };
+        const GLfloat coords[] = { 0, 1,  1, 1,  0, 0,  1, 0 };
+        program->bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        program->setUniformValue("u_tex", 0);
+        program->setUniformValue("u_format", tex_kind);
+        program->setUniformValue("u_width", static_cast<GLfloat>(frame_width));
+        program->enableAttributeArray(0);
+        program->enableAttributeArray(1);
+        program->setAttributeArray(0, GL_FLOAT, vertices, 2);
+        program->setAttributeArray(1, GL_FLOAT, coords, 2);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        program->disableAttributeArray(0);
+        program->disableAttributeArray(1);
+        program->release();
+        if (uploaded) {
+            FrameTrace::mark(frame, FrameTrace::Painted);
+            // The pixels are in the texture, let the frame buffer go back to its pool
+            frame = cv::Mat();
+            image = QImage();
+        }
+        recordPaint(timer.nsecsElapsed());
+    }
+
+private:
+    ScaleMode mode;
+    cv::Mat frame;
+    QImage image;
+    bool dirty = false;
+    bool has_frame = false;
+    QOpenGLShaderProgram* program = nullptr;
+    QOpenGLExtraFunctions* extra = nullptr;
+    GLuint texture = 0;
+    GLuint pbo[2] = {0, 0};
+    int pbo_index = 0;
+    bool use_pbo = false;
+    bool row_length = false;
+    // Current texture allocation
+    int tex_kind = 0;       // 0 BGR, 1 YUY2, 2 gray
+    int tex_width = 0;
+    int tex_height = 0;
+    int frame_width = 0;
+    int frame_height = 0;
+    std::vector<uchar> scratch;
+    Stats stats;
+    qint64 set_ns = 0;
+    qint64 paint_ns = 0;
+
+    void upload() {
+        int kind = frame.type() == CV_8UC2 ? 1 : frame.type() == CV_8UC1 ? 2 : 0;
+        GLenum format = kind == 1 ? GL_RGBA : kind == 2 ? GL_LUMINANCE : GL_RGB;
+        int width = kind == 1 ? frame.cols / 2 : frame.cols;
+        size_t row_bytes = frame.cols * frame.elemSize();
+        size_t texel_bytes = kind == 1 ? 4 : frame.elemSize();
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (kind != tex_kind || width != tex_width || frame.rows != tex_height) {
+            // Packed YUY2 must not be interpolated, BGR and gray scale smoothly
+            GLint filter = kind == 1 ? GL_NEAREST : GL_LINEAR;
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, width, frame.rows, 0, format, GL_UNSIGNED_BYTE, nullptr);
+            tex_kind = kind;
+            tex_width = width;
+            tex_height = frame.rows;
+        }
+        frame_width = frame.cols;
+        frame_height = frame.rows;
+        stats.uploads++;
+        if (use_pbo) {
+            // Alternate buffers and orphan the storage so the driver never waits for the previous transfer
+            GLsizeiptr size = static_cast<GLsizeiptr>(row_bytes * frame.rows);
+            extra->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[pbo_index]);
+            pbo_index ^= 1;
+            extra->glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            uchar* dst = static_cast<uchar*>(extra->glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+            if (dst) {
+                copyRows(dst, row_bytes);
+                extra->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, frame.rows, format, GL_UNSIGNED_BYTE, nullptr);
+                extra->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                stats.pbo_uploads++;
+                return;
+            }
+            extra->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        if (frame.step == row_bytes) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, frame.rows, format, GL_UNSIGNED_BYTE, frame.data);
+        } else if (row_length && frame.step % texel_bytes == 0) {
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(frame.step / texel_bytes));
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, frame.rows, format, GL_UNSIGNED_BYTE, frame.data);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        } else {
+            scratch.resize(row_bytes * frame.rows);
+            copyRows(scratch.data(), row_bytes);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, frame.rows, format, GL_UNSIGNED_BYTE, scratch.data());
+        }
+    }
+
+    void copyRows(uchar* _dst, size_t _row_bytes) {
+        if (frame.isContinuous()) {
+            std::memcpy(_dst, frame.data, _row_bytes * frame.rows);
+            return;
+        }
+        for (int r = 0; r < frame.rows; ++r)
+            std::memcpy(_dst + r * _row_bytes, frame.ptr(r), _row_bytes);
+    }
+
+    void recordSet(qint64 _ns) {
+        stats.frames++;
+        set_ns += _ns;
+        stats.mean_set_ms = set_ns / 1e6 / stats.frames;
+    }
+
+    void recordPaint(qint64 _ns) {
+        stats.painted++;
+        paint_ns += _ns;
+        double ms = _ns / 1e6;
+        stats.max_paint_ms = std::max(stats.max_paint_ms, ms);
+        stats.mean_paint_ms = paint_ns / 1e6 / stats.painted;
+    }
+};
+#endif // VIDEOSURFACE_H
@@ -0,0 +1,177 @@
+#include "/home/x_user/my_camera_project/gststreamer.h"
+#include "/home/x_user/my_camera_project/streamcontroller.h"
+#include "lossy_relay.h"
+#include <cstdio>
+#include <thread>
+// Adaptive stream control loop over a local lossy UDP relay.
+// The sender streams through rtpbin to the relay, which forwards RTP to the receiver with a
+// configurable loss rate and RTCP in both directions untouched. The receiver's reports drive
+// StreamController exactly like Camerareader::adaptStream(): clean, lossy, clean again.
+// g++ -O2 -std=c++17 adaptive_stream_test.cpp -o adaptive_stream_test -lpthread `pkg-config --cflags --libs gstreamer-1.0 gstreamer-app-1.0 opencv4`
+// ./adaptive_stream_test [loss percent] [lossy seconds]
+
+static int check(bool _ok, const char* _what) {
+    std::printf("%s %s\n", _ok ? "PASS" : "FAIL", _what);
+    return _ok ? 0 : 1;
+}
+
+// Synthetic feedback sequences, no network involved
+static int testController() {
+    int failures = 0;
+    StreamController controller;
+    std::vector<StreamController::Rung> lower = {{800, 600, 25, 900}, {640, 480, 20, 500}, {320, 240, 15, 0}};
+    std::vector<StreamController::Rung> ladder = StreamController::buildLadder(1024, 768, 25, lower);
+    failures += check(ladder.size() == 4 && ladder[0].width == 1024 && ladder[0].min_kbps > 900, "ladder starts at the negotiated stream");
+    controller.configure(ladder, 2000, 300, 2000);
+
+    StreamController::Feedback clean;
+    clean.report = true;
+    clean.loss = 0;
+    clean.rtt_ms = 20;
+    StreamController::Feedback lossy = clean;
+    lossy.loss = 0.2;
+    StreamController::Feedback quiet;
+
+    for (int i = 0; i < 5; ++i)
+        controller.update(clean);
+    failures += check(controller.getStats().kbps == 2000, "clean path keeps the negotiated bitrate");
+    int lowest = 2000;
+    int deepest = 0;
+    for (int i = 0; i < 12; ++i) {
+        StreamController::Decision decision = controller.update(lossy);
+        // Reports arrive every few updates, the updates in between carry no news
+        controller.update(quiet);
+        lowest = std::min(lowest, decision.kbps);
+        deepest = std::max(deepest, decision.rung);
+    }
+    failures += check(lowest < 1000, "loss lowers the bitrate");
+    failures += check(deepest > 0, "loss steps down the ladder");
+    failures += check(lowest >= 300, "bitrate stays above the minimum");
+    StreamController::Stats before = controller.getStats();
+    for (int i = 0; i < 60; ++i)
+        controller.update(clean);
+    StreamController::Stats after = controller.getStats();
+    failures += check(after.kbps > before.kbps && after.rung < deepest, "clean path recovers bitrate and resolution");
+
+    StreamController::Feedback delayed = clean;
+    delayed.rtt_ms = 400;
+    int kbps = after.kbps;
+    controller.update(delayed);
+    failures += check(controller.getStats().kbps < kbps, "rising RTT lowers the bitrate");
+
+    // Without any receiver reports the encoder queue is the only probe
+    controller.configure(ladder, 2000, 300, 2000);
+    StreamController::Feedback backlog;
+    backlog.queue_drop = 0.5;
+    for (int i = 0; i < 12; ++i)
+        controller.update(quiet);
+    failures += check(controller.getStats().kbps == 2000, "no reports and no backlog holds the bitrate");
+    controller.update(backlog);
+    failures += check(controller.getStats().kbps < 2000, "encoder backlog lowers the bitrate");
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    double loss = argc > 1 ? std::stod(argv[1]) / 100.0 : 0.2;
+    int lossy_seconds = argc > 2 ? std::stoi(argv[2]) : 12;
+    gst_init(&argc, &argv);
+    int failures = testController();
+
+    // Sender 6000 (RTP) / 6001 (RTCP) -> relay -> receiver 6200 / 6201, receiver RTCP 6202 -> relay -> sender 6101
+    LossyRelay relay({{6000, 6200, true}, {6001, 6201, false}, {6202, 6101, false}});
+    GError* error = nullptr;
+    GstElement* receiver = gst_parse_launch(
+        "rtpbin name=rtpbin udpsrc port=6200 caps=\"application/x-rtp,media=video,clock-rate=90000,encoding-name=H264,payload=96\" ! "
+        "rtpbin.recv_rtp_sink_0 rtpbin. ! rtph264depay ! fakesink sync=false "
+        "udpsrc port=6201 ! rtpbin.recv_rtcp_sink_0 rtpbin.send_rtcp_src_0 ! udpsink host=127.0.0.1 port=6202 sync=false async=false", &error);
+    if (!receiver) {
+        std::printf("FAIL receiver: %s\n", error ? error->message : "unknown");
+        return 1;
+    }
+    // Frequent receiver reports so the loop reacts within a second or two
+    GstElement* receiver_rtpbin = gst_bin_get_by_name(GST_BIN(receiver), "rtpbin");
+    GObject* receiver_session = nullptr;
+    g_signal_emit_by_name(receiver_rtpbin, "get-internal-session", 0u, &receiver_session);
+    if (receiver_session) {
+        g_object_set(receiver_session, "rtcp-min-interval", static_cast<guint64>(500 * GST_MSECOND), nullptr);
+        g_object_unref(receiver_session);
+    }
+    gst_object_unref(receiver_rtpbin);
+    gst_element_set_state(receiver, GST_STATE_PLAYING);
+
+    GstStreamer streamer;
+    int start_kbps = 2000;
+    failures += check(streamer.open("rtpbin name=rtpbin appsrc name=streamsrc ! videoconvert ! videoscale ! "
+                                    "capsfilter name=streamcaps caps=\"video/x-raw,width=1024,height=768,framerate=25/1\" ! "
+                                    "vpuenc_h264 name=streamenc bitrate=" + std::to_string(start_kbps) + " ! h264parse ! "
+                                    "rtph264pay config-interval=1 mtu=1400 ! rtpbin.send_rtp_sink_0 "
+                                    "rtpbin.send_rtp_src_0 ! udpsink host=127.0.0.1 port=6000 "
+                                    "rtpbin.send_rtcp_src_0 ! udpsink host=127.0.0.1 port=6001 sync=false async=false "
+                                    "udpsrc port=6101 ! rtpbin.recv_rtcp_sink_0", 1024, 768, 25) == 0, "open");
+    if (!streamer.isOpened())
+        return 1;
+    failures += check(streamer.getBitrate() == start_kbps, "encoder bitrate readable");
+
+    StreamController controller;
+    controller.configure(StreamController::buildLadder(1024, 768, 25, {{800, 600, 25, 900}, {640, 480, 20, 500}, {320, 240, 15, 0}}),
+                         start_kbps, 300, start_kbps);
+    int clean_seconds = 8;
+    int recover_seconds = 30;
+    int total = clean_seconds + lossy_seconds + recover_seconds;
+    int fps = 25;
+    cv::Size size(1024, 768);
+    uint64_t last_pushed = 0, last_dropped = 0;
+    int lowest = start_kbps;
+    int deepest = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int second = 0; second < total; ++second) {
+        relay.setLoss(second >= clean_seconds && second < clean_seconds + lossy_seconds ? loss : 0);
+        for (int i = 0; i < fps; ++i) {
+            cv::Mat frame(size, CV_8UC3, cv::Scalar((second * 7) % 255, 90, 160));
+            cv::circle(frame, cv::Point((i * 37) % size.width, size.height / 2), size.height / 6, cv::Scalar(0, 255, 0), -1);
+            cv::randu(frame(cv::Rect(0, 0, size.width, size.height / 4)), cv::Scalar::all(0), cv::Scalar::all(255));
+            double capture_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            streamer.push(frame, capture_ms);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1000 / fps));
+        }
+        GstStreamer::Report report = streamer.getReceiverReport();
+        GstStreamer::Stats stats = streamer.getStats();
+        StreamController::Feedback feedback;
+        feedback.report = report.fresh;
+        feedback.loss = report.fraction_lost;
+        feedback.rtt_ms = report.rtt_ms;
+        uint64_t pushed = stats.pushed - last_pushed, dropped = stats.dropped - last_dropped;
+        feedback.queue_drop = pushed + dropped > 0 ? static_cast<double>(dropped) / (pushed + dropped) : 0;
+        last_pushed = stats.pushed;
+        last_dropped = stats.dropped;
+        StreamController::Decision decision = controller.update(feedback);
+        if (decision.bitrate_changed)
+            streamer.setBitrate(decision.kbps);
+        if (decision.rung_changed) {
+            StreamController::Rung rung = controller.getRung(decision.rung);
+            size = cv::Size(rung.width, rung.height);
+            fps = rung.fps;
+            streamer.setFormat(rung.width, rung.height, rung.fps);
+        }
+        if (second >= clean_seconds && second < clean_seconds + lossy_seconds) {
+            lowest = std::min(lowest, decision.kbps);
+            deepest = std::max(deepest, decision.rung);
+        }
+        std::printf("%3d s loss %5.1f%% (report %s) rtt %6.1f ms -> %5d kbps, rung %d %dx%d@%d\n", second, report.fraction_lost * 100,
+                    report.fresh ? "new" : "old", report.rtt_ms, decision.kbps, decision.rung, size.width, size.height, fps);
+    }
+    StreamController::Stats stats = controller.getStats();
+    controller.logStats("test");
+    std::printf("relay forwarded %llu, dropped %llu\n", static_cast<unsigned long long>(relay.forwarded()),
+                static_cast<unsigned long long>(relay.dropped()));
+    failures += check(stats.reports > 0, "receiver reports reach the sender");
+    failures += check(lowest < start_kbps * 0.7, "loss on the relay lowers the bitrate");
+    failures += check(deepest > 0, "loss on the relay steps down the ladder");
+    failures += check(stats.kbps > lowest, "bitrate recovers once the relay is clean");
+    failures += check(streamer.getBitrate() == stats.kbps, "encoder runs at the controller bitrate");
+    streamer.close();
+    gst_element_set_state(receiver, GST_STATE_NULL);
+    gst_object_unref(receiver);
+    std::printf("%d failure(s)\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+#ifndef FRAME_CODE_H
+#define FRAME_CODE_H
+
+#pragma once
+#include <cstdint>
+#include <algorithm>
+// Undefine the Status macro before including OpenCV to prevent conflict with X11
+#undef Status
+#include <opencv2/opencv.hpp>
+
+// 64-bit code: 16-bit sequence, 40-bit capture time in us, 8-bit checksum, as 2 rows of 32 blocks
+struct FrameCode {
+    static const int bits = 64;
+    static const int per_row = 32;
+
+    static uint8_t checksum(uint64_t _payload) {
+        uint8_t sum = 0x5a;
+        for (int i = 0; i < 7; ++i)
+            sum = static_cast<uint8_t>((sum << 1 | sum >> 7) ^ ((_payload >> (i * 8)) & 0xff));
+        return sum;
+    }
+
+    static int blockSize(int _width) {
+        return std::max(8, _width / per_row);
+    }
+
+    // Writes the code into the luma of a YUY2 frame, black/white blocks on neutral chroma
+    static void stamp(cv::Mat& _yuy2, uint16_t _seq, uint64_t _us) {
+        uint64_t payload = (static_cast<uint64_t>(_seq) << 40) | (_us & 0xffffffffffULL);
+        uint64_t code = (payload << 8) | checksum(payload);
+        int block = blockSize(_yuy2.cols);
+        for (int bit = 0; bit < bits; ++bit) {
+            uint8_t luma = (code >> (bits - 1 - bit)) & 1 ? 235 : 16;
+            int x0 = (bit % per_row) * block;
+            int y0 = (bit / per_row) * block;
+            for (int y = y0; y < y0 + block && y < _yuy2.rows; ++y) {
+                uint8_t* row = _yuy2.ptr<uint8_t>(y);
+                for (int x = x0; x < x0 + block && x < _yuy2.cols; ++x) {
+                    row[x * 2] = luma;
+                    row[x * 2 + 1] = 128;
+                }
+            }
+        }
+    }
+
+    // Reads the code back from a decoded BGR frame, false when the checksum does not match
+    static bool read(const cv::Mat& _bgr, uint16_t& _seq, uint64_t& _us) {
+        int block = blockSize(_bgr.cols);
+        if (_bgr.rows < 2 * block || _bgr.cols < per_row * block)
+            return false;
+        uint64_t code = 0;
+        for (int bit = 0; bit < bits; ++bit) {
+            int x0 = (bit % per_row) * block + block / 4;
+            int y0 = (bit / per_row) * block + block / 4;
+            cv::Scalar mean = cv::mean(_bgr(cv::Rect(x0, y0, block / 2, block / 2)));
+            code = (code << 1) | ((mean[0] + mean[1] + mean[2]) / 3 > 128 ? 1 : 0);
+        }
+        uint64_t payload = code >> 8;
+        if (checksum(payload) != (code & 0xff))
+            return false;
+        _seq = static_cast<uint16_t>(payload >> 40);
+        _us = payload & 0xffffffffffULL;
+        return true;
+    }
+};
+#endif // FRAME_CODE_H
@@ -0,0 +1,96 @@
+#include "/home/x_user/my_camera_project/gstcapture.h"
+#include <cstdio>
+#include <ctime>
+#include <vector>
+// Checks the zero-copy appsink backend against videotestsrc with the loopback caps.
+// videotestsrc stands in for the camera: sensorcaps sets the mode it produces, like v4l2src.
+// Each mode switch is made twice, with the sensor pinned at 1024x768@30 and with the sensor
+// renegotiated to the profile's own mode, and prints the switch latency and the process CPU.
+// g++ -O2 -std=c++17 gst_capture_test.cpp -o gst_capture_test `pkg-config --cflags --libs gstreamer-1.0 gstreamer-app-1.0 gstreamer-video-1.0 opencv4`
+// ./gst_capture_test [frames]
+
+static int check(bool _ok, const char* _what) {
+    std::printf("%s %s\n", _ok ? "PASS" : "FAIL", _what);
+    return _ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? std::stoi(argv[1]) : 60;
+    gst_init(&argc, &argv);
+    int failures = 0;
+
+    GstCapture capture;
+    failures += check(capture.open("videotestsrc is-live=true pattern=ball ! "
+                                   "capsfilter name=sensorcaps caps=video/x-raw,format=YUY2,width=1024,height=768,framerate=30/1 ! "
+                                   "videorate drop-only=true ! videoscale method=nearest-neighbour ! "
+                                   "capsfilter name=capcaps caps=video/x-raw,format=YUY2,width=1024,height=768,framerate=30/1 ! "
+                                   "appsink name=camsink sync=false max-buffers=1 drop=true") == 0, "open");
+    if (!capture.isOpened())
+        return 1;
+    failures += check(capture.getWidth() == 1024 && capture.getHeight() == 768 && capture.getFormat() == "YUY2", "negotiated geometry");
+    failures += check(capture.getFps() == 30, "negotiated framerate");
+
+    // Hold two frames across later reads, like mailbox entries, and make sure they stay intact
+    std::vector<cv::Mat> held;
+    std::vector<cv::Mat> copies;
+    double last = -1;
+    bool monotonic = true;
+    bool wrapped = true;
+    for (int i = 0; i < frames; ++i) {
+        cv::Mat frame;
+        double timestamp = -1;
+        if (!capture.read(frame, timestamp, 1000)) {
+            failures += check(false, "read");
+            break;
+        }
+        wrapped = wrapped && frame.type() == CV_8UC2 && frame.u && frame.u->userdata;
+        monotonic = monotonic && timestamp > last;
+        last = timestamp;
+        if (i == 1 || i == 2) {
+            held.push_back(frame);
+            copies.push_back(frame.clone());
+        }
+    }
+    failures += check(wrapped, "frames wrap the mapped buffer");
+    failures += check(monotonic, "buffer timestamps increase");
+    failures += check(capture.getOutstanding() == static_cast<int>(held.size()), "only held frames stay outstanding");
+    bool intact = held.size() == 2;
+    for (size_t i = 0; i < held.size(); ++i)
+        intact = intact && cv::norm(held[i], copies[i], cv::NORM_INF) == 0;
+    failures += check(intact, "held frames unchanged by later reads");
+    held.clear();
+    failures += check(capture.getOutstanding() == 0, "released frames return to the pipeline");
+
+    // Switch modes in place the way streamstart/streamend and the standalone preview do,
+    // first with the sensor pinned at full size, then with the sensor in the delivered mode
+    const int modes[][3] = {{1024, 768, 15}, {320, 240, 15}, {1024, 768, 30}};
+    for (int per_profile = 0; per_profile < 2; ++per_profile) {
+        for (const auto& mode : modes) {
+            bool switched = per_profile ? capture.reconfigure(mode[0], mode[1], mode[2], "", mode[0], mode[1], mode[2]) == 0
+                                        : capture.reconfigure(mode[0], mode[1], mode[2], "", 1024, 768, 30) == 0;
+            cv::Mat frame;
+            double timestamp = -1;
+            for (int i = 0; switched && i < 60 && !capture.waitReconfigured(0); ++i)
+                switched = capture.read(frame, timestamp, 1000);
+            switched = switched && capture.waitReconfigured(0) && frame.cols == mode[0] && frame.rows == mode[1];
+            GstCapture::SwitchStats stats = capture.getSwitchStats();
+            // CPU of the whole process (source, scaling, conversion threads) over 2 s in the new mode
+            std::clock_t cpu_start = std::clock();
+            auto wall_start = std::chrono::steady_clock::now();
+            int read = 0;
+            while (switched && std::chrono::steady_clock::now() - wall_start < std::chrono::seconds(2)) {
+                if (capture.read(frame, timestamp, 1000))
+                    read++;
+            }
+            double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_start).count();
+            double cpu_ms = 1000.0 * (std::clock() - cpu_start) / CLOCKS_PER_SEC;
+            std::printf("sensor %s, switch to %dx%d@%d: %.1f ms, %d frames in 2 s, cpu %.1f%%\n", per_profile ? "per profile" : "pinned",
+                        mode[0], mode[1], mode[2], stats.last_ms, read, wall_ms > 0 ? 100.0 * cpu_ms / wall_ms : 0.0);
+            failures += check(switched, "in-place switch");
+        }
+    }
+
+    capture.close();
+    std::printf("%d failure(s)\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+#include "/home/x_user/my_camera_project/gststreamer.h"
+#include "/home/x_user/my_camera_project/framepool.h"
+#include <gst/app/gstappsink.h>
+#include <cstdio>
+#include <thread>
+#include <filesystem>
+#include <fstream>
+// Streams pooled frames through the native appsrc writer over RTP on loopback and decodes them again.
+// vpuenc_* is replaced by x264enc/x265enc when the VPU plugins are not installed.
+// The same encoded stream also goes to a second receiver and into 1 s recorded segments under a small budget.
+// g++ -O2 -std=c++17 gst_streamer_test.cpp -o gst_streamer_test `pkg-config --cflags --libs gstreamer-1.0 gstreamer-app-1.0 opencv4`
+// ./gst_streamer_test [h264|h265] [frames]
+
+static int check(bool _ok, const char* _what) {
+    std::printf("%s %s\n", _ok ? "PASS" : "FAIL", _what);
+    return _ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    std::string codec = argc > 1 ? argv[1] : "h264";
+    int frames = argc > 2 ? std::stoi(argv[2]) : 90;
+    gst_init(&argc, &argv);
+    int failures = 0;
+    bool hevc = codec == "h265";
+    std::string enc = hevc ? "vpuenc_hevc bitrate=2000 ! h265parse ! rtph265pay" : "vpuenc_h264 bitrate=2000 profile=9 ! h264parse ! rtph264pay";
+    std::string dec = hevc ? "rtph265depay ! h265parse ! avdec_h265" : "rtph264depay ! h264parse ! avdec_h264";
+
+    GError* error = nullptr;
+    GstElement* receivers[2] = {nullptr, nullptr};
+    GstElement* outs[2] = {nullptr, nullptr};
+    for (int i = 0; i < 2; ++i) {
+        receivers[i] = gst_parse_launch(("udpsrc port=" + std::to_string(5600 + 2 * i) +
+                                         " caps=\"application/x-rtp,media=video,clock-rate=90000,encoding-name=" +
+                                         std::string(hevc ? "H265" : "H264") + ",payload=96\" ! " + dec +
+                                         " ! videoconvert ! appsink name=out sync=false").c_str(), &error);
+        if (!receivers[i]) {
+            std::printf("FAIL receiver: %s\n", error ? error->message : "unknown");
+            return 1;
+        }
+        outs[i] = gst_bin_get_by_name(GST_BIN(receivers[i]), "out");
+        gst_element_set_state(receivers[i], GST_STATE_PLAYING);
+    }
+    GstElement* out = outs[0];
+
+    std::string record_dir = "/tmp/gst_streamer_test";
+    std::filesystem::remove_all(record_dir);
+    // Segments of an earlier call that fill the budget and must be evicted first
+    std::filesystem::create_directories(record_dir);
+    for (int i = 0; i < 2; ++i)
+        std::ofstream(record_dir + "/call_20000101_000000_0000" + std::to_string(i) + ".mp4") << std::string(600 * 1000, 'x');
+    GstStreamer::Outputs outputs;
+    outputs.destinations = {"127.0.0.1:5602"};
+    outputs.record_dir = record_dir;
+    outputs.segment_seconds = 1;
+    outputs.record_max_bytes = 3 * 2000 * 1000 / 8;
+
+    GstStreamer streamer;
+    streamer.setOutputs(outputs);
+    failures += check(streamer.open("appsrc name=streamsrc ! videoconvert ! " + enc + " aggregate-mode=zero-latency config-interval=1 mtu=1400 ! "
+                                    "udpsink host=127.0.0.1 port=5600", 640, 480, 30) == 0, "open");
+    if (!streamer.isOpened())
+        return 1;
+
+    // Frames come from a pool like the stream subscriber's, with capture timestamps 33 ms apart
+    FramePool pool("stream", 8);
+    int max_depth = 0;
+    for (int i = 0; i < frames; ++i) {
+        cv::Mat frame = pool.acquire(cv::Size(640, 480), CV_8UC3);
+        if (frame.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+        frame.setTo(cv::Scalar(i * 3 % 255, 128, 255 - i * 3 % 255));
+        cv::circle(frame, cv::Point(20 + i * 6 % 600, 240), 40, cv::Scalar(0, 255, 0), -1);
+        streamer.push(frame, 1000.0 + i * 33.3);
+        max_depth = std::max(max_depth, streamer.getQueueDepth());
+        std::this_thread::sleep_for(std::chrono::milliseconds(33));
+    }
+
+    int received = 0;
+    GstSample* sample = nullptr;
+    while ((sample = gst_app_sink_try_pull_sample(GST_APP_SINK(out), 500 * GST_MSECOND)) != nullptr) {
+        received++;
+        gst_sample_unref(sample);
+    }
+    GstStreamer::Stats stats = streamer.getStats();
+    std::printf("pushed %llu, dropped %llu, received %d, max queue %d, push %.1f us (max %.1f us)\n",
+                static_cast<unsigned long long>(stats.pushed), static_cast<unsigned long long>(stats.dropped), received,
+                stats.max_in_flight, stats.mean_push_us, stats.max_push_us);
+    failures += check(stats.pushed > 0 && stats.failed == 0, "frames pushed");
+    failures += check(max_depth <= 4, "queue depth bounded");
+    failures += check(received >= static_cast<int>(stats.pushed) / 2, "frames decoded by the receiver");
+    int received_extra = 0;
+    while ((sample = gst_app_sink_try_pull_sample(GST_APP_SINK(outs[1]), 500 * GST_MSECOND)) != nullptr) {
+        received_extra++;
+        gst_sample_unref(sample);
+    }
+    failures += check(received_extra >= static_cast<int>(stats.pushed) / 2, "frames decoded by the extra destination");
+    failures += check(streamer.isRecording(), "recording branch running");
+    streamer.close();
+    int segments = 0;
+    uint64_t bytes = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(record_dir)) {
+        segments++;
+        bytes += entry.file_size();
+    }
+    SegmentStore::Stats record_stats = streamer.getRecordStats();
+    std::printf("segments opened %llu, evicted %llu, on disk %d (%llu bytes)\n", static_cast<unsigned long long>(record_stats.segments),
+                static_cast<unsigned long long>(record_stats.evicted), segments, static_cast<unsigned long long>(bytes));
+    failures += check(segments > 0 && bytes > 0, "segments recorded");
+    failures += check(record_stats.evicted >= 2 && !std::filesystem::exists(record_dir + "/call_20000101_000000_00000.mp4"),
+                      "oldest segments evicted");
+    failures += check(bytes <= outputs.record_max_bytes + 2000 * 1000 / 8, "recording within its disk budget");
+    FramePool::Stats pool_stats = pool.getStats();
+    failures += check(pool_stats.in_use == 0, "pool buffers returned after close");
+
+    for (int i = 0; i < 2; ++i) {
+        gst_element_set_state(receivers[i], GST_STATE_NULL);
+        gst_object_unref(outs[i]);
+        gst_object_unref(receivers[i]);
+    }
+    std::printf("%d failure(s)\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#include "/home/x_user/my_camera_project/imagekernels.h"
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+// Compares the fused YUY2 kernels against the OpenCV call chain used by the camera pipeline
+// g++ -O3 -std=c++17 image_kernels_bench.cpp -o image_kernels_bench -I/usr/include/opencv4 -lopencv_core -lopencv_imgproc
+// ./image_kernels_bench [iterations]
+
+static double timeit(int iterations, const std::function<void()>& fn) {
+    fn(); // warm up buffers and lookup tables
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+static int maxDiff(const cv::Mat& a, const cv::Mat& b) {
+    cv::Mat diff;
+    cv::absdiff(a, b, diff);
+    double maxval = 0;
+    cv::minMaxLoc(diff.reshape(1), nullptr, &maxval);
+    return static_cast<int>(maxval);
+}
+
+static void bench(cv::Size source, cv::Size target, int iterations) {
+    cv::Mat yuy2(source, CV_8UC2);
+    cv::randu(yuy2, 0, 255);
+    cv::Mat bgr, scaled, resized, gray, kbgr, kscaled, kgray;
+
+    std::printf("source %dx%d -> %dx%d\n", source.width, source.height, target.width, target.height);
+
+    double cv_convert = timeit(iterations, [&]() { cv::cvtColor(yuy2, bgr, cv::COLOR_YUV2BGR_YUY2); });
+    double k_convert = timeit(iterations, [&]() { ImageKernels::yuy2ToBgr(yuy2, kbgr); });
+    std::printf("  YUY2->BGR           opencv %7.3f ms  kernel %7.3f ms  max diff %d\n",
+                cv_convert, k_convert, maxDiff(bgr, kbgr));
+
+    double cv_scale = timeit(iterations, [&]() {
+        cv::cvtColor(yuy2, bgr, cv::COLOR_YUV2BGR_YUY2);
+        cv::resize(bgr, scaled, target, 0, 0, cv::INTER_NEAREST);
+    });
+    double k_scale = timeit(iterations, [&]() { ImageKernels::yuy2ToBgr(yuy2, kscaled, target); });
+    std::printf("  YUY2->BGR+resize    opencv %7.3f ms  kernel %7.3f ms  max diff %d\n",
+                cv_scale, k_scale, maxDiff(scaled, kscaled));
+
+    double cv_gray = timeit(iterations, [&]() {
+        cv::cvtColor(yuy2, bgr, cv::COLOR_YUV2BGR_YUY2);
+        cv::resize(bgr, resized, target, 0, 0, cv::INTER_LINEAR);
+        cv::cvtColor(resized, gray, cv::COLOR_BGR2GRAY);
+    });
+    double k_gray = timeit(iterations, [&]() { ImageKernels::yuy2ToGray(yuy2, kgray, target); });
+    std::printf("  YUY2->gray+resize   opencv %7.3f ms  kernel %7.3f ms\n", cv_gray, k_gray);
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 200;
+#ifdef IMAGEKERNELS_NEON
+    std::printf("NEON path enabled\n");
+#else
+    std::printf("scalar path\n");
+#endif
+    bench(cv::Size(1024, 768), cv::Size(1024, 768), iterations);
+    bench(cv::Size(1024, 768), cv::Size(320, 240), iterations);
+    bench(cv::Size(1024, 768), cv::Size(490, 490), iterations);
+    bench(cv::Size(320, 240), cv::Size(320, 240), iterations);
+    return 0;
+}
@@ -0,0 +1,107 @@
+#ifndef LOSSY_RELAY_H
+#define LOSSY_RELAY_H
+
+#pragma once
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdint>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Forwards datagrams between loopback ports, dropping RTP packets with probability loss
+class LossyRelay {
+public:
+    struct Route {
+        int from;
+        int to;
+        bool lossy;
+    };
+
+    explicit LossyRelay(const std::vector<Route>& _routes) : routes(_routes) {
+        for (const Route& route : routes) {
+            int fd = socket(AF_INET, SOCK_DGRAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(route.from);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+                std::printf("relay could not bind port %d\n", route.from);
+            fds.push_back(fd);
+        }
+        worker = std::thread([this]() { run(); });
+    }
+
+    ~LossyRelay() {
+        running = false;
+        worker.join();
+        for (int fd : fds)
+            close(fd);
+    }
+
+    void setLoss(double _loss) {
+        loss = _loss;
+    }
+
+    uint64_t forwarded() const {
+        return forwarded_count.load();
+    }
+
+    uint64_t dropped() const {
+        return dropped_count.load();
+    }
+
+    // Bytes that arrived on the lossy routes, forwarded or not
+    uint64_t bytes() const {
+        return byte_count.load();
+    }
+
+private:
+    std::vector<Route> routes;
+    std::vector<int> fds;
+    std::thread worker;
+    std::atomic<bool> running{true};
+    std::atomic<double> loss{0};
+    std::atomic<uint64_t> forwarded_count{0};
+    std::atomic<uint64_t> dropped_count{0};
+    std::atomic<uint64_t> byte_count{0};
+
+    void run() {
+        std::mt19937 random(42);
+        std::uniform_real_distribution<double> uniform(0, 1);
+        std::vector<pollfd> polls;
+        for (int fd : fds)
+            polls.push_back(pollfd{fd, POLLIN, 0});
+        char packet[65536];
+        while (running) {
+            if (poll(polls.data(), polls.size(), 50) <= 0)
+                continue;
+            for (size_t i = 0; i < polls.size(); ++i) {
+                if (!(polls[i].revents & POLLIN))
+                    continue;
+                ssize_t size = recv(fds[i], packet, sizeof(packet), 0);
+                if (size <= 0)
+                    continue;
+                if (routes[i].lossy)
+                    byte_count += size;
+                if (routes[i].lossy && uniform(random) < loss.load()) {
+                    dropped_count++;
+                    continue;
+                }
+                sockaddr_in addr{};
+                addr.sin_family = AF_INET;
+                addr.sin_port = htons(routes[i].to);
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                sendto(fds[i], packet, size, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+                if (routes[i].lossy)
+                    forwarded_count++;
+            }
+        }
+    }
+};
+#endif // LOSSY_RELAY_H
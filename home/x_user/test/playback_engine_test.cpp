@@ -0,0 +1,151 @@
+#include "/home/x_user/my_camera_project/playbackengine.h"
+#include "test_clip.h"
+#include <cstdio>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <algorithm>
+// Headless test of PlaybackEngine timing on a generated 12 s, 25 fps clip with a keyframe every 2 s.
+// Audio goes to fakesink sync=true, so no display or sound device is needed. It checks:
+// - pacing: each frame is shown at its PTS on the playback clock (deviation from the median
+//   offset between wall time and PTS, p95 within the tolerance) and the mean frame interval;
+// - drops: at most 2% of the frames are dropped late;
+// - seek: a seek to 6.5 s with the keyframe index (made while paused, playback resumed right after)
+//   shows a frame within one interval of the target, within 500 ms;
+// - end: the end callback is called when the clip has played out.
+// g++ -O2 -std=c++17 playback_engine_test.cpp -o playback_engine_test -lpthread `pkg-config --cflags --libs gstreamer-1.0 gstreamer-app-1.0 gstreamer-video-1.0 opencv4`
+// ./playback_engine_test [tolerance ms]
+
+struct Shown {
+    double wall_ms;
+    double pts_ms;
+    int phase;  // 0 before the seek, 1 after
+};
+
+static const std::chrono::steady_clock::time_point test_start = std::chrono::steady_clock::now();
+
+static double nowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - test_start).count();
+}
+
+static int failures = 0;
+
+static void check(bool _ok, const std::string& _what) {
+    std::printf("%s: %s\n", _ok ? "ok  " : "FAIL", _what.c_str());
+    if (!_ok)
+        failures++;
+}
+
+// p95 deviation of the wall-PTS offset from its median, and the mean frame interval, skipping the first frames of the phase
+static void pacing(const std::vector<Shown>& _shown, int _phase, double& _p95_ms, double& _interval_ms, int& _frames) {
+    std::vector<const Shown*> frames;
+    for (const Shown& shown : _shown)
+        if (shown.phase == _phase)
+            frames.push_back(&shown);
+    _p95_ms = 0;
+    _interval_ms = 0;
+    _frames = static_cast<int>(frames.size());
+    if (frames.size() < 10)
+        return;
+    frames.erase(frames.begin(), frames.begin() + 3);
+    std::vector<double> offsets;
+    for (const Shown* shown : frames)
+        offsets.push_back(shown->wall_ms - shown->pts_ms);
+    std::vector<double> sorted = offsets;
+    std::sort(sorted.begin(), sorted.end());
+    double median = sorted[sorted.size() / 2];
+    std::vector<double> deviations;
+    for (double offset : offsets)
+        deviations.push_back(std::fabs(offset - median));
+    std::sort(deviations.begin(), deviations.end());
+    _p95_ms = deviations[static_cast<size_t>(0.95 * (deviations.size() - 1))];
+    _interval_ms = (frames.back()->wall_ms - frames.front()->wall_ms) / (frames.size() - 1);
+}
+
+int main(int argc, char** argv) {
+    double tolerance_ms = argc > 1 ? std::stod(argv[1]) : 15;
+    gst_init(&argc, &argv);
+    std::string clip = "/tmp/playback_engine_test.mp4";
+    std::printf("writing a 12 s 640x360 test clip to %s ...\n", clip.c_str());
+    if (!TestClip::write(clip, 12, 640, 360, 25, 50)) {
+        std::printf("FAIL: the test clip could not be written\n");
+        return 1;
+    }
+
+    PlaybackEngine engine;
+    KeyframeIndex::Settings keyframes;
+    keyframes.cache_dir = "/tmp/playback_engine_test_keyframes";
+    engine.setSeekSettings(keyframes);
+    engine.setAudioSink("fakesink sync=true");
+    std::mutex shown_mutex;
+    std::vector<Shown> shown;
+    std::atomic<int> phase{0};
+    std::atomic<bool> ended{false};
+    engine.setFrameCallback([&](cv::Mat _frame) {
+        if (_frame.empty())
+            return;
+        std::lock_guard<std::mutex> lock(shown_mutex);
+        shown.push_back({nowMs(), engine.getFramePosition(), phase});
+    });
+    engine.setEndCallback([&]() { ended = true; });
+
+    check(engine.open(clip) == 0, "open");
+    check(engine.isPaused() && !engine.isStopped(), "open leaves the file paused");
+    double interval = 1000.0 / engine.getFps();
+    engine.play();
+    std::this_thread::sleep_for(std::chrono::seconds(3));
+
+    // The index is built in the background on open(), a few ms for this clip
+    for (int i = 0; i < 50 && !engine.hasKeyframeIndex(); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(engine.hasKeyframeIndex(), "keyframe index built");
+    // Paused, no frame can be shown between the phase switch and the seek
+    engine.pause();
+    size_t before_seek = 0;
+    {
+        std::lock_guard<std::mutex> lock(shown_mutex);
+        before_seek = shown.size();
+        phase = 1;
+    }
+    engine.seekTo(6500);
+    engine.play();
+
+    for (int i = 0; i < 100 && !ended; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(ended, "end callback after the clip played out");
+    check(engine.isStopped(), "stopped at the end");
+
+    // The presenter may still be running when the end was missed, stop it before reading
+    engine.stop();
+    PresentScheduler::Stats present = engine.getPresentStats();
+    PlaybackEngine::SeekStats seeks = engine.getSeekStats();
+    PlaybackEngine::QueueStats queue = engine.getQueueStats();
+    double p95 = 0, mean_interval = 0;
+    int frames = 0;
+    for (int p = 0; p < 2; p++) {
+        pacing(shown, p, p95, mean_interval, frames);
+        std::printf("\n%s the seek: %d frames, p95 deviation from PTS %.1f ms, mean interval %.2f ms\n",
+                    p == 0 ? "before" : "after", frames, p95, mean_interval);
+        check(frames >= 10, "frames shown");
+        check(p95 <= tolerance_ms, "frames shown at their PTS (p95 " + std::to_string(p95) + " ms <= " + std::to_string(tolerance_ms) + " ms)");
+        check(std::fabs(mean_interval - interval) <= 0.05 * interval, "mean interval " + std::to_string(mean_interval) + " ms at " + std::to_string(interval) + " ms");
+    }
+    std::printf("\npresented %llu, dropped %llu, late %llu (mean %.1f ms, max %.1f ms)\n", static_cast<unsigned long long>(present.presented),
+                static_cast<unsigned long long>(present.dropped), static_cast<unsigned long long>(present.late), present.mean_late_ms, present.max_late_ms);
+    std::printf("seek latency %.1f ms (indexed %llu, decode-ahead %.0f ms)\n", seeks.last_ms, static_cast<unsigned long long>(seeks.indexed),
+                seeks.mean_decode_ahead_ms);
+    std::printf("frame queue %d frames, mean level %.1f, underruns %llu\n\n", queue.capacity_frames, queue.mean_level_frames,
+                static_cast<unsigned long long>(queue.underruns));
+    check(present.dropped * 50 <= present.presented, "at most 2% dropped");
+    check(seeks.seeks == 1 && seeks.indexed == 1, "seek planned with the keyframe index");
+    check(seeks.last_ms <= 500, "seek latency " + std::to_string(seeks.last_ms) + " ms <= 500 ms");
+    check(shown.size() > before_seek && std::fabs(shown[before_seek].pts_ms - 6500) <= interval,
+          "first frame after the seek at " + std::to_string(shown.size() > before_seek ? shown[before_seek].pts_ms : -1) + " ms for 6500 ms");
+
+    engine.close();
+    if (failures == 0)
+        std::printf("PASS\n");
+    else
+        std::printf("FAIL: %d checks\n", failures);
+    return failures == 0 ? 0 : 1;
+}
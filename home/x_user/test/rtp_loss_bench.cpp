@@ -0,0 +1,204 @@
+#include "/home/x_user/my_camera_project/gststreamer.h"
+#include "/home/x_user/my_camera_project/gstcapture.h"
+#include "/home/x_user/my_camera_project/framepool.h"
+#include "/home/x_user/my_camera_project/imagekernels.h"
+#include "/home/x_user/my_camera_project/rtpprotection.h"
+#include "lossy_relay.h"
+#include "frame_code.h"
+#include "test_clip.h"
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+// Picture quality of the protected RTP stream over a local packet-dropping relay.
+// Stamped frames go through GstStreamer and an rtpbin sender, the relay drops RTP packets
+// (media, retransmissions and FEC alike) with the given probability, and an rtpbin receiver
+// read by GstCapture decodes them. RTCP (receiver reports, NACK, PLI) travels directly.
+// Each loss rate runs without protection, with NACK/RTX, with ULPFEC and with both, and
+// reports intact and corrupt frames, the longest freeze and what each mechanism repaired.
+// Missing VPU elements fall back to x264enc / avdec_h264.
+// g++ -O2 -std=c++17 rtp_loss_bench.cpp -o rtp_loss_bench -lpthread `pkg-config --cflags --libs gstreamer-1.0 gstreamer-app-1.0 gstreamer-video-1.0 opencv4`
+// ./rtp_loss_bench [loss%,loss%,...] [seconds] [kbps] [fec percent] [jitterbuffer ms]
+
+// Sender RTP 7400 -> relay -> receiver 7500, RTCP sender -> 7501, receiver -> 7401
+static const int relay_port = 7400;
+static const int receiver_port = 7500;
+static const std::chrono::steady_clock::time_point bench_start = std::chrono::steady_clock::now();
+
+static uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bench_start).count();
+}
+
+struct Mode {
+    const char* name;
+    bool nack;
+    bool fec;
+};
+
+struct Result {
+    std::string mode;
+    double loss = 0;
+    int sent = 0;
+    int intact = 0;       // decoded with a readable code
+    int corrupt = 0;      // decoded, code damaged by concealment
+    double freeze_ms = 0; // longest run of frames missing or corrupt
+    double mean_ms = 0;
+    double overhead = 0;  // bytes on the wire relative to the unprotected run
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;
+    RtpProtection::Stats sender;
+    RtpProtection::Stats receiver;
+};
+
+static std::string senderPipeline(int _kbps, int _width, int _height, int _fps) {
+    return "rtpbin name=rtpbin appsrc name=streamsrc ! videoconvert ! capsfilter name=streamcaps caps=\"video/x-raw,width=" +
+           std::to_string(_width) + ",height=" + std::to_string(_height) + ",framerate=" + std::to_string(_fps) + "/1\" ! "
+           "vpuenc_h264 name=streamenc bitrate=" + std::to_string(_kbps) + " profile=9 ! h264parse ! "
+           "rtph264pay aggregate-mode=zero-latency config-interval=30 mtu=1400 ! rtpbin.send_rtp_sink_0 "
+           "rtpbin.send_rtp_src_0 ! udpsink host=127.0.0.1 port=" + std::to_string(relay_port) + " "
+           "rtpbin.send_rtcp_src_0 ! udpsink host=127.0.0.1 port=" + std::to_string(receiver_port + 1) + " sync=false async=false "
+           "udpsrc port=" + std::to_string(relay_port + 1) + " ! rtpbin.recv_rtcp_sink_0";
+}
+
+// Same structure as the _vp_remote_rtcp receiver, for H.264
+static std::string receiverPipeline(int _jitter_ms) {
+    std::string decoder = TestClip::available("vpudec") ? "vpudec" : "avdec_h264";
+    return "rtpbin name=rtpbin latency=" + std::to_string(_jitter_ms) + " drop-on-latency=true "
+           "udpsrc port=" + std::to_string(receiver_port) + " caps=\"application/x-rtp,media=video,clock-rate=90000,"
+           "encoding-name=H264,payload=96,rtcp-fb-nack=(boolean)true,rtcp-fb-nack-pli=(boolean)true\" ! rtpbin.recv_rtp_sink_0 "
+           "rtpbin. ! rtph264depay ! h264parse ! " + decoder + " ! videoconvert ! video/x-raw,format=BGR ! "
+           "appsink name=camsink sync=false max-buffers=8 drop=false "
+           "udpsrc port=" + std::to_string(receiver_port + 1) + " ! rtpbin.recv_rtcp_sink_0 rtpbin.send_rtcp_src_0 ! "
+           "udpsink host=127.0.0.1 port=" + std::to_string(relay_port + 1) + " sync=false async=false";
+}
+
+static Result run(const Mode& _mode, double _loss, int _seconds, int _kbps, int _fec_percentage, int _jitter_ms) {
+    Result result;
+    result.mode = _mode.name;
+    result.loss = _loss;
+    const int width = 640, height = 480, fps = 25;
+    RtpProtection::Settings settings;
+    settings.nack = _mode.nack;
+    settings.fec_percentage = _mode.fec ? _fec_percentage : 0;
+
+    LossyRelay relay({{relay_port, receiver_port, true}});
+    relay.setLoss(_loss);
+    GstCapture receiver;
+    receiver.setProtection(settings);
+    GstStreamer streamer;
+    streamer.setProtection(settings);
+    if (streamer.open(senderPipeline(_kbps, width, height, fps), width, height, fps) != 0) {
+        std::printf("sender for %s could not be opened\n", _mode.name);
+        return result;
+    }
+
+    std::atomic<bool> sending{true};
+    std::atomic<int> sent{0};
+    std::thread sender([&]() {
+        FramePool pool("bench", 8);
+        cv::Mat yuy2(height, width, CV_8UC2);
+        auto next = std::chrono::steady_clock::now();
+        for (int i = 0; sending && i < _seconds * fps; ++i) {
+            std::this_thread::sleep_until(next);
+            next += std::chrono::microseconds(1000000 / fps);
+            yuy2.setTo(cv::Scalar(16 + (i * 3) % 200, 128));
+            cv::rectangle(yuy2, cv::Rect((i * 13) % (width - 160), height / 2, 160, 120), cv::Scalar(200, 90), -1);
+            uint64_t capture_us = nowUs();
+            FrameCode::stamp(yuy2, static_cast<uint16_t>(i), capture_us);
+            cv::Mat frame = pool.acquire(cv::Size(width, height), CV_8UC3);
+            if (frame.empty())
+                continue;
+            ImageKernels::yuy2ToBgr(yuy2, frame);
+            streamer.push(frame, capture_us / 1000.0);
+            sent++;
+        }
+    });
+
+    // Sequence numbers of the intact frames, a gap is a freeze on screen
+    std::vector<int> intact;
+    double latency_sum = 0;
+    if (receiver.open(receiverPipeline(_jitter_ms)) == 0) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(_seconds + 2);
+        cv::Mat frame;
+        double pts = -1;
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (!receiver.read(frame, pts, 200)) {
+                if (sent >= _seconds * fps)
+                    break;
+                continue;
+            }
+            uint64_t arrival_us = nowUs();
+            uint16_t seq = 0;
+            uint64_t capture_us = 0;
+            if (!FrameCode::read(frame, seq, capture_us)) {
+                result.corrupt++;
+                continue;
+            }
+            intact.push_back(seq);
+            latency_sum += (arrival_us - capture_us) / 1000.0;
+        }
+    } else {
+        std::printf("receiver for %s could not be opened\n", _mode.name);
+    }
+    sending = false;
+    sender.join();
+    result.sender = streamer.getProtectionStats();
+    result.receiver = receiver.getProtectionStats();
+    receiver.close();
+    streamer.close();
+
+    result.sent = sent;
+    result.intact = static_cast<int>(intact.size());
+    result.mean_ms = intact.empty() ? 0 : latency_sum / intact.size();
+    result.bytes = relay.bytes();
+    result.dropped = relay.dropped();
+    int previous = -1;
+    for (int seq : intact) {
+        if (previous >= 0 && seq > previous)
+            result.freeze_ms = std::max(result.freeze_ms, (seq - previous - 1) * 1000.0 / fps);
+        previous = std::max(previous, seq);
+    }
+    if (previous >= 0)
+        result.freeze_ms = std::max(result.freeze_ms, (result.sent - 1 - previous) * 1000.0 / fps);
+    return result;
+}
+
+int main(int argc, char** argv) {
+    std::string losses = argc > 1 ? argv[1] : "0,2,5,10";
+    int seconds = argc > 2 ? std::stoi(argv[2]) : 15;
+    int kbps = argc > 3 ? std::stoi(argv[3]) : 1500;
+    int fec_percentage = argc > 4 ? std::stoi(argv[4]) : 20;
+    int jitter_ms = argc > 5 ? std::stoi(argv[5]) : 200;
+    gst_init(&argc, &argv);
+
+    const Mode modes[] = {{"none", false, false}, {"nack", true, false}, {"fec", false, true}, {"both", true, true}};
+    std::vector<Result> results;
+    std::stringstream list(losses);
+    for (std::string item; std::getline(list, item, ',');) {
+        double loss = std::stod(item) / 100.0;
+        uint64_t baseline = 0;
+        for (const Mode& mode : modes) {
+            std::printf("running %s at %.1f%% loss for %d s ...\n", mode.name, loss * 100, seconds);
+            Result result = run(mode, loss, seconds, kbps, fec_percentage, jitter_ms);
+            if (baseline == 0)
+                baseline = result.bytes;
+            result.overhead = baseline > 0 ? static_cast<double>(result.bytes) / baseline - 1.0 : 0;
+            results.push_back(result);
+        }
+    }
+
+    std::printf("\n%-5s %6s %6s %6s %6s %9s %8s %8s %7s %7s %7s %7s %7s\n", "mode", "loss%", "sent", "intact", "bad",
+                "freeze ms", "mean ms", "extra%", "nacked", "rtx", "fec", "lost", "pli");
+    int failures = 0;
+    for (const Result& r : results) {
+        std::printf("%-5s %6.1f %6d %6d %6d %9.0f %8.1f %8.1f %7llu %7llu %7llu %7llu %7llu\n", r.mode.c_str(), r.loss * 100,
+                    r.sent, r.intact, r.corrupt, r.freeze_ms, r.mean_ms, r.overhead * 100,
+                    static_cast<unsigned long long>(r.receiver.rtx_requests), static_cast<unsigned long long>(r.sender.rtx_packets),
+                    static_cast<unsigned long long>(r.receiver.fec_recovered), static_cast<unsigned long long>(r.receiver.lost),
+                    static_cast<unsigned long long>(r.receiver.keyframe_requests));
+        if (r.intact == 0)
+            failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
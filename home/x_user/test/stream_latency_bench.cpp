@@ -0,0 +1,233 @@
+#include "/home/x_user/my_camera_project/Configuration.h"
+#include "/home/x_user/my_camera_project/gststreamer.h"
+#include "/home/x_user/my_camera_project/gstcapture.h"
+#include "/home/x_user/my_camera_project/framepool.h"
+#include "/home/x_user/my_camera_project/imagekernels.h"
+#include "frame_code.h"
+#include "test_clip.h"
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <sstream>
+#include <memory>
+#include <algorithm>
+// Glass-to-glass latency of the streaming paths on loopback.
+// Synthetic YUY2 "camera" frames carry their capture time as a block code in the top rows. They go
+// through the same convert (ImageKernels) -> GstStreamer appsrc -> configured _vs_streaming pipeline
+// (encoder, RTP, udpsink) to a local udpsrc -> depay -> decode -> appsink receiver read by GstCapture,
+// which decodes the code and measures latency, jitter and loss. The vp9 mode sends VP9 into the
+// configured _vp_remote receiver instead. Missing VPU elements fall back to software codecs.
+// g++ -O2 -std=c++17 stream_latency_bench.cpp -o stream_latency_bench -lpthread -ljsoncpp `pkg-config --cflags --libs gstreamer-1.0 gstreamer-app-1.0 gstreamer-video-1.0 opencv4`
+// ./stream_latency_bench [config|h264|h265|both|vp9] [kbps,kbps,...] [seconds] [jitterbuffer ms] [configuration_ap.json]
+
+static const int bench_port = 7301;
+static const std::chrono::steady_clock::time_point bench_start = std::chrono::steady_clock::now();
+
+static uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bench_start).count();
+}
+
+struct Result {
+    std::string codec;
+    int kbps = 0;
+    int sent = 0;
+    int received = 0;
+    int unreadable = 0;
+    double loss = 0;
+    double mean_ms = 0, p50_ms = 0, p95_ms = 0, p99_ms = 0, max_ms = 0;
+    double jitter_ms = 0;
+};
+
+static std::string replaceAll(std::string _text, const std::string& _from, const std::string& _to) {
+    for (size_t pos = _text.find(_from); pos != std::string::npos; pos = _text.find(_from, pos + _to.size()))
+        _text.replace(pos, _from.size(), _to);
+    return _text;
+}
+
+// Loads the configuration with streaming_codex and server_port overridden, so the pipelines
+// are assembled exactly as the application does it
+static std::unique_ptr<Configuration> loadConfiguration(const std::string& _path, int _codec) {
+    std::ifstream file(_path);
+    Json::Value root;
+    Json::CharReaderBuilder reader;
+    std::string errs;
+    if (!file.is_open() || !Json::parseFromStream(reader, file, &root, &errs)) {
+        std::printf("could not read %s\n", _path.c_str());
+        return nullptr;
+    }
+    if (_codec >= 0)
+        root["streaming_codex"] = _codec;
+    root["server_port"] = bench_port;
+    std::string copy = "/tmp/stream_latency_bench.json";
+    std::ofstream out(copy);
+    out << root;
+    out.close();
+    return std::make_unique<Configuration>(copy);
+}
+
+static std::string receiverPipeline(const std::string& _codec, int _jitter_ms, Configuration& _config) {
+    if (_codec == "vp9") {
+        // The configured remote receiver, with the BGR conversion cv::VideoCapture would add
+        std::string pipeline = _config._vp_remote;
+        if (!TestClip::available("vpudec"))
+            pipeline = replaceAll(pipeline, "vpudec", "vp9dec");
+        return replaceAll(pipeline, "appsink", "video/x-raw,format=BGR ! appsink name=camsink");
+    }
+    bool hevc = _codec == "h265";
+    std::string decoder = TestClip::available("vpudec") ? "vpudec" : (hevc ? "avdec_h265" : "avdec_h264");
+    return "udpsrc port=" + std::to_string(bench_port) + " caps=\"application/x-rtp,media=video,clock-rate=90000,encoding-name=" +
+           (hevc ? "H265" : "H264") + ",payload=96\" ! rtpjitterbuffer latency=" + std::to_string(_jitter_ms) + " ! " +
+           (hevc ? "rtph265depay ! h265parse" : "rtph264depay ! h264parse") + " ! " + decoder +
+           " ! videoconvert ! video/x-raw,format=BGR ! appsink name=camsink sync=false max-buffers=8 drop=false";
+}
+
+static std::string senderPipeline(const std::string& _codec, int _kbps, int _width, int _height, int _fps, Configuration& _config) {
+    if (_codec == "vp9")
+        return "appsrc name=streamsrc ! videoconvert ! vp9enc deadline=1 cpu-used=8 lag-in-frames=0 end-usage=cbr target-bitrate=" +
+               std::to_string(_kbps * 1000) + " ! rtpvp9pay mtu=1400 ! udpsink host=127.0.0.1 port=" + std::to_string(bench_port);
+    _config.updatestreaming(_kbps, _fps, _width, _height);
+    std::string pipeline = _config._vs_streaming;
+    pipeline = _config.replacePlaceholder(pipeline, "$VPN_ADDR", "127.0.0.1");
+    pipeline = _config.replacePlaceholder(pipeline, "$server_port", std::to_string(bench_port));
+    return _config.replacePlaceholder(pipeline, "$rtcp_port", std::to_string(bench_port + 1));
+}
+
+static Result run(const std::string& _codec, int _kbps, int _seconds, int _jitter_ms, Configuration& _config) {
+    Result result;
+    result.codec = _codec;
+    result.kbps = _kbps;
+    int width = _config.swidth, height = _config.sheight, fps = _config.speriod > 0 ? _config.speriod : 25;
+
+    GstStreamer streamer;
+    if (streamer.open(senderPipeline(_codec, _kbps, width, height, fps, _config), width, height, fps) != 0) {
+        std::printf("sender for %s could not be opened\n", _codec.c_str());
+        return result;
+    }
+    // Camera: YUY2 frames with moving content, stamped at capture, converted like CaptureFrame does
+    std::atomic<bool> sending{true};
+    std::atomic<int> sent{0};
+    std::thread sender([&]() {
+        FramePool pool("bench", 8);
+        cv::Mat yuy2(height, width, CV_8UC2);
+        auto next = std::chrono::steady_clock::now();
+        for (int i = 0; sending && i < _seconds * fps; ++i) {
+            std::this_thread::sleep_until(next);
+            next += std::chrono::microseconds(1000000 / fps);
+            yuy2.setTo(cv::Scalar(16 + (i * 3) % 200, 128));
+            cv::rectangle(yuy2, cv::Rect((i * 13) % (width - 200), height / 2, 200, 150), cv::Scalar(200, 90), -1);
+            uint64_t capture_us = nowUs();
+            FrameCode::stamp(yuy2, static_cast<uint16_t>(i), capture_us);
+            cv::Mat frame = pool.acquire(cv::Size(width, height), CV_8UC3);
+            if (frame.empty())
+                continue;
+            ImageKernels::yuy2ToBgr(yuy2, frame);
+            streamer.push(frame, capture_us / 1000.0);
+            sent++;
+        }
+    });
+
+    GstCapture receiver;
+    std::vector<double> latencies;
+    int first_seq = -1, last_seq = -1;
+    if (receiver.open(receiverPipeline(_codec, _jitter_ms, _config)) == 0) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(_seconds + 2);
+        cv::Mat frame;
+        double pts = -1;
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (!receiver.read(frame, pts, 200)) {
+                if (!sending || sent >= _seconds * fps)
+                    break;
+                continue;
+            }
+            uint64_t arrival_us = nowUs();
+            uint16_t seq = 0;
+            uint64_t capture_us = 0;
+            if (!FrameCode::read(frame, seq, capture_us)) {
+                result.unreadable++;
+                continue;
+            }
+            if (first_seq < 0)
+                first_seq = seq;
+            last_seq = std::max(last_seq, static_cast<int>(seq));
+            latencies.push_back((arrival_us - capture_us) / 1000.0);
+        }
+    } else {
+        std::printf("receiver for %s could not be opened\n", _codec.c_str());
+    }
+    sending = false;
+    sender.join();
+    receiver.close();
+    streamer.close();
+
+    result.sent = sent;
+    result.received = static_cast<int>(latencies.size());
+    if (latencies.empty())
+        return result;
+    // Frames before the first decodable one (no keyframe yet) are not counted as lost
+    int expected = last_seq - first_seq + 1;
+    result.loss = expected > 0 ? 1.0 - static_cast<double>(result.received) / expected : 0;
+    double sum = 0, variation = 0;
+    for (size_t i = 0; i < latencies.size(); ++i) {
+        sum += latencies[i];
+        if (i > 0)
+            variation += std::abs(latencies[i] - latencies[i - 1]);
+    }
+    result.mean_ms = sum / latencies.size();
+    result.jitter_ms = latencies.size() > 1 ? variation / (latencies.size() - 1) : 0;
+    std::vector<double> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double _p) { return sorted[std::min(sorted.size() - 1, static_cast<size_t>(_p * sorted.size()))]; };
+    result.p50_ms = percentile(0.50);
+    result.p95_ms = percentile(0.95);
+    result.p99_ms = percentile(0.99);
+    result.max_ms = sorted.back();
+    return result;
+}
+
+int main(int argc, char** argv) {
+    std::string mode = argc > 1 ? argv[1] : "config";
+    std::string rates = argc > 2 ? argv[2] : "500,2000,5000";
+    int seconds = argc > 3 ? std::stoi(argv[3]) : 10;
+    int jitter_ms = argc > 4 ? std::stoi(argv[4]) : 0;
+    std::string path = argc > 5 ? argv[5] : "/home/x_user/my_camera_project/configuration_ap.json";
+    gst_init(&argc, &argv);
+
+    std::vector<int> bitrates;
+    std::stringstream list(rates);
+    for (std::string item; std::getline(list, item, ',');)
+        bitrates.push_back(std::stoi(item));
+
+    std::vector<std::string> codecs;
+    if (mode == "config") {
+        std::unique_ptr<Configuration> config = loadConfiguration(path, -1);
+        if (!config)
+            return 1;
+        codecs.push_back(config->streaming_codex == 1 ? "h265" : "h264");
+    } else if (mode == "both") {
+        codecs = {"h264", "h265"};
+    } else {
+        codecs.push_back(mode);
+    }
+
+    std::vector<Result> results;
+    for (const std::string& codec : codecs) {
+        for (int kbps : bitrates) {
+            std::unique_ptr<Configuration> config = loadConfiguration(path, codec == "h265" ? 1 : 0);
+            if (!config)
+                return 1;
+            std::printf("running %s at %d kbps for %d s ...\n", codec.c_str(), kbps, seconds);
+            results.push_back(run(codec, kbps, seconds, jitter_ms, *config));
+        }
+    }
+
+    std::printf("\n%-6s %7s %6s %6s %6s %7s %8s %8s %8s %8s %8s %8s\n", "codec", "kbps", "sent", "recv", "bad", "loss%",
+                "mean ms", "p50 ms", "p95 ms", "p99 ms", "max ms", "jitter");
+    int failures = 0;
+    for (const Result& r : results) {
+        std::printf("%-6s %7d %6d %6d %6d %7.2f %8.1f %8.1f %8.1f %8.1f %8.1f %8.2f\n", r.codec.c_str(), r.kbps, r.sent, r.received,
+                    r.unreadable, r.loss * 100, r.mean_ms, r.p50_ms, r.p95_ms, r.p99_ms, r.max_ms, r.jitter_ms);
+        if (r.received == 0)
+            failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+#ifndef TEST_CLIP_H
+#define TEST_CLIP_H
+
+#pragma once
+#include <string>
+#include <gst/gst.h>
+
+// Writes an H.264 (+ AAC when an encoder is installed) MP4 test clip like the training videos:
+// a moving pattern with a running time overlay and a tone, a keyframe every _keyint frames.
+// vpuenc_h264 is used on the board, x264enc elsewhere. Returns false when it could not be written.
+struct TestClip {
+    static bool available(const char* _element) {
+        GstElementFactory* factory = gst_element_factory_find(_element);
+        if (!factory)
+            return false;
+        gst_object_unref(factory);
+        return true;
+    }
+
+    static bool write(const std::string& _path, int _seconds, int _width = 1280, int _height = 720, int _fps = 25, int _keyint = 50) {
+        std::string encoder = available("vpuenc_h264") ? "vpuenc_h264 gop-size=" + std::to_string(_keyint)
+                                                       : "x264enc speed-preset=ultrafast key-int-max=" + std::to_string(_keyint);
+        std::string aac = available("avenc_aac") ? "avenc_aac" : available("voaacenc") ? "voaacenc" : available("fdkaacenc") ? "fdkaacenc" : "";
+        std::string description =
+            "videotestsrc pattern=ball num-buffers=" + std::to_string(_seconds * _fps) + " ! video/x-raw,width=" + std::to_string(_width) +
+            ",height=" + std::to_string(_height) + ",framerate=" + std::to_string(_fps) + "/1 ! timeoverlay font-desc=\"Sans 48\" ! "
+            "videoconvert ! " + encoder + " ! h264parse ! mp4mux name=mux ! filesink location=\"" + _path + "\"";
+        if (!aac.empty())
+            description += " audiotestsrc wave=sine freq=440 samplesperbuffer=1024 num-buffers=" + std::to_string(_seconds * 48000 / 1024) +
+                           " ! audio/x-raw,rate=48000,channels=2 ! audioconvert ! " + aac + " ! aacparse ! mux.";
+        GError* error = nullptr;
+        GstElement* pipeline = gst_parse_launch(description.c_str(), &error);
+        if (!pipeline) {
+            if (error)
+                g_error_free(error);
+            return false;
+        }
+        gst_element_set_state(pipeline, GST_STATE_PLAYING);
+        GstBus* bus = gst_element_get_bus(pipeline);
+        GstMessage* msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, GstMessageType(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        bool ok = msg && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS;
+        if (msg)
+            gst_message_unref(msg);
+        gst_object_unref(bus);
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_object_unref(pipeline);
+        return ok;
+    }
+};
+#endif // TEST_CLIP_H
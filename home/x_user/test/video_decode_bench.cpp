@@ -0,0 +1,148 @@
+#include "/home/x_user/my_camera_project/videocontroller.h"
+#include "test_clip.h"
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+// CPU and memory of standalone MP4 playback, the old dual decode against Videocontroller.
+// dual:   cv::VideoCapture decodes the video on a frame timer, a second filesrc ! decodebin
+//         pipeline decodes the file again for the audio (the previous Videocontroller).
+// single: Videocontroller, one playbin, video to an appsink and audio on the same clock.
+// Each mode plays the clip in its own process for the given time, with a 5 s forward seek
+// half way, and reports the CPU time and peak RSS of that process, the frames shown and the
+// distance between the video and the audio position at the end (A/V drift), and the seek latency
+// (the seek call until the first frame after it). For Videocontroller it also prints the decoded
+// frame queue: its capacity for the clip's frame size, the mean level seen by the presenter and
+// the underruns, to tune the queue budget (last argument, MB).
+// g++ -O2 -std=c++17 video_decode_bench.cpp -o video_decode_bench -lpthread `pkg-config --cflags --libs gstreamer-1.0 gstreamer-app-1.0 gstreamer-video-1.0 opencv4`
+// ./video_decode_bench [clip.mp4] [seconds] [audio sink] [queue MB]
+
+struct Played {
+    int frames = 0;
+    double drift_ms = 0;
+    double seek_ms = 0;
+    Videocontroller::QueueStats queue;
+};
+
+static Played playDual(const std::string& _clip, int _seconds, const std::string& _audio_sink) {
+    Played played;
+    cv::VideoCapture cap(_clip);
+    std::string description = "filesrc location=\"" + _clip + "\" ! decodebin name=d d. ! queue ! audioconvert ! audioresample ! "
+                              "volume name=vol volume=0.35 ! " + _audio_sink;
+    GstElement* pipeline = gst_parse_launch(description.c_str(), nullptr);
+    if (!cap.isOpened() || !pipeline)
+        return played;
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    double fps = cap.get(cv::CAP_PROP_FPS) > 0 ? cap.get(cv::CAP_PROP_FPS) : 25;
+    std::atomic<bool> running{true};
+    std::mutex cap_mutex;
+    std::thread timer([&]() {
+        while (running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(1000 / fps)));
+            std::lock_guard<std::mutex> lock(cap_mutex);
+            cv::Mat frame;
+            if (cap.read(frame) && !frame.empty())
+                played.frames++;
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(_seconds * 500));
+    {
+        // The previous seek: OpenCV decodes forward from the keyframe, the audio pipeline flushes
+        std::lock_guard<std::mutex> lock(cap_mutex);
+        auto start = std::chrono::steady_clock::now();
+        double target = cap.get(cv::CAP_PROP_POS_MSEC) + 5000;
+        cap.set(cv::CAP_PROP_POS_MSEC, target);
+        gst_element_seek_simple(pipeline, GST_FORMAT_TIME, GstSeekFlags(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT),
+                                static_cast<gint64>(target * GST_MSECOND));
+        cv::Mat frame;
+        if (cap.read(frame) && !frame.empty())
+            played.frames++;
+        played.seek_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(_seconds * 500));
+    running = false;
+    timer.join();
+    gint64 audio = 0;
+    if (gst_element_query_position(pipeline, GST_FORMAT_TIME, &audio))
+        played.drift_ms = cap.get(cv::CAP_PROP_POS_MSEC) - static_cast<double>(audio) / GST_MSECOND;
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+    return played;
+}
+
+static Played playSingle(const std::string& _clip, int _seconds, const std::string& _audio_sink, int _queue_mb) {
+    Played played;
+    Videocontroller video(_clip);
+    video.setAudioSink(_audio_sink);
+    video.setQueueBudget(static_cast<size_t>(_queue_mb) * 1024 * 1024);
+    std::atomic<int> frames{0};
+    video.setFrameCallback([&](cv::Mat) { frames++; });
+    if (video.init() != 0)
+        return played;
+    std::this_thread::sleep_for(std::chrono::milliseconds(_seconds * 500));
+    video.seekForward(5000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(_seconds * 500));
+    played.frames = frames;
+    played.seek_ms = video.getSeekStats().last_ms;
+    played.queue = video.getQueueStats();
+    // The pipeline position follows the audio clock, the controller's last frame is what was shown
+    played.drift_ms = video.getFramePosition() - video.getPosition();
+    video.stopPlaying();
+    return played;
+}
+
+int main(int argc, char** argv) {
+    std::string clip = argc > 1 ? argv[1] : "";
+    int seconds = argc > 2 ? std::stoi(argv[2]) : 20;
+    std::string audio_sink = argc > 3 ? argv[3] : "fakesink sync=true";
+    int queue_mb = argc > 4 ? std::stoi(argv[4]) : 48;
+    gst_init(&argc, &argv);
+    if (clip.empty()) {
+        clip = "/tmp/video_decode_bench.mp4";
+        std::printf("writing a %d s 1280x720 test clip to %s ...\n", seconds + 10, clip.c_str());
+        if (!TestClip::write(clip, seconds + 10)) {
+            std::printf("FAIL: the test clip could not be written\n");
+            return 1;
+        }
+    }
+
+    const char* modes[] = {"dual", "single"};
+    std::printf("\n%-7s %8s %8s %8s %10s %9s %8s\n", "mode", "frames", "cpu s", "cpu %", "max rss MB", "drift ms", "seek ms");
+    int failures = 0;
+    for (const char* mode : modes) {
+        int fds[2];
+        if (pipe(fds) != 0)
+            return 1;
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            Played played = std::string(mode) == "dual" ? playDual(clip, seconds, audio_sink) : playSingle(clip, seconds, audio_sink, queue_mb);
+            if (write(fds[1], &played, sizeof(played)) != sizeof(played))
+                _exit(1);
+            _exit(0);
+        }
+        close(fds[1]);
+        Played played;
+        bool received = read(fds[0], &played, sizeof(played)) == sizeof(played);
+        close(fds[0]);
+        int status = 0;
+        struct rusage usage;
+        wait4(pid, &status, 0, &usage);
+        double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+        std::printf("%-7s %8d %8.2f %8.1f %10.1f %9.1f %8.1f\n", mode, played.frames, cpu, 100.0 * cpu / seconds,
+                    usage.ru_maxrss / 1024.0, played.drift_ms, played.seek_ms);
+        if (received && played.queue.capacity_frames > 0)
+            std::printf("        frame queue %d MB = %d frames: mean level %.1f, min %d, underruns %llu\n",
+                        static_cast<int>(played.queue.budget_bytes / (1024 * 1024)), played.queue.capacity_frames, played.queue.mean_level_frames,
+                        played.queue.min_level_frames, static_cast<unsigned long long>(played.queue.underruns));
+        if (!received || played.frames == 0) {
+            std::printf("FAIL: %s played no frames\n", mode);
+            failures++;
+        }
+    }
+    if (failures == 0)
+        std::printf("PASS\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include "/home/x_user/my_camera_project/videosurface.h"
+#include <QApplication>
+#include <QGraphicsScene>
+#include <QGraphicsView>
+#include <QGraphicsPixmapItem>
+#include <cstdio>
+// UI-thread cost per frame of the QGraphicsView pixmap path against VideoSurface, with BGR
+// frames and with the YUY2 frames the camera display receives when it uses the surface
+// g++ -O2 -std=c++17 -fPIC video_surface_bench.cpp -o video_surface_bench `pkg-config --cflags --libs Qt5Widgets opencv4`
+// xvfb-run -s "-screen 0 1280x800x24" env LIBGL_ALWAYS_SOFTWARE=1 ./video_surface_bench [frames]
+
+static std::vector<cv::Mat> makeFrames(int _count) {
+    std::vector<cv::Mat> frames;
+    for (int i = 0; i < _count; ++i) {
+        cv::Mat frame(768, 1024, CV_8UC3, cv::Scalar(40, 80, 120));
+        cv::circle(frame, cv::Point(100 + i * 50, 384), 80, cv::Scalar(0, 255, 0), -1);
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+// Packed YUY2 (Y, U/V alternating), a bright disc on a mid-grey background
+static std::vector<cv::Mat> makeYuy2Frames(int _count) {
+    std::vector<cv::Mat> frames;
+    for (int i = 0; i < _count; ++i) {
+        cv::Mat frame(768, 1024, CV_8UC2, cv::Scalar(110, 128));
+        cv::circle(frame, cv::Point(100 + i * 50, 384), 80, cv::Scalar(200, 90), -1);
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+static qint64 runSurface(QApplication& _app, VideoSurface& _surface, const std::vector<cv::Mat>& _frames, int _count) {
+    QElapsedTimer timer;
+    qint64 total_ns = 0;
+    _surface.resetStats();
+    for (int i = 0; i < _count; ++i) {
+        timer.start();
+        _surface.setFrame(_frames[i % _frames.size()]);
+        _surface.repaint();
+        total_ns += timer.nsecsElapsed();
+        _app.processEvents();
+    }
+    return total_ns;
+}
+
+static void printSurface(const char* _name, qint64 _ns, int _count, const VideoSurface::Stats& _stats) {
+    std::printf("%s %.3f ms/frame (paint %.3f ms, max %.3f ms, %llu/%llu uploads through PBO)\n",
+                _name, _ns / 1e6 / _count, _stats.mean_paint_ms, _stats.max_paint_ms,
+                static_cast<unsigned long long>(_stats.pbo_uploads), static_cast<unsigned long long>(_stats.uploads));
+}
+
+int main(int argc, char** argv) {
+    QApplication app(argc, argv);
+    int count = argc > 1 ? std::stoi(argv[1]) : 300;
+    std::vector<cv::Mat> frames = makeFrames(16);
+
+    // Pixmap path as CameraViewer used it: fromImage, setPixmap, fitInView, repaint
+    QGraphicsScene scene;
+    QGraphicsPixmapItem* item = new QGraphicsPixmapItem();
+    scene.addItem(item);
+    QGraphicsView view(&scene);
+    view.setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    view.setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    view.resize(1280, 800);
+    view.show();
+    app.processEvents();
+    QElapsedTimer timer;
+    qint64 pixmap_ns = 0;
+    for (int i = 0; i < count; ++i) {
+        const cv::Mat& frame = frames[i % frames.size()];
+        timer.start();
+        QImage image(frame.data, frame.cols, frame.rows, frame.step, QImage::Format_BGR888);
+        item->setPixmap(QPixmap::fromImage(image));
+        scene.setSceneRect(item->boundingRect());
+        view.fitInView(scene.sceneRect(), Qt::KeepAspectRatioByExpanding);
+        view.centerOn(item);
+        view.viewport()->repaint();
+        pixmap_ns += timer.nsecsElapsed();
+        app.processEvents();
+    }
+    view.hide();
+
+    if (!VideoSurface::isSupported()) {
+        std::printf("pixmap  %.3f ms/frame\nno OpenGL context, surface skipped\n", pixmap_ns / 1e6 / count);
+        return 1;
+    }
+    VideoSurface surface(VideoSurface::ScaleMode::Fill);
+    surface.resize(1280, 800);
+    surface.show();
+    app.processEvents();
+    qint64 surface_ns = runSurface(app, surface, frames, count);
+    VideoSurface::Stats stats = surface.getStats();
+    qint64 yuy2_ns = runSurface(app, surface, makeYuy2Frames(16), count);
+    VideoSurface::Stats yuy2_stats = surface.getStats();
+    std::printf("pixmap  %.3f ms/frame\n", pixmap_ns / 1e6 / count);
+    printSurface("surface", surface_ns, count, stats);
+    printSurface("yuy2   ", yuy2_ns, count, yuy2_stats);
+    return 0;
+}